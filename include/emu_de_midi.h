@@ -197,7 +197,8 @@ extern EDMIDI_DECLSPEC const char *edmidi_errorInfo(struct EDMIDIPlayer *device)
  * @brief Initialize Emu De Midi Player device
  *
  * Tip 1: You can initialize multiple instances and run them in parallel
- * Tip 2: Library is NOT thread-safe, therefore don't use same instance in different threads or use mutexes
+ * Tip 2: Library is NOT thread-safe, therefore don't use same instance in different threads or use mutexes,
+ *        except of the real-time MIDI calls and of the asynchronous control (see `edmidi_setAsyncControl`)
  * Tip 3: Changing of sample rate on the fly is not supported. Re-create the instance again.
  * Top 4: To generate output in OPL chip native sample rate, please initialize it with sample rate value as `edmidi_CHIP_SAMPLE_RATE`
  *
@@ -241,6 +242,58 @@ extern EDMIDI_DECLSPEC int edmidi_openFile(struct EDMIDIPlayer *device, const ch
  */
 extern EDMIDI_DECLSPEC int edmidi_openData(struct EDMIDIPlayer *device, const void *mem, unsigned long size);
 
+/**
+ * @brief Load MIDI (or any other supported format) file from memory data without copying it
+ *
+ * Same as `edmidi_openData`, but the raw payloads of the song which are stored as-is in
+ * the file (such as the meta events) are referred right in the given memory instead of being
+ * copied. SysEx payloads are copied anyway, as they get the status byte prepended, and so are
+ * the text events which get a terminator appended. The memory block must stay
+ * valid and unchanged until another song is loaded or the library instance is closed.
+ * With the asynchronous control (see `edmidi_setAsyncControl`) the data gets copied anyway,
+ * as the previous song keeps playing for a while after the next one is loaded, and
+ * enabling that control copies the memory block of the song loaded this way.
+ *
+ * Available when library is built with built-in MIDI Sequencer support.
+ *
+ * @param device Instance of the library
+ * @param mem Pointer to memory block where is raw data of music file is stored
+ * @param size Size of given memory block
+ * @return 0 on success, <0 when any error has occurred
+ */
+extern EDMIDI_DECLSPEC int edmidi_openDataNoCopy(struct EDMIDIPlayer *device, const void *mem, unsigned long size);
+
+/**
+ * @brief Store the currently loaded song as the cache blob
+ *
+ * The cache keeps the song in the ready to play form, `edmidi_openSongCache` loads it
+ * back without the parse of the music file. The blob can be loaded only by the same
+ * version of the library built for the same platform. The song is stored as it was
+ * opened, whatever has been played since then. With the asynchronous control (see
+ * `edmidi_setAsyncControl`), it gives the cache taken when the latest song was
+ * loaded, as the playing song belongs to the thread which renders it.
+ *
+ * Available when library is built with built-in MIDI Sequencer support.
+ *
+ * @param device Instance of the library
+ * @param dst Pointer to the destination memory block, or NULL to get the size of the cache only
+ * @param size Size of the destination memory block
+ * @return Size of the cache (nothing gets written if it's larger than size), <0 when no song is loaded
+ */
+extern EDMIDI_DECLSPEC long edmidi_saveSongCache(struct EDMIDIPlayer *device, void *dst, unsigned long size);
+
+/**
+ * @brief Load the song from the cache blob made by `edmidi_saveSongCache`
+ *
+ * Available when library is built with built-in MIDI Sequencer support.
+ *
+ * @param device Instance of the library
+ * @param mem Pointer to memory block where the song cache is stored
+ * @param size Size of given memory block
+ * @return 0 on success, <0 when any error has occurred (damaged cache or cache of another library build)
+ */
+extern EDMIDI_DECLSPEC int edmidi_openSongCache(struct EDMIDIPlayer *device, const void *mem, unsigned long size);
+
 /**
  * @brief Switch another song if multi-song file is playing (for example, XMI)
  *
@@ -493,6 +546,36 @@ extern EDMIDI_DECLSPEC int  edmidi_playF32(struct EDMIDIPlayer *device, int samp
  */
 extern EDMIDI_DECLSPEC int  edmidi_playFormat(struct EDMIDIPlayer *device, int sampleCount, EDMIDI_UInt8 *left, EDMIDI_UInt8 *right, const struct EDMIDI_AudioFormat *format);
 
+/**
+ * @brief Generate PCM signed 16-bit stereo audio output without iteration of MIDI timers
+ *
+ * Use this function when you are driving the synthesizer by the real-time MIDI calls
+ * (`edmidi_rt_*`) only. The loaded song, if any, stays at its position.
+ *
+ * Don't use count of frames, use instead count of samples. One frame is two samples.
+ * So, for example, if you want to take 10 frames, you must to request amount of 20 samples!
+ *
+ * @param device Instance of the library
+ * @param sampleCount Count of samples (not frames!)
+ * @param out Pointer to output with 16-bit stereo PCM output
+ * @return Count of given samples, otherwise, 0 or when catching an error while generating
+ */
+extern EDMIDI_DECLSPEC int  edmidi_generate(struct EDMIDIPlayer *device, int sampleCount, short *out);
+
+/**
+ * @brief Generate PCM stereo audio output in sample format declared by given context without iteration of MIDI timers
+ *
+ * The same as `edmidi_generate`, but with the output format of `edmidi_playFormat`.
+ *
+ * @param device Instance of the library
+ * @param sampleCount Count of samples (not frames!)
+ * @param left Left channel buffer output (Must be casted into bytes array)
+ * @param right Right channel buffer output (Must be casted into bytes array)
+ * @param format Destination PCM format format context
+ * @return Count of given samples, otherwise, 0 or when catching an error while generating
+ */
+extern EDMIDI_DECLSPEC int  edmidi_generateFormat(struct EDMIDIPlayer *device, int sampleCount, EDMIDI_UInt8 *left, EDMIDI_UInt8 *right, const struct EDMIDI_AudioFormat *format);
+
 
 
 /* ======== Hooks and debugging ======== */
@@ -590,6 +673,357 @@ extern EDMIDI_DECLSPEC void edmidi_setLoopHooksOnly(struct EDMIDIPlayer *device,
  */
 extern EDMIDI_DECLSPEC void edmidi_setModeEMIDI(struct EDMIDIPlayer *device, int emidiEn);
 
+/**
+ * @brief Render all chips at the OPLL native sample rate and resample their mix once
+ *
+ * By default every chip converts its output to the output sample rate on its own.
+ * With this mode enabled, the chips render at the rate of the OPLL chip (clock / 72),
+ * they are summed on an internal bus, and one resampler converts the sum into the
+ * output sample rate.
+ *
+ * Note: Changing this mode re-creates the chips, which resets the state of all channels.
+ * It does nothing while the render thread (see `edmidi_startAsyncRender`) runs
+ *
+ * @param device Instance of the library
+ * @param nativeRate 0 - disabled, 1 - enabled
+ */
+extern EDMIDI_DECLSPEC void edmidi_setNativeRateMixing(struct EDMIDIPlayer *device, int nativeRate);
+
+/**
+ * @brief Render the chip modules in parallel on a pool of threads
+ *
+ * The modules of every rendered block are spread over the threads, and their
+ * outputs are mixed in a fixed order, so the result is exactly the same as the
+ * one of the single-threaded rendering. The calling thread takes part in the
+ * rendering, so a value of 2 starts one extra thread.
+ *
+ * Note: Don't call this function while another thread renders the audio.
+ * It fails while the render thread (see `edmidi_startAsyncRender`) runs
+ *
+ * @param device Instance of the library
+ * @param threads Count of threads to use, 0 or 1 to render on the calling thread only
+ * @return 0 on success, <0 when this build has no threads support or the render thread runs
+ */
+extern EDMIDI_DECLSPEC int edmidi_setRenderThreads(struct EDMIDIPlayer *device, int threads);
+
+/**
+ * @brief Decode the tracks of multi-track MIDI files in parallel on a pool of threads
+ *
+ * The tracks get decoded in parallel, and then they are merged, and the tempo
+ * map, the loop points, and the timings are computed in a single pass in the
+ * order of tracks, so the loaded song is exactly the same as with the
+ * single-threaded loading. It takes effect for the files loaded after this call.
+ * The calling thread takes part in the decoding, so a value of 2 starts one
+ * extra thread.
+ *
+ * Note: Don't call this function while another thread loads the music.
+ * It fails while the render thread (see `edmidi_startAsyncRender`) runs
+ *
+ * @param device Instance of the library
+ * @param threads Count of threads to use, 0 or 1 to decode on the calling thread only
+ * @return 0 on success, <0 when this build has no threads support or the render thread runs
+ */
+extern EDMIDI_DECLSPEC int edmidi_setLoadThreads(struct EDMIDIPlayer *device, int threads);
+
+/**
+ * @brief Control the playback from other thread than the one which renders the audio
+ *
+ * With this mode enabled, the controlling calls don't touch the playing song, but
+ * post commands which the next call of `edmidi_play*` or `edmidi_generate*` applies
+ * before rendering, so they need no mutex shared with the audio thread:
+ * `edmidi_positionSeek`, `edmidi_positionRewind`, `edmidi_setTempo`, `edmidi_reset`,
+ * `edmidi_setTrackEnabled`, `edmidi_setChannelEnabled`, `edmidi_setLoopEnabled`,
+ * `edmidi_setLoopCount`, `edmidi_setLoopHooksOnly`, `edmidi_setModeEMIDI`,
+ * `edmidi_setTriggerHandler`, `edmidi_setDebugMessageHook`, `edmidi_setLoopStartHook`
+ * and `edmidi_setLoopEndHook`.
+ *
+ * The `edmidi_open*` calls load the song into a new sequencer on the calling thread,
+ * and prepare its seek index there, so the later seeks don't walk the whole song.
+ * The next rendered block swaps the new song in. When the loading fails, the current
+ * song keeps playing. The `edmidi_meta*`, `edmidi_totalTimeLength` and the similar
+ * calls give the info of the latest loaded song, and `edmidi_positionTell` and
+ * `edmidi_atEnd` give the state after the latest rendered block.
+ *
+ * All the controlling calls must come from a single thread. `edmidi_selectSongNum`
+ * takes effect for the next loaded song only. The other setters, like the threads
+ * or the mixing mode, still can't be called while the audio renders.
+ *
+ * Note: Don't call this function while another thread renders the audio.
+ * It does nothing while the render thread (see `edmidi_startAsyncRender`) runs
+ *
+ * @param device Instance of the library
+ * @param enabled 0 - disabled, 1 - enabled
+ */
+extern EDMIDI_DECLSPEC void edmidi_setAsyncControl(struct EDMIDIPlayer *device, int enabled);
+
+/**
+ * @brief Start the thread which renders the audio ahead into a buffer
+ *
+ * The thread renders the PCM signed 16-bit stereo audio into a lock-free ring
+ * buffer of the given size, and the audio callback only copies it out by
+ * `edmidi_readAsyncRender`, so the expensive ticks, the seeks and the loop jumps
+ * of the sequencer don't land at the deadline of the audio device.
+ *
+ * The asynchronous control (see `edmidi_setAsyncControl`) is enabled while the
+ * thread runs, and the `edmidi_play*` and `edmidi_generate*` calls fail. The
+ * controlling calls and the real-time MIDI events take effect at the next block
+ * rendered by the thread, so they are heard after the buffered audio, and
+ * `edmidi_positionTell` gives the position of the rendered audio. The hooks get
+ * swapped in by the thread too. The calls which would change what the thread
+ * uses do nothing or fail until `edmidi_stopAsyncRender`:
+ * `edmidi_setAsyncControl`, `edmidi_setNativeRateMixing`, `edmidi_setRenderThreads`
+ * and `edmidi_setLoadThreads`.
+ *
+ * @param device Instance of the library
+ * @param bufferFrames Count of frames to buffer, rounded up to a power of two, from 16 to 1048576
+ * @return 0 on success, <0 when failed
+ */
+extern EDMIDI_DECLSPEC int edmidi_startAsyncRender(struct EDMIDIPlayer *device, unsigned int bufferFrames);
+
+/**
+ * @brief Start the thread which renders the audio ahead in the given format
+ *
+ * Same as `edmidi_startAsyncRender`, but for the given format of the samples.
+ * Only the interleaved formats can be used: the `sampleOffset` must be twice
+ * of the `containerSize`.
+ *
+ * @param device Instance of the library
+ * @param bufferFrames Count of frames to buffer, rounded up to a power of two, from 16 to 1048576
+ * @param format Destination PCM format format context
+ * @return 0 on success, <0 when failed
+ */
+extern EDMIDI_DECLSPEC int edmidi_startAsyncRenderFormat(struct EDMIDIPlayer *device, unsigned int bufferFrames,
+                                                         const struct EDMIDI_AudioFormat *format);
+
+/**
+ * @brief Stop the render thread and drop the buffered audio
+ *
+ * The controlling calls are applied right away again, unless the asynchronous
+ * control was enabled before the thread was started.
+ *
+ * @param device Instance of the library
+ */
+extern EDMIDI_DECLSPEC void edmidi_stopAsyncRender(struct EDMIDIPlayer *device);
+
+/**
+ * @brief Copy the audio rendered by the render thread out
+ *
+ * Never waits for the render thread, so it's safe to call from the audio
+ * callback. When the buffer doesn't hold enough audio, the rest of the output
+ * is filled with silence, and the underrun gets counted.
+ *
+ * @param device Instance of the library
+ * @param sampleCount Count of samples (not frames!)
+ * @param out Pointer to output in the format given at the start of the thread
+ * @return Count of given samples (always the requested count), <0 when the thread doesn't run
+ */
+extern EDMIDI_DECLSPEC int edmidi_readAsyncRender(struct EDMIDIPlayer *device, int sampleCount, EDMIDI_UInt8 *out);
+
+/**
+ * @brief Count of frames which the render thread has buffered ahead
+ * @param device Instance of the library
+ * @return Count of frames, 0 when the thread doesn't run
+ */
+extern EDMIDI_DECLSPEC unsigned long edmidi_asyncRenderFill(struct EDMIDIPlayer *device);
+
+/**
+ * @brief Count of the reads which got less audio than requested since the start of the render thread
+ * @param device Instance of the library
+ * @return Count of underruns
+ */
+extern EDMIDI_DECLSPEC unsigned long edmidi_asyncRenderUnderruns(struct EDMIDIPlayer *device);
+
+
+/* ======== Offline batch rendering ======== */
+
+/**
+ * @brief Receives the audio rendered by `edmidi_renderBatch`
+ * @param userData Pointer to user data of the job
+ * @param data Rendered frames in the format of the batch
+ * @param size Size of the data in bytes
+ * @return 0 to continue, any other value cancels the job
+ */
+typedef int (*EDMIDI_BatchSink)(void *userData, const EDMIDI_UInt8 *data, unsigned long size);
+
+/**
+ * @brief Settings of the batch rendering
+ */
+struct EDMIDI_BatchSettings
+{
+    /*! Output sample rate */
+    long sampleRate;
+    /*! Count of the emulated chip modules (see `edmidi_initEx`), 0 for the default */
+    int modules;
+    /*! Count of threads to render the songs by, including the calling one */
+    int threads;
+    /*! Output format, must be an interleaved one, NULL for the PCM signed 16-bit stereo */
+    const struct EDMIDI_AudioFormat *format;
+    /*! Maximum length of every rendered song in seconds, 0 for the whole song */
+    double maxSeconds;
+};
+
+/**
+ * @brief One song to render by `edmidi_renderBatch`
+ */
+struct EDMIDI_BatchJob
+{
+    /*! Path to the music file, or NULL to take the data from the memory */
+    const char *filePath;
+    /*! Music file data in the memory, it must stay valid until the batch is rendered */
+    const void *data;
+    /*! Size of the music file data in bytes */
+    unsigned long dataSize;
+    /*! Receives the rendered audio, called by the thread which renders the song */
+    EDMIDI_BatchSink sink;
+    /*! Pointer to user data of the sink */
+    void *userData;
+
+    /*! Result: 0 on success, -1 when the song can't be loaded, -2 when the sink has canceled it */
+    int result;
+    /*! Result: count of the rendered frames */
+    unsigned long frames;
+    /*! Result: time spent to load and render the song in seconds */
+    double seconds;
+    /*! Result: times faster than real time the song got rendered */
+    double speed;
+};
+
+/**
+ * @brief Render many songs offline by a pool of threads
+ *
+ * Every thread renders the songs one by one with its own player, and every
+ * player is reused by the next songs, so only the count of threads decides
+ * the count of the emulated chips which run at once. Every song sounds the
+ * same as rendered by a new player with the loop disabled. The jobs are
+ * taken in the order of the array, and the sink of every job is called by a
+ * single thread at a time, block by block in the order of the song.
+ *
+ * @param settings Settings of the batch
+ * @param jobs Array of the songs to render, gets the results
+ * @param count Count of the songs
+ * @return Count of the failed jobs, <0 when the settings are invalid
+ */
+extern EDMIDI_DECLSPEC int edmidi_renderBatch(const struct EDMIDI_BatchSettings *settings,
+                                              struct EDMIDI_BatchJob *jobs, int count);
+
+/**
+ * @brief Render the loaded song offline by many threads
+ *
+ * Rewinds the song with the chips reset, and renders it to its end into the
+ * sink. The result is exactly the same as of the `edmidi_playFormat` calls of
+ * 8192 samples each by a new player which has just loaded the song. The
+ * song gets played twice: first only to log what every chip module has to
+ * do, then the modules render their logs at once by the threads while the
+ * song gets mixed. So no more threads than the modules get used. The hooks
+ * of the player are called by the second pass only. Don't call the other
+ * functions of the player, and don't send the real-time events until it
+ * returns. With an endless loop, only the length limit stops it. When the
+ * sink cancels it, the chips get reset, and the song stays where it was.
+ *
+ * @param device Instance of the library
+ * @param threads Count of threads, including the calling one, 1 or less to render by the calling thread only
+ * @param format Output format, must be an interleaved one, NULL for the PCM signed 16-bit stereo
+ * @param sink Receives the rendered audio, called by the calling thread
+ * @param userData Pointer to user data of the sink
+ * @param maxSeconds Maximum length to render in seconds, 0 for the whole song
+ * @return Count of the rendered frames, -1 on error, -2 when the sink has canceled it
+ */
+extern EDMIDI_DECLSPEC long edmidi_renderOffline(struct EDMIDIPlayer *device, int threads,
+                                                 const struct EDMIDI_AudioFormat *format,
+                                                 EDMIDI_BatchSink sink, void *userData, double maxSeconds);
+
+
+/* ======== Real-Time MIDI ======== */
+
+/*
+ * The real-time MIDI calls don't play the event right away: they put it into
+ * a queue which the next call of `edmidi_play*` or `edmidi_generate*` plays,
+ * each event at the exact frame given by its offset. The offset is counted in
+ * frames (not samples!) from the start of the next rendered output, and the
+ * events must be sent in order of their offsets.
+ *
+ * These calls never wait for the audio rendering, so they can be called by a
+ * single thread (a game, a sequencer, a MIDI input) while the other one renders
+ * the audio, without any locking.
+ *
+ * They return 0 on success, and <0 on invalid arguments or when the queue is
+ * full because the audio doesn't get rendered. In that case no error string
+ * is set.
+ */
+
+/**
+ * @brief Real-Time Note-On
+ * @param device Instance of the library
+ * @param channel Target MIDI channel [0..15]
+ * @param note Note number to on [Between 0 and 127]
+ * @param velocity Velocity level [Between 0 and 127]
+ * @param frameOffset Offset in frames from the start of the next rendered output
+ * @return 0 on success, <0 when the event can't be queued
+ */
+extern EDMIDI_DECLSPEC int edmidi_rt_noteOn(struct EDMIDIPlayer *device, EDMIDI_UInt8 channel, EDMIDI_UInt8 note, EDMIDI_UInt8 velocity, unsigned int frameOffset);
+
+/**
+ * @brief Real-Time Note-Off
+ * @param device Instance of the library
+ * @param channel Target MIDI channel [0..15]
+ * @param note Note number to off [Between 0 and 127]
+ * @param frameOffset Offset in frames from the start of the next rendered output
+ * @return 0 on success, <0 when the event can't be queued
+ */
+extern EDMIDI_DECLSPEC int edmidi_rt_noteOff(struct EDMIDIPlayer *device, EDMIDI_UInt8 channel, EDMIDI_UInt8 note, unsigned int frameOffset);
+
+/**
+ * @brief Real-Time Channel aftertouch
+ * @param device Instance of the library
+ * @param channel Target MIDI channel [0..15]
+ * @param atVal After-Touch level [Between 0 and 127]
+ * @param frameOffset Offset in frames from the start of the next rendered output
+ * @return 0 on success, <0 when the event can't be queued
+ */
+extern EDMIDI_DECLSPEC int edmidi_rt_channelAfterTouch(struct EDMIDIPlayer *device, EDMIDI_UInt8 channel, EDMIDI_UInt8 atVal, unsigned int frameOffset);
+
+/**
+ * @brief Real-Time Controller change
+ * @param device Instance of the library
+ * @param channel Target MIDI channel [0..15]
+ * @param type Type of the controller [Between 0 and 255]
+ * @param value Value of the controller event [Between 0 and 127]
+ * @param frameOffset Offset in frames from the start of the next rendered output
+ * @return 0 on success, <0 when the event can't be queued
+ */
+extern EDMIDI_DECLSPEC int edmidi_rt_controllerChange(struct EDMIDIPlayer *device, EDMIDI_UInt8 channel, EDMIDI_UInt8 type, EDMIDI_UInt8 value, unsigned int frameOffset);
+
+/**
+ * @brief Real-Time Patch change
+ * @param device Instance of the library
+ * @param channel Target MIDI channel [0..15]
+ * @param patch Patch number [Between 0 and 127]
+ * @param frameOffset Offset in frames from the start of the next rendered output
+ * @return 0 on success, <0 when the event can't be queued
+ */
+extern EDMIDI_DECLSPEC int edmidi_rt_patchChange(struct EDMIDIPlayer *device, EDMIDI_UInt8 channel, EDMIDI_UInt8 patch, unsigned int frameOffset);
+
+/**
+ * @brief Real-Time Pitch Bend change
+ * @param device Instance of the library
+ * @param channel Target MIDI channel [0..15]
+ * @param pitch 14-bit pitch bend value [Between 0 and 16383], 8192 is the center
+ * @param frameOffset Offset in frames from the start of the next rendered output
+ * @return 0 on success, <0 when the event can't be queued
+ */
+extern EDMIDI_DECLSPEC int edmidi_rt_pitchBend(struct EDMIDIPlayer *device, EDMIDI_UInt8 channel, EDMIDI_UInt16 pitch, unsigned int frameOffset);
+
+/**
+ * @brief Real-Time Pitch Bend change with separated high and low parts
+ * @param device Instance of the library
+ * @param channel Target MIDI channel [0..15]
+ * @param msb High 7 bits part of the pitch bend value
+ * @param lsb Low 7 bits part of the pitch bend value
+ * @param frameOffset Offset in frames from the start of the next rendered output
+ * @return 0 on success, <0 when the event can't be queued
+ */
+extern EDMIDI_DECLSPEC int edmidi_rt_pitchBendML(struct EDMIDIPlayer *device, EDMIDI_UInt8 channel, EDMIDI_UInt8 msb, EDMIDI_UInt8 lsb, unsigned int frameOffset);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,74 @@
+#ifndef __CATOMIC_HPP__
+#define __CATOMIC_HPP__
+#include "DsaCommon.hpp"
+
+#if defined(_MSC_VER)
+#   include <intrin.h>
+#endif
+
+namespace dsa {
+
+// Acquire load and release store of the 32-bit words which two threads
+// share without a lock. They are enough for the queues with one writer
+// of each index.
+#if defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7)))
+
+inline UINT32 AtomicLoad(const volatile UINT32 *p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+inline void AtomicStore(volatile UINT32 *p, UINT32 v) { __atomic_store_n(p, v, __ATOMIC_RELEASE); }
+
+#elif defined(__GNUC__)
+
+inline UINT32 AtomicLoad(const volatile UINT32 *p) { UINT32 v = *p; __sync_synchronize(); return v; }
+inline void AtomicStore(volatile UINT32 *p, UINT32 v) { __sync_synchronize(); *p = v; }
+
+#elif defined(_MSC_VER)
+
+inline UINT32 AtomicLoad(const volatile UINT32 *p) { return (UINT32)_InterlockedOr((volatile long *)p, 0); }
+inline void AtomicStore(volatile UINT32 *p, UINT32 v) { _InterlockedExchange((volatile long *)p, (long)v); }
+
+#else
+
+inline UINT32 AtomicLoad(const volatile UINT32 *p) { return *p; }
+inline void AtomicStore(volatile UINT32 *p, UINT32 v) { *p = v; }
+
+#endif
+
+// Ring buffer of the values which one thread pushes and the other one
+// pops. Neither of them ever waits: the producer owns the tail, the
+// consumer owns the head, and each of them only reads the index of the
+// other one.
+template <class T, UINT32 SIZE> // SIZE must be a power of two
+class CLockFreeQueue {
+  T m_buf[SIZE];
+  volatile UINT32 m_head;    // Written by the consumer only
+  volatile UINT32 m_tail;    // Written by the producer only
+
+  CLockFreeQueue(const CLockFreeQueue &);
+  CLockFreeQueue &operator=(const CLockFreeQueue &);
+public:
+  CLockFreeQueue() : m_head(0), m_tail(0) {}
+
+  // Producer: fails when the consumer hasn't taken enough values yet
+  bool Push(const T &v) {
+    const UINT32 tail = m_tail;
+    if((tail - AtomicLoad(&m_head)) == SIZE)
+      return false;
+    m_buf[tail & (SIZE - 1)] = v;
+    AtomicStore(&m_tail, tail + 1);
+    return true;
+  }
+
+  // Consumer
+  bool Empty() const { return m_head == AtomicLoad(&m_tail); }
+  const T &Front() const { return m_buf[m_head & (SIZE - 1)]; }
+  void Pop() { AtomicStore(&m_head, m_head + 1); }
+
+  // Consumer: the count of the values pushed and not popped yet, and the
+  // one `i` places after the front, which the producer leaves untouched
+  UINT32 Count() const { return AtomicLoad(&m_tail) - m_head; }
+  T &Peek(UINT32 i) { return m_buf[(m_head + i) & (SIZE - 1)]; }
+};
+
+} // namespace dsa
+
+#endif // __CATOMIC_HPP__
@@ -0,0 +1,119 @@
+#include <stddef.h>
+#include "CBatchRenderer.hpp"
+#include "CSMFPlay.hpp"
+#include "CWorkerPool.hpp"
+
+#if defined (_MSC_VER)
+#if defined (_DEBUG)
+#define new new( _CLIENT_BLOCK, __FILE__, __LINE__)
+#endif
+#endif
+
+using namespace dsa;
+
+CBatchRenderer::CBatchRenderer(DWORD rate, int mods, int threads,
+                               const EDMIDI_AudioFormat &format, double maxSeconds)
+  : m_rate(rate), m_mods(mods), m_format(format), m_jobs(NULL) {
+  m_frameSize = format.containerSize * 2;
+  m_maxFrames = (maxSeconds > 0.0) ? (unsigned long)(maxSeconds * rate) : 0;
+  m_pool = (threads > 1) ? new CWorkerPool(threads) : NULL;
+}
+
+CBatchRenderer::~CBatchRenderer() {
+  if(m_pool)
+    delete m_pool;
+  for(size_t i=0; i<m_players.size(); i++) {
+    delete m_players[i]->play;
+    delete m_players[i];
+  }
+}
+
+CBatchRenderer::Player *CBatchRenderer::TakePlayer() {
+  m_mutex.Lock();
+  Player *p = m_idle.back();
+  m_idle.pop_back();
+  m_mutex.Unlock();
+  return p;
+}
+
+void CBatchRenderer::GivePlayer(Player *player) {
+  m_mutex.Lock();
+  m_idle.push_back(player);
+  m_mutex.Unlock();
+}
+
+void CBatchRenderer::Render(EDMIDI_BatchJob &job, Player &player) {
+  const double start = CThread::Clock();
+  CSMFPlay &play = *player.play;
+  job.result = 0;
+  job.frames = 0;
+
+  // Loading resets the chips, so the song sounds as from a new player
+  bool loaded = job.filePath ? play.Open(job.filePath)
+                             : play.Load(job.data, (int)job.dataSize, true);
+  if(!loaded) {
+    job.result = -1;
+  } else {
+    UINT8 *out = &player.buffer[0];
+    for(;;) {
+      unsigned long frames = BLOCK_FRAMES;
+      if(m_maxFrames) {
+        if(job.frames >= m_maxFrames)
+          break;
+        if(m_maxFrames - job.frames < frames)
+          frames = m_maxFrames - job.frames;
+      }
+      int got = play.RenderFormat((int)frames * 2, out, out + m_format.containerSize, &m_format) / 2;
+      if(got <= 0)
+        break;
+      if(job.sink(job.userData, out, (unsigned long)got * m_frameSize) != 0) {
+        job.result = -2;
+        break;
+      }
+      job.frames += (unsigned long)got;
+      if((unsigned long)got < frames)
+        break; // Reached the song end
+    }
+  }
+
+  job.seconds = CThread::Clock() - start;
+  job.speed = (job.seconds > 0.0) ? ((double)job.frames / m_rate) / job.seconds : 0.0;
+}
+
+void CBatchRenderer::JobEntry(void *ctx, int index) {
+  CBatchRenderer *self = static_cast<CBatchRenderer *>(ctx);
+  Player *player = self->TakePlayer();
+  self->Render(self->m_jobs[index], *player);
+  self->GivePlayer(player);
+}
+
+int CBatchRenderer::Run(EDMIDI_BatchJob *jobs, int count) {
+  // One player per thread, all made here: the chips fill their shared
+  // tables at the first use, which isn't safe to do by many threads
+  int threads = m_pool ? m_pool->Threads() : 1;
+  if(threads > count)
+    threads = count;
+  while((int)m_players.size() < threads) {
+    Player *p = new Player;
+    p->play = new CSMFPlay(m_rate, m_mods);
+    p->buffer.resize(BLOCK_FRAMES * m_frameSize);
+    m_players.push_back(p);
+    m_idle.push_back(p);
+  }
+
+  m_jobs = jobs;
+  if(m_pool) {
+    m_pool->Run(JobEntry, this, count);
+  } else {
+    for(int i=0; i<count; i++)
+      JobEntry(this, i);
+  }
+  m_jobs = NULL;
+
+  int failed = 0;
+  for(int i=0; i<count; i++) {
+    if(jobs[i].result < 0)
+      failed++;
+  }
+  return failed;
+}
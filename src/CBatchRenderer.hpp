@@ -0,0 +1,53 @@
+#ifndef __CBATCH_RENDERER_HPP__
+#define __CBATCH_RENDERER_HPP__
+#include <vector>
+#include "emu_de_midi.h"
+#include "CThread.hpp"
+
+namespace dsa {
+
+class CSMFPlay;
+class CWorkerPool;
+
+// Renders many songs offline on a pool of threads. Every job takes one
+// of the idle players and gives it back when done, so the next songs
+// reuse the players with their chips and buffers. There is one player
+// per thread.
+class CBatchRenderer {
+  struct Player {
+    CSMFPlay *play;
+    std::vector<UINT8> buffer;
+  };
+  enum { BLOCK_FRAMES = 4096 };
+
+  DWORD m_rate;
+  int m_mods;
+  EDMIDI_AudioFormat m_format;
+  UINT32 m_frameSize;
+  unsigned long m_maxFrames;   // 0 for the whole song
+  CWorkerPool *m_pool;
+  CMutex m_mutex;
+  std::vector<Player *> m_players;
+  std::vector<Player *> m_idle;
+  EDMIDI_BatchJob *m_jobs;
+
+  CBatchRenderer(const CBatchRenderer &);
+  CBatchRenderer &operator=(const CBatchRenderer &);
+
+  Player *TakePlayer();
+  void GivePlayer(Player *player);
+  void Render(EDMIDI_BatchJob &job, Player &player);
+  static void JobEntry(void *ctx, int index);
+public:
+  // The format must be an interleaved one
+  CBatchRenderer(DWORD rate, int mods, int threads,
+                 const EDMIDI_AudioFormat &format, double maxSeconds);
+  ~CBatchRenderer();
+
+  // Returns the count of the failed jobs
+  int Run(EDMIDI_BatchJob *jobs, int count);
+};
+
+} // namespace dsa
+
+#endif // __CBATCH_RENDERER_HPP__
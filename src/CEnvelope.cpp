@@ -91,6 +91,18 @@ bool CEnvelope::Update() {
   return true;
 }
 
+bool CEnvelope::IsFinished() const {
+  for(UINT ch=0; ch<m_ch; ch++) {
+    if(m_ci[ch].state != FINISH)
+      return false;
+  }
+  return true;
+}
+
+void CEnvelope::Skip(UINT32 samples) {
+  m_cnt = (m_cnt + samples * m_inc) & 0xFFFFFFF;
+}
+
 void CEnvelope::KeyOn(UINT ch) {
   m_ci[ch].value = 0;
   m_ci[ch].speed = _CalcSpeed(m_ci[ch].param.ar);
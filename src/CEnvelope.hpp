@@ -31,6 +31,10 @@ public:
   void KeyOn(UINT ch);
   void KeyOff(UINT ch);
   bool Update();
+  // Are all of the channels finished? Then only the counter needs to be
+  // stepped, which Skip() does for many samples at once.
+  bool IsFinished() const;
+  void Skip(UINT32 samples);
   void SetParam(UINT ch, const Param &param);
   UINT32 GetValue(UINT ch) const;
 };
@@ -457,6 +457,14 @@ RESULT CMIDIModule::Render(INT32 buf[2])
         return m_device->Render(buf);
 }
 
+RESULT CMIDIModule::RenderBlock(INT32 *buf, size_t frames)
+{
+    if(m_device == NULL)
+        return FAILURE;
+    else
+        return m_device->RenderBlock(buf, frames);
+}
+
 #if 0
 RESULT CMIDIModule::SendMIDIMsg(const CMIDIMsg &msg)
 {
@@ -88,6 +88,7 @@ public:
 
 // 音声のレンダリングを行う。
   RESULT Render(INT32 buf[2]);
+  RESULT RenderBlock(INT32 *buf, size_t frames);
 
   RESULT SetDrumChannel(int midi_ch, int enable);
 };
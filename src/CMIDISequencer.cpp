@@ -4,6 +4,22 @@
 #include "sequencer/midi_sequencer_impl.hpp"
 
 #include "CSMFPlay.hpp"
+#include "CStereoResampler.hpp"
+#include "CWorkerPool.hpp"
+
+/*
+ * SIMD kernels of the output conversions. Define EDMIDI_NO_SIMD to build the
+ * scalar ones only. They give exactly the same result as the scalar ones.
+ */
+#if !defined(EDMIDI_NO_SIMD)
+#   if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#       define MIX_SSE2
+#       include <emmintrin.h>
+#   elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#       define MIX_NEON
+#       include <arm_neon.h>
+#   endif
+#endif
 
 namespace dsa
 {
@@ -118,60 +134,265 @@ static size_t rtCurrentDevice(void *userdata, size_t track)
 void playSynth(void *userdata, uint8_t *stream, size_t length)
 {
     CSMFPlay *c = reinterpret_cast<CSMFPlay *>(userdata);
-    DWORD len = static_cast<DWORD>(length / 8);
-    int *buf = reinterpret_cast<int*>(stream);
-    INT32 b[2];
+    size_t len = length / 8;
+    int32_t *buf = reinterpret_cast<int32_t*>(stream);
 
-    for(DWORD q = 0; q < len; q++)
+    c->mixModules(buf, len);
+}
+
+// Clip the 32-bit mix into 16-bit samples
+static void mixToS16(const int32_t *src, short *dst, size_t count)
+{
+    size_t q = 0;
+#if defined(MIX_SSE2)
+    for(; q + 8 <= count; q += 8)
     {
-        buf[0] = buf[1] = 0;
-        for(int i = 0; i < c->m_mods; i++)
-        {
-            c->m_module[i].Render(b);
-            buf[0] += b[0];
-            buf[1] += b[1];
-        }
-        buf += 2;
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + q));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + q + 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + q), _mm_packs_epi32(a, b));
+    }
+#elif defined(MIX_NEON)
+    for(; q + 8 <= count; q += 8)
+    {
+        int16x4_t a = vqmovn_s32(vld1q_s32(src + q));
+        int16x4_t b = vqmovn_s32(vld1q_s32(src + q + 4));
+        vst1q_s16(dst + q, vcombine_s16(a, b));
+    }
+#endif
+    for(; q < count; q++)
+    {
+        int32_t x = src[q];
+        x = (x < -0x8000) ? -0x8000 : x;
+        x = (x > 0x7fff) ? 0x7fff : x;
+        dst[q] = (short)x;
+    }
+}
+
+// Scale the 32-bit mix into the float samples
+static void mixToF32(const int32_t *src, float *dst, size_t count)
+{
+    const float scale = 1.0f / 0x7fff;
+    size_t q = 0;
+#if defined(MIX_SSE2)
+    const __m128 vscale = _mm_set1_ps(scale);
+    for(; q + 4 <= count; q += 4)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + q));
+        _mm_storeu_ps(dst + q, _mm_mul_ps(_mm_cvtepi32_ps(a), vscale));
+    }
+#elif defined(MIX_NEON)
+    const float32x4_t vscale = vdupq_n_f32(scale);
+    for(; q + 4 <= count; q += 4)
+        vst1q_f32(dst + q, vmulq_f32(vcvtq_f32_s32(vld1q_s32(src + q)), vscale));
+#endif
+    for(; q < count; q++)
+        dst[q] = (float)src[q] * scale;
+}
+
+// Clip the 32-bit mix into 16 bits and scale it to the full 32-bit range
+static void mixToS32(int32_t *buf, size_t count)
+{
+    size_t q = 0;
+#if defined(MIX_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    for(; q + 8 <= count; q += 8)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buf + q));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buf + q + 4));
+        __m128i p = _mm_packs_epi32(a, b);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(buf + q), _mm_unpacklo_epi16(zero, p));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(buf + q + 4), _mm_unpackhi_epi16(zero, p));
+    }
+#elif defined(MIX_NEON)
+    for(; q + 4 <= count; q += 4)
+    {
+        int32x4_t x = vmovl_s16(vqmovn_s32(vld1q_s32(buf + q)));
+        vst1q_s32(buf + q, vshlq_n_s32(x, 16));
+    }
+#endif
+    for(; q < count; q++)
+    {
+        int32_t x = buf[q];
+        x = (x < -0x8000) ? -0x8000 : x;
+        x = (x > 0x7fff) ? 0x7fff : x;
+        buf[q] = (int32_t)((uint32_t)x << 16);
     }
 }
 
 void playSynthS16(void *userdata, uint8_t *stream, size_t length)
 {
     CSMFPlay *c = reinterpret_cast<CSMFPlay *>(userdata);
-    DWORD len = static_cast<DWORD>(length / 4);
+    size_t len = length / 4;
     short *buf = reinterpret_cast<short*>(stream);
-    INT32 b[2];
+    const size_t maxFrames = sizeof(c->m_mixBuf) / sizeof(int32_t) / 2;
 
-    for(DWORD q = 0; q < len; q++)
+    while(len > 0)
     {
-        buf[0] = buf[1] = 0;
-        for(int i = 0; i < c->m_mods; i++)
-        {
-            c->m_module[i].Render(b);
-            buf[0] += (short)b[0];
-            buf[1] += (short)b[1];
-        }
-        buf += 2;
+        size_t frames = len > maxFrames ? maxFrames : len;
+        c->mixModules(c->m_mixBuf, frames);
+        mixToS16(c->m_mixBuf, buf, frames * 2);
+
+        buf += frames * 2;
+        len -= frames;
     }
 }
 
 void playSynthF32(void *userdata, uint8_t *stream, size_t length)
 {
     CSMFPlay *c = reinterpret_cast<CSMFPlay *>(userdata);
-    DWORD len = static_cast<DWORD>(length / 8);
-    float *buf = reinterpret_cast<float*>(stream);
-    INT32 b[2];
+    size_t len = length / 8;
+
+    // Floats are as wide as the mix, so convert it in place
+    c->mixModules(reinterpret_cast<int32_t*>(stream), len);
+    mixToF32(reinterpret_cast<int32_t*>(stream), reinterpret_cast<float*>(stream), len * 2);
+}
+
+void playSynthS32(void *userdata, uint8_t *stream, size_t length)
+{
+    CSMFPlay *c = reinterpret_cast<CSMFPlay *>(userdata);
+    size_t len = length / 8;
+    int32_t *buf = reinterpret_cast<int32_t*>(stream);
+
+    c->mixModules(buf, len);
+    mixToS32(buf, len * 2);
+}
+
+void playSynthF32Planar(void *userdata, uint8_t *stream, size_t length)
+{
+    CSMFPlay *c = reinterpret_cast<CSMFPlay *>(userdata);
+    size_t len = length / 4;
+    float *left = reinterpret_cast<float*>(stream);
+    float *right = reinterpret_cast<float*>(c->m_planarRight + (stream - c->m_planarLeft));
+    const float scale = 1.0f / 0x7fff;
+    const size_t maxFrames = sizeof(c->m_mixBuf) / sizeof(int32_t) / 2;
 
-    for(DWORD q = 0; q < len; q++)
+    while(len > 0)
     {
-        buf[0] = buf[1] = 0;
-        for(int i = 0; i < c->m_mods; i++)
+        size_t frames = len > maxFrames ? maxFrames : len;
+        c->mixModules(c->m_mixBuf, frames);
+
+        for(size_t q = 0; q < frames; q++)
         {
-            c->m_module[i].Render(b);
-            buf[0] += (float)b[0] / 0x7fff;
-            buf[1] += (float)b[1] / 0x7fff;
+            left[q] = (float)c->m_mixBuf[q * 2] * scale;
+            right[q] = (float)c->m_mixBuf[q * 2 + 1] * scale;
         }
-        buf += 2;
+
+        left += frames;
+        right += frames;
+        len -= frames;
+    }
+}
+
+// Below this count of frames the threads cost more than they save
+#define MIN_PARALLEL_FRAMES 64
+
+void CSMFPlay::renderJob(void *ctx, int index)
+{
+    CSMFPlay *c = reinterpret_cast<CSMFPlay *>(ctx);
+    int32_t *buf = c->m_modBuf + index * MODBUF_FRAMES * 2;
+    std::memset(buf, 0, c->m_modFrames * 2 * sizeof(int32_t));
+    c->m_module[index].RenderBlock(buf, c->m_modFrames);
+}
+
+void CSMFPlay::renderModules(int32_t *buf, size_t frames)
+{
+    std::memset(buf, 0, frames * 2 * sizeof(int32_t));
+
+    if(!m_pool || m_pool->Threads() <= 1 || frames < MIN_PARALLEL_FRAMES)
+    {
+        for(int i = 0; i < m_mods; i++)
+            m_module[i].RenderBlock(buf, frames);
+        return;
+    }
+
+    while(frames > 0)
+    {
+        m_modFrames = frames > MODBUF_FRAMES ? MODBUF_FRAMES : frames;
+        m_pool->Run(renderJob, this, m_mods);
+
+        // Sum in the module order, the same as the serial path does
+        const size_t samples = m_modFrames * 2;
+        for(int i = 0; i < m_mods; i++)
+        {
+            const int32_t *src = m_modBuf + i * MODBUF_FRAMES * 2;
+            for(size_t q = 0; q < samples; q++)
+                buf[q] += src[q];
+        }
+
+        buf += samples;
+        frames -= m_modFrames;
+    }
+}
+
+void CSMFPlay::mixBlock(int32_t *buf, size_t frames)
+{
+    if(!m_resampler)
+    {
+        renderModules(buf, frames);
+        return;
+    }
+
+    while(frames > 0)
+    {
+        size_t outFrames = frames > m_busMaxFrames ? m_busMaxFrames : frames;
+        size_t busFrames = m_resampler->InputFrames(outFrames);
+
+        renderModules(m_busBuf, busFrames);
+
+        m_resampler->Process(m_busBuf, buf, outFrames);
+        buf += outFrames * 2;
+        frames -= outFrames;
+    }
+}
+
+void CSMFPlay::applyRtEvent(const CRtEventQueue::Entry &e)
+{
+    switch(e.status)
+    {
+    case 0x80:
+        rtNoteOff(this, e.channel, e.data1);
+        break;
+    case 0x90:
+        rtNoteOn(this, e.channel, e.data1, e.data2);
+        break;
+    case 0xA0:
+        rtNoteAfterTouch(this, e.channel, e.data1, e.data2);
+        break;
+    case 0xB0:
+        rtControllerChange(this, e.channel, e.data1, e.data2);
+        break;
+    case 0xC0:
+        rtPatchChange(this, e.channel, e.data1);
+        break;
+    case 0xD0:
+        rtChannelAfterTouch(this, e.channel, e.data1);
+        break;
+    case 0xE0:
+        rtPitchBend(this, e.channel, e.data1, e.data2);
+        break;
+    default:
+        break;
+    }
+}
+
+// Renders the block in pieces split at the frames of the real-time events
+void CSMFPlay::mixModules(int32_t *buf, size_t frames)
+{
+    while(frames > 0)
+    {
+        while(m_rtEvents.Due(m_rtClock))
+        {
+            applyRtEvent(m_rtEvents.Front());
+            m_rtEvents.Pop();
+        }
+
+        UINT32 limit = frames > 0x10000 ? 0x10000 : static_cast<UINT32>(frames);
+        UINT32 part = m_rtEvents.Until(m_rtClock, limit);
+
+        mixBlock(buf, part);
+        m_rtClock += part;
+        buf += part * 2;
+        frames -= part;
     }
 }
 
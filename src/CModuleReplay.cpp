@@ -0,0 +1,189 @@
+#include <cstring>
+#include "CModuleReplay.hpp"
+#include "CMIDIModule.hpp"
+#include "CWorkerPool.hpp"
+
+#if defined (_MSC_VER)
+#if defined (_DEBUG)
+#define new new( _CLIENT_BLOCK, __FILE__, __LINE__)
+#endif
+#endif
+
+using namespace dsa;
+
+const SoundDeviceInfo &CModuleReplay::Recorder::GetDeviceInfo() const {
+  return m_track.device->GetDeviceInfo();
+}
+
+RESULT CModuleReplay::Recorder::Reset() {
+  m_track.Log(CALL_RESET);
+  return SUCCESS;
+}
+
+RESULT CModuleReplay::Recorder::Render(INT32 buf[2]) {
+  buf[0] = buf[1] = 0;
+  m_track.Log(CALL_RENDER, 0, 0, 0, 1);
+  return SUCCESS;
+}
+
+RESULT CModuleReplay::Recorder::RenderBlock(INT32 *, size_t frames) {
+  m_track.Log(CALL_RENDER_BLOCK, 0, 0, 0, (UINT32)frames);
+  return SUCCESS;
+}
+
+void CModuleReplay::Recorder::SetProgram(UINT ch, UINT8 bank, UINT8 prog) { m_track.Log(CALL_PROGRAM, ch, bank, prog); }
+void CModuleReplay::Recorder::SetVelocity(UINT ch, UINT8 vel) { m_track.Log(CALL_VELOCITY, ch, vel); }
+void CModuleReplay::Recorder::SetPan(UINT ch, UINT8 pan) { m_track.Log(CALL_PAN, ch, pan); }
+void CModuleReplay::Recorder::SetVolume(UINT ch, UINT8 vol) { m_track.Log(CALL_VOLUME, ch, vol); }
+void CModuleReplay::Recorder::SetBend(UINT ch, INT8 coarse, INT8 fine) { m_track.Log(CALL_BEND, ch, (UINT8)coarse, (UINT8)fine); }
+void CModuleReplay::Recorder::KeyOn(UINT ch, UINT8 note) { m_track.Log(CALL_KEY_ON, ch, note); }
+void CModuleReplay::Recorder::KeyOff(UINT ch) { m_track.Log(CALL_KEY_OFF, ch); }
+void CModuleReplay::Recorder::PercKeyOn(UINT8 note) { m_track.Log(CALL_PERC_KEY_ON, note); }
+void CModuleReplay::Recorder::PercKeyOff(UINT8 note) { m_track.Log(CALL_PERC_KEY_OFF, note); }
+void CModuleReplay::Recorder::PercSetProgram(UINT8 bank, UINT8 prog) { m_track.Log(CALL_PERC_PROGRAM, bank, prog); }
+void CModuleReplay::Recorder::PercSetVelocity(UINT8 note, UINT8 vel) { m_track.Log(CALL_PERC_VELOCITY, note, vel); }
+void CModuleReplay::Recorder::PercSetVolume(UINT8 vol) { m_track.Log(CALL_PERC_VOLUME, vol); }
+
+const SoundDeviceInfo &CModuleReplay::Player::GetDeviceInfo() const {
+  return m_track.device->GetDeviceInfo();
+}
+
+RESULT CModuleReplay::Player::Render(INT32 buf[2]) {
+  buf[0] = buf[1] = 0;
+  m_track.Take(buf, 1);
+  return SUCCESS;
+}
+
+RESULT CModuleReplay::Player::RenderBlock(INT32 *buf, size_t frames) {
+  m_track.Take(buf, frames);
+  return SUCCESS;
+}
+
+void CModuleReplay::Track::Log(UINT8 type, UINT8 a, UINT8 b, UINT8 c, UINT32 frames) {
+  Call call;
+  call.type = type;
+  call.a = a;
+  call.b = b;
+  call.c = c;
+  call.frames = frames;
+  calls.push_back(call);
+}
+
+void CModuleReplay::Track::Replay(size_t frames, bool all) {
+  // Keep the frames not read yet at the start of the buffer
+  if(read > 0) {
+    std::memmove(&buf[0], &buf[read * 2], (fill - read) * 2 * sizeof(INT32));
+    fill -= read;
+    read = 0;
+  }
+
+  while(next < calls.size() && (all || fill < frames)) {
+    const Call &call = calls[next++];
+    switch(call.type) {
+    case CALL_RESET: device->Reset(); break;
+    case CALL_RENDER:
+    case CALL_RENDER_BLOCK:
+      if(all)
+        fill = 0; // Nobody will read them
+      if(buf.size() < (fill + call.frames) * 2)
+        buf.resize((fill + call.frames) * 2);
+      std::memset(&buf[fill * 2], 0, call.frames * 2 * sizeof(INT32));
+      if(call.type == CALL_RENDER)
+        device->Render(&buf[fill * 2]);
+      else
+        device->RenderBlock(&buf[fill * 2], call.frames);
+      fill += call.frames;
+      break;
+    case CALL_PROGRAM: device->SetProgram(call.a, call.b, call.c); break;
+    case CALL_VELOCITY: device->SetVelocity(call.a, call.b); break;
+    case CALL_PAN: device->SetPan(call.a, call.b); break;
+    case CALL_VOLUME: device->SetVolume(call.a, call.b); break;
+    case CALL_BEND: device->SetBend(call.a, (INT8)call.b, (INT8)call.c); break;
+    case CALL_KEY_ON: device->KeyOn(call.a, call.b); break;
+    case CALL_KEY_OFF: device->KeyOff(call.a); break;
+    case CALL_PERC_KEY_ON: device->PercKeyOn(call.a); break;
+    case CALL_PERC_KEY_OFF: device->PercKeyOff(call.a); break;
+    case CALL_PERC_PROGRAM: device->PercSetProgram(call.a, call.b); break;
+    case CALL_PERC_VELOCITY: device->PercSetVelocity(call.a, call.b); break;
+    case CALL_PERC_VOLUME: device->PercSetVolume(call.a); break;
+    }
+  }
+}
+
+void CModuleReplay::Track::Take(INT32 *out, size_t frames) {
+  while(frames > 0) {
+    if(read == fill) {
+      owner->Refill();
+      if(read == fill)
+        return; // The log has ended, the rest stays silent
+    }
+    size_t n = fill - read;
+    if(n > frames)
+      n = frames;
+    const INT32 *src = &buf[read * 2];
+    for(size_t q = 0; q < n * 2; q++)
+      out[q] += src[q];
+    out += n * 2;
+    read += n;
+    frames -= n;
+  }
+}
+
+void CModuleReplay::ReplayJob(void *ctx, int index) {
+  CModuleReplay *self = static_cast<CModuleReplay *>(ctx);
+  self->m_tracks[index]->Replay(WINDOW_FRAMES, self->m_finish);
+}
+
+// All the modules render the same frames, so the first one to run out
+// refills every track, and the windows of all chips run at once.
+void CModuleReplay::Refill() {
+  const int count = (int)m_tracks.size();
+  if(m_pool) {
+    m_pool->Run(ReplayJob, this, count);
+  } else {
+    for(int i=0; i<count; i++)
+      ReplayJob(this, i);
+  }
+}
+
+CModuleReplay::CModuleReplay(CMIDIModule *modules, int count, int threads)
+  : m_modules(modules), m_pool(NULL), m_finish(false) {
+  for(int i=0; i<count; i++)
+    m_tracks.push_back(new Track(this, modules[i].DetachDevice()));
+  if(threads > count)
+    threads = count;
+  if(threads > 1)
+    m_pool = new CWorkerPool(threads);
+}
+
+CModuleReplay::~CModuleReplay() {
+  // The chips take the calls which came after the last played block
+  m_finish = true;
+  Refill();
+  for(size_t i=0; i<m_tracks.size(); i++) {
+    m_modules[i].DetachDevice();
+    m_modules[i].AttachDevice(m_tracks[i]->device);
+    delete m_tracks[i];
+  }
+  if(m_pool)
+    delete m_pool;
+}
+
+void CModuleReplay::Record() {
+  for(size_t i=0; i<m_tracks.size(); i++) {
+    m_modules[i].DetachDevice();
+    m_modules[i].AttachDevice(&m_tracks[i]->recorder);
+  }
+}
+
+void CModuleReplay::Play() {
+  for(size_t i=0; i<m_tracks.size(); i++) {
+    m_modules[i].DetachDevice();
+    m_modules[i].AttachDevice(&m_tracks[i]->player);
+  }
+}
+
+void CModuleReplay::Discard() {
+  for(size_t i=0; i<m_tracks.size(); i++)
+    m_tracks[i]->next = m_tracks[i]->calls.size();
+}
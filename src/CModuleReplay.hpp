@@ -0,0 +1,125 @@
+#ifndef __CMODULE_REPLAY_HPP__
+#define __CMODULE_REPLAY_HPP__
+#include <vector>
+#include "ISoundDevice.hpp"
+
+namespace dsa {
+
+class CMIDIModule;
+class CWorkerPool;
+
+// Renders the chips of the modules in parallel over long windows of time.
+// The song is played twice. First the modules get the recording devices,
+// which only log the calls of every module with the blocks it rendered.
+// Then the modules get the playing devices, whose blocks are cut out of
+// what the real devices made by replaying the logs on the worker pool.
+// The logs keep the blocks as they were, so every chip renders the same
+// samples as when the song is played once.
+class CModuleReplay {
+  struct Call {
+    UINT8 type;
+    UINT8 a, b, c;
+    UINT32 frames;  // Of the rendered blocks
+  };
+  enum CallType {
+    CALL_RESET, CALL_RENDER, CALL_RENDER_BLOCK,
+    CALL_PROGRAM, CALL_VELOCITY, CALL_PAN, CALL_VOLUME, CALL_BEND,
+    CALL_KEY_ON, CALL_KEY_OFF,
+    CALL_PERC_KEY_ON, CALL_PERC_KEY_OFF, CALL_PERC_PROGRAM,
+    CALL_PERC_VELOCITY, CALL_PERC_VOLUME
+  };
+  enum { WINDOW_FRAMES = 32768 }; // Frames to replay per one run of the pool
+
+  class Track;
+
+  // Logs the calls, the chip stays untouched
+  class Recorder : public ISoundDevice {
+    Track &m_track;
+  public:
+    Recorder(Track &track) : m_track(track) {}
+    const SoundDeviceInfo &GetDeviceInfo(void) const;
+    RESULT Reset(void);
+    RESULT Render(INT32 buf[2]);
+    RESULT RenderBlock(INT32 *buf, size_t frames);
+    void SetProgram(UINT ch, UINT8 bank, UINT8 prog);
+    void SetVelocity(UINT ch, UINT8 vel);
+    void SetPan(UINT ch, UINT8 pan);
+    void SetVolume(UINT ch, UINT8 vol);
+    void SetBend(UINT ch, INT8 coarse, INT8 fine);
+    void KeyOn(UINT ch, UINT8 note);
+    void KeyOff(UINT ch);
+    void PercKeyOn(UINT8 note);
+    void PercKeyOff(UINT8 note);
+    void PercSetProgram(UINT8 bank, UINT8 prog);
+    void PercSetVelocity(UINT8 note, UINT8 vel);
+    void PercSetVolume(UINT8 vol);
+  };
+
+  // Hands out the replayed frames, the calls are already in the log
+  class Player : public ISoundDevice {
+    Track &m_track;
+  public:
+    Player(Track &track) : m_track(track) {}
+    const SoundDeviceInfo &GetDeviceInfo(void) const;
+    RESULT Reset(void) { return SUCCESS; }
+    RESULT Render(INT32 buf[2]);
+    RESULT RenderBlock(INT32 *buf, size_t frames);
+    void SetProgram(UINT, UINT8, UINT8) {}
+    void SetVelocity(UINT, UINT8) {}
+    void SetPan(UINT, UINT8) {}
+    void SetVolume(UINT, UINT8) {}
+    void SetBend(UINT, INT8, INT8) {}
+    void KeyOn(UINT, UINT8) {}
+    void KeyOff(UINT) {}
+    void PercKeyOn(UINT8) {}
+    void PercKeyOff(UINT8) {}
+    void PercSetProgram(UINT8, UINT8) {}
+    void PercSetVelocity(UINT8, UINT8) {}
+    void PercSetVolume(UINT8) {}
+  };
+
+  // One module with its real device, the log and the replayed frames
+  class Track {
+  public:
+    CModuleReplay *owner;
+    ISoundDevice *device;
+    Recorder recorder;
+    Player player;
+    std::vector<Call> calls;
+    size_t next;               // Next call to replay
+    std::vector<INT32> buf;    // Replayed frames, interleaved
+    size_t read, fill;         // In frames
+
+    Track(CModuleReplay *o, ISoundDevice *d)
+      : owner(o), device(d), recorder(*this), player(*this), next(0), read(0), fill(0) {}
+    void Log(UINT8 type, UINT8 a = 0, UINT8 b = 0, UINT8 c = 0, UINT32 frames = 0);
+    // Replay the calls until `frames` frames wait to be read, or all of them
+    void Replay(size_t frames, bool all);
+    void Take(INT32 *out, size_t frames);
+  };
+
+  CMIDIModule *m_modules;
+  std::vector<Track *> m_tracks;
+  CWorkerPool *m_pool;
+  bool m_finish;
+
+  CModuleReplay(const CModuleReplay &);
+  CModuleReplay &operator=(const CModuleReplay &);
+
+  void Refill();
+  static void ReplayJob(void *ctx, int index);
+public:
+  // Takes the devices of the modules until destroyed
+  CModuleReplay(CMIDIModule *modules, int count, int threads);
+  // Replays the rest of the logs, and gives the devices back
+  ~CModuleReplay();
+
+  void Record();
+  void Play();
+  // Drops the rest of the logs, the devices stay as they are
+  void Discard();
+};
+
+} // namespace dsa
+
+#endif // __CMODULE_REPLAY_HPP__
@@ -80,67 +80,85 @@ static BYTE perc_table[128] =
    0, 0, 0, 0, 0, 0, 0, 0  //120- 
 };
 
+// Pseudo registers 0x40-0x48 carry the pan of the tone channels
+#define PAN_REG 0x40
+
+// Longest run of samples rendered before the silence of the chip is checked
+#define GATE_PERIOD 1024
+
+// Stereo gains per MIDI pan value: 3dB per 4 steps off the center, like
+// the volume register attenuation used by the older two-chip output.
+static float pan_table[128][2];
+static bool pan_table_initialized = false;
+
+static void makePanTable(void) {
+  for(int i=0;i<128;i++) {
+    double l = (64<i) ? 0.75*(i-64) : 0.0; // dB
+    double r = (i<64) ? 0.75*(64-i) : 0.0;
+    pan_table[i][0] = (float)pow(10.0,-l/20);
+    pan_table[i][1] = (float)pow(10.0,-r/20);
+  }
+  pan_table_initialized = true;
+}
+
 COpllDevice::COpllDevice(DWORD rate, UINT nch) : ISoundDevice(),
-    m_rbuf(2, RBuf(8200))
+    m_time(0), m_silent(false)
 {
 
   if(nch==2) 
     m_nch = 2;
   else 
     m_nch = 1;
-  
-  for(UINT i=0;i<m_nch;i++) {
-    m_opll[i] = OPLL_new(3579545,rate);
-    memset(m_reg_cache[i],0,128);
-    m_rbuf[i].clear();
-  }
+
+  if(!pan_table_initialized)
+    makePanTable();
+
+  // The stereo output is mixed by the chip from the per-channel pan gains
+  m_opll = OPLL_new(3579545,rate);
+  memset(m_reg_cache,0,128);
 
   COpllDevice::Reset();
 }
 
 COpllDevice::~COpllDevice() {
-  for(UINT i=0;i<m_nch;i++) {
-    m_rbuf[i].clear();
-    OPLL_delete(m_opll[i]);
-  }
+  OPLL_delete(m_opll);
 }
 
 const SoundDeviceInfo &
 COpllDevice::GetDeviceInfo(void) const {
-  static SoundDeviceInfo si;
-  si.name = (BYTE *)"OPLL Module";
-  si.desc = (BYTE *)"(C) Mitsutaka Okazaki 2004" __FILE__;
-  si.version = 0x0001;
-  si.max_ch = 6;
+  // Filled once: the players of other threads may ask at the same time
+  static const SoundDeviceInfo si = {
+    (BYTE *)"OPLL Module", (BYTE *)"(C) Mitsutaka Okazaki 2004" __FILE__, 6, 0x0001
+  };
   return si;
 }
 
 RESULT COpllDevice::Reset() {
 
-  {
-  for(UINT i=0;i<m_nch;i++) {
-    OPLL_reset(m_opll[i]);
-    OPLL_set_quality(m_opll[i],1);
-    // Rhythm Initial Value
-    _WriteReg(0x16,0x20,i);
-    _WriteReg(0x26,0x05,i);
-    _WriteReg(0x17,0x50,i);
-    _WriteReg(0x27,0x05,i);
-    _WriteReg(0x18,0xC0,i);
-    _WriteReg(0x28,0x01,i);
-    // Original Voice
-    _WriteReg(0x00,0x61,i);
-    _WriteReg(0x01,0x61,i);
-    _WriteReg(0x02,0x03,i);
-    _WriteReg(0x03,0x0D,i);
-    _WriteReg(0x04,0xf9,i);
-    _WriteReg(0x05,0xf4,i);
-    _WriteReg(0x06,0x37,i);
-    _WriteReg(0x07,0x27,i);
-    memset(m_reg_cache[i],0,128);
-    m_rbuf[i].clear();
-  }
-  }
+  m_wq.Clear();
+  m_silent = false;
+
+  OPLL_reset(m_opll);
+  OPLL_set_quality(m_opll,1);
+  // Rhythm Initial Value
+  _WriteReg(0x16,0x20);
+  _WriteReg(0x26,0x05);
+  _WriteReg(0x17,0x50);
+  _WriteReg(0x27,0x05);
+  _WriteReg(0x18,0xC0);
+  _WriteReg(0x28,0x01);
+  // Original Voice
+  _WriteReg(0x00,0x61);
+  _WriteReg(0x01,0x61);
+  _WriteReg(0x02,0x03);
+  _WriteReg(0x03,0x0D);
+  _WriteReg(0x04,0xf9);
+  _WriteReg(0x05,0xf4);
+  _WriteReg(0x06,0x37);
+  _WriteReg(0x07,0x27);
+  memset(m_reg_cache,0,128);
+  // The chip resets the pan gains to the center
+  memset(m_reg_cache+PAN_REG,64,9);
 
   for(int i=0; i<9; i++) {
     m_ci[i].bend_coarse = 0;
@@ -168,42 +186,71 @@ RESULT COpllDevice::Reset() {
   return SUCCESS;
 }
 
-void COpllDevice::_WriteReg(BYTE reg, BYTE val, INT pan) {
-
-  if(m_nch==2) {
-    if(pan<0||1<pan) {
-      _WriteReg(reg,val,1);
-      pan = 0;
-    }
-  } else pan = 0;
+void COpllDevice::_WriteReg(BYTE reg, BYTE val) {
 
-  if(m_reg_cache[pan][reg]!=val) {
-    OPLL_writeReg(m_opll[pan], reg, val);
-    m_reg_cache[pan][reg] = val;
-  
-    if(m_rbuf[pan].size() > 8185)
-        m_rbuf[pan].pop_front();// Clean-up the fill buffer from off the junk
-    // At least one calc() method must be invoked between two sequence of writeReg().
-    if(m_rbuf[pan].size()<8192) {
-      m_rbuf[pan].push_back( OPLL_calc(m_opll[pan]) );
-    } else {
-      throw RuntimeException("Buffer Overflow",__FILE__,__LINE__);
+  if(m_reg_cache[reg]!=val) {
+    // The queue is full: apply the oldest write ahead of its time
+    if(m_wq.Full()) {
+      const CRegWriteQueue::Entry &e = m_wq.Front();
+      _ApplyReg(e.reg, e.val);
+      m_wq.Pop();
     }
+    m_wq.Push(m_time, reg, val, 0);
+    m_reg_cache[reg] = val;
   } 
 }
 
+void COpllDevice::_ApplyReg(BYTE reg, BYTE val) {
+  m_silent = false;
+  if(reg<PAN_REG)
+    OPLL_writeReg(m_opll, reg, val);
+  else
+    OPLL_setPanFine(m_opll, reg-PAN_REG, pan_table[val&0x7F]);
+}
+
+void COpllDevice::_ApplyWrites(void) {
+  // The chip core latches every write on its own, so the writes due
+  // at the same sample don't need a calc() in between.
+  while(m_wq.Due(m_time)) {
+    const CRegWriteQueue::Entry &e = m_wq.Front();
+    _ApplyReg(e.reg, e.val);
+    m_wq.Pop();
+  }
+}
+
 RESULT COpllDevice::Render(INT32 buf[2]) {
+  buf[0] = buf[1] = 0;
+  return RenderBlock(buf, 1);
+}
 
-  for(UINT i=0;i<m_nch;i++) {
-    if(m_rbuf[i].empty())
-      buf[i] = OPLL_calc(m_opll[i]);
-    else {
-      buf[i] = m_rbuf[i].front().value;
-      m_rbuf[i].pop_front();
+RESULT COpllDevice::RenderBlock(INT32 *buf, size_t frames) {
+
+  while(frames > 0) {
+    _ApplyWrites();
+
+    // Render the run of samples until the next pending write
+    UINT32 limit = m_silent ? 0x10000 : GATE_PERIOD;
+    UINT32 run = m_wq.Until(m_time, frames > limit ? limit : (UINT32)frames);
+
+    if(m_silent) {
+      // All zeros until the next write: skip the chip
+      buf += run * 2;
+    } else if(m_nch<2) {
+      for(UINT32 n=0; n<run; n++, buf+=2) {
+        INT32 v = OPLL_calc(m_opll);
+        buf[0] += v;
+        buf[1] += v;
+      }
+      m_silent = OPLL_isSilent(m_opll) != 0;
+    } else {
+      OPLL_calcStereoBlock(m_opll, buf, run);
+      buf += run * 2;
+      m_silent = OPLL_isSilent(m_opll) != 0;
     }
+
+    m_time += run;
+    frames -= run;
   }
-  if(m_nch<2) 
-    buf[1] = buf[0];
   return SUCCESS;
 
 }
@@ -213,32 +260,13 @@ void COpllDevice::_UpdateVolume(UINT ch) {
   INT att = 14 - m_ci[ch].volume/16 - m_ci[ch].velocity/16 + prog_att[m_ci[ch].program];
   if(att<0) att = 0; else if(15<att) att = 15;
 
-  if(m_nch<2) {
-    _WriteReg(0x30+ch,att|((m_ci[ch].program)<<4));
-    return;
-  }
-
-  // LEFT CHANNEL
-  if(64<m_ci[ch].pan) {
-    int tmp = att + (m_ci[ch].pan-64)/4;
-    _WriteReg(0x30+ch,((tmp<15)?tmp:15)|((m_ci[ch].program)<<4),0);
-  } else {
-    _WriteReg(0x30+ch,att|((m_ci[ch].program)<<4),0);
-  }
-
-  // RIGHT CHANNEL
-  if(m_ci[ch].pan<64) {
-    int tmp = att + (63-m_ci[ch].pan)/4;
-    _WriteReg(0x30+ch,((tmp<15)?tmp:15)|((m_ci[ch].program)<<4),1);
-  } else {
-    _WriteReg(0x30+ch,att|((m_ci[ch].program)<<4),1);
-  }
-
+  _WriteReg(0x30+ch,att|((m_ci[ch].program)<<4));
 }
 
 void COpllDevice::SetPan(UINT ch, UINT8 pan) {
   m_ci[ch].pan = pan;
-  _UpdateVolume(ch);
+  if(m_nch==2)
+    _WriteReg(PAN_REG+ch,pan);
 }
 
 void COpllDevice::_UpdateFreq(UINT ch) {
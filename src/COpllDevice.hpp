@@ -1,9 +1,8 @@
 #ifndef __CDeviceOpll_H__
 #define __CDeviceOpll_H__
-#include "structures/pl_list.hpp"
-#include <vector>
-
+#include <stdint.h>
 #include "ISoundDevice.hpp"
+#include "CRegWriteQueue.hpp"
 
 namespace dsa {
 
@@ -37,17 +36,21 @@ public:
   };
 private:
   UINT m_nch;
-  C::OPLL *m_opll[2];
-  BYTE m_reg_cache[2][0x80];
+  C::OPLL *m_opll;
+  BYTE m_reg_cache[0x80];
   ChannelInfo m_ci[9];
   PercInfo m_pi;
-  typedef pl_list<INT32> RBuf;
-  std::vector<RBuf> m_rbuf; // The rendering buffer
+  CRegWriteQueue m_wq; // Register writes waiting for their sample
+  UINT32 m_time;       // Count of rendered samples
+  bool m_silent;       // Nothing sounds until the next register write
+
+  void _ApplyReg(BYTE reg, BYTE val);
+  void _ApplyWrites(void);
 
   void _UpdateFreq(UINT ch);
   void _UpdateVolume(UINT ch);
   void _PercUpdateVolume(BYTE note);
-  void _WriteReg(BYTE reg, BYTE val, INT pan=-1);
+  void _WriteReg(BYTE reg, BYTE val);
 
 public:
   COpllDevice(DWORD rate=44100, UINT nch=2);
@@ -56,6 +59,7 @@ public:
   const SoundDeviceInfo &GetDeviceInfo(void) const;
   RESULT Reset(void);
   RESULT Render(INT32 buf[2]);
+  RESULT RenderBlock(INT32 *buf, size_t frames);
 
   void SetProgram(UINT ch, UINT8 bank, UINT8 prog);
   void SetVelocity(UINT ch, UINT8 vel);
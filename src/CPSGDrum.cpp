@@ -6,13 +6,16 @@ using namespace dsa;
 using namespace dsa::C;
 
 
+// Longest run of samples rendered before the silence of the chips is checked
+#define GATE_PERIOD 1024
+
 static CPSGDrum::Instrument inst_table[128] = {
   // { NOTE, VOL, MODE, { AR, DR, SL, SR, RR } }
      {  48,   2,   1,  {  0,  20,  0,  0, 20 } }, // BD
      {  60,  -2,   2,  {  0,  80,  0,  0, 80 } }, // SD
 };
 
-CPSGDrum::CPSGDrum(DWORD rate, UINT nch) : ISoundDevice(), m_on_channels(128), m_off_channels(128), m_env(6), m_rbuf(2, RBuf(10960)) {
+CPSGDrum::CPSGDrum(DWORD rate, UINT nch) : ISoundDevice(), m_on_channels(128), m_off_channels(128), m_env(6), m_time(0), m_silent(false) {
 
   if(nch==2) m_nch = 2; else m_nch = 1;
   m_rate = rate;
@@ -39,11 +42,13 @@ RESULT CPSGDrum::Reset() {
   for(UINT i=0;i<2; i++) {
     PSG_reset(m_psg[i]);
     PSG_set_quality(m_psg[i],1);
-    memset(m_reg_cache[i],0,128);
-    m_rbuf[i].clear();
+    memset(m_reg_cache[i],0,sizeof(m_reg_cache[i]));
     m_noise_mode[i] = 0xFF;
   }
 
+  m_wq.Clear();
+  m_silent = false;
+
   m_env.Reset();
   m_off_channels.clear();
   m_on_channels.clear();
@@ -65,45 +70,72 @@ RESULT CPSGDrum::Reset() {
 
 void CPSGDrum::_WriteReg(BYTE reg, BYTE val, UINT id) {
   if(m_reg_cache[id][reg]!=val) {
-    PSG_writeReg(m_psg[id], reg, val);
-    m_reg_cache[id][reg] = val;  
-    if(m_rbuf[id].size()<8192) {
-      m_rbuf[id].push_back(PSG_calc(m_psg[id])<<16);
-      if(m_env.Update()) {
-        for(int ch=0;ch<6;ch++) _UpdateVolume(ch);
-      }
-    } else {
-      throw RuntimeException("Buffer Overflow",__FILE__,__LINE__);
+    // The queue is full: apply the oldest write ahead of its time
+    if(m_wq.Full()) {
+      const CRegWriteQueue::Entry &e = m_wq.Front();
+      PSG_writeReg(m_psg[e.id], e.reg, e.val);
+      m_wq.Pop();
+      m_silent = false;
     }
+    m_wq.Push(m_time, reg, val, (UINT8)id);
+    m_reg_cache[id][reg] = val;  
   } 
 }
 
+void CPSGDrum::_ApplyWrites(void) {
+  while(m_wq.Due(m_time)) {
+    const CRegWriteQueue::Entry &e = m_wq.Front();
+    PSG_writeReg(m_psg[e.id], e.reg, e.val);
+    m_wq.Pop();
+    m_silent = false;
+  }
+}
+
 const SoundDeviceInfo &
 CPSGDrum::GetDeviceInfo(void) const {
 
-  static SoundDeviceInfo si;
-  si.max_ch = 0;
-  si.version = 0x0001;
-  si.name = (BYTE *)"PSG DRUM";
-  si.desc = (BYTE *)"";
+  static const SoundDeviceInfo si = { (BYTE *)"PSG DRUM", (BYTE *)"", 0, 0x0001 };
   return si;
 }
 
 RESULT CPSGDrum::Render(INT32 buf[2]) {
+  buf[0] = buf[1] = 0;
+  return RenderBlock(buf, 1);
+}
+
+RESULT CPSGDrum::RenderBlock(INT32 *buf, size_t frames) {
+
+  while(frames > 0) {
+    _ApplyWrites();
 
-  buf[0] = 0;
-  for(UINT i=0;i<2;i++) {
-    if(m_rbuf[i].empty()) {
-      buf[0] += PSG_calc(m_psg[i]) << 16;
+    if(m_silent) {
+      // All zeros until the next write: skip the chips
+      UINT32 run = m_wq.Until(m_time, frames > 0x10000 ? 0x10000 : (UINT32)frames);
+      m_env.Skip(run);
+      m_time += run;
+      buf += run * 2;
+      frames -= run;
+      continue;
+    }
+
+    size_t run = frames > GATE_PERIOD ? GATE_PERIOD : frames;
+    for(size_t n=0; n<run; n++, buf+=2) {
+      _ApplyWrites();
+      INT32 v = (PSG_calc(m_psg[0]) << 16) + (PSG_calc(m_psg[1]) << 16);
+      v <<= 1;
+      buf[0] += v;
+      buf[1] += v;
+      m_time++;
       if(m_env.Update()) {
         for(int ch=0;ch<6;ch++) _UpdateVolume(ch);
       }
-    } else
-      buf[0] += m_rbuf[i].front().value;
-    m_rbuf[i].pop_front();
+    }
+    frames -= run;
+
+    m_silent = m_env.IsFinished();
+    for(UINT i=0; i<2 && m_silent; i++)
+      m_silent = PSG_isSilent(m_psg[i]) != 0;
   }
-  buf[0]<<=1;
-  buf[1] = buf[0];
 
   return SUCCESS;
 }
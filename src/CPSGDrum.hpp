@@ -1,6 +1,5 @@
 #ifndef __CPSG_DRUM_HPP__
 #include "structures/pl_list.hpp"
-#include <vector>
 
 namespace dsa {
     namespace C {
@@ -10,6 +9,7 @@ namespace dsa {
 #include "DsaCommon.hpp"
 #include "ISoundDevice.hpp"
 #include "CEnvelope.hpp"
+#include "CRegWriteQueue.hpp"
 
 namespace dsa {
 
@@ -46,19 +46,22 @@ private:
   UINT8 m_volume;
   UINT8 m_velocity[128];
   INT m_keytable[128];
-  typedef pl_list<INT32> RBuf;
-  std::vector<RBuf> m_rbuf; // The rendering buffer
+  CRegWriteQueue m_wq; // Register writes waiting for their sample
+  UINT32 m_time;       // Count of rendered samples
+  bool m_silent;       // Nothing sounds until the next register write
   void _UpdateMode(UINT ch);
   void _UpdateVolume(UINT ch);
   void _UpdateFreq(UINT ch);
   void _UpdateProgram(UINT ch);
   void _WriteReg(BYTE reg, BYTE val, UINT id);
+  void _ApplyWrites(void);
 public:
   explicit CPSGDrum(DWORD rate=44100, UINT m_nch=1);
   virtual ~CPSGDrum();
   const SoundDeviceInfo &GetDeviceInfo(void) const;
   RESULT Reset(void);
   RESULT Render(INT32 buf[2]);
+  RESULT RenderBlock(INT32 *buf, size_t frames);
 
   void PercKeyOn(UINT8 note);
   void PercKeyOff(UINT8 note);
@@ -0,0 +1,86 @@
+#ifndef __CPCM_RING_HPP__
+#define __CPCM_RING_HPP__
+#include <cstring>
+#include "CAtomic.hpp"
+
+namespace dsa {
+
+// Ring buffer of the PCM frames which one thread renders ahead and the
+// other one copies out, shared the same way as CLockFreeQueue. The
+// producer renders right into the free part of the buffer, the consumer
+// copies out with memcpy only.
+class CPcmRing {
+  UINT8 *m_buf;
+  UINT32 m_frames;           // Capacity, a power of two
+  UINT32 m_frameSize;        // Bytes per frame
+  volatile UINT32 m_head;    // Written by the consumer only
+  volatile UINT32 m_tail;    // Written by the producer only
+
+  CPcmRing(const CPcmRing &);
+  CPcmRing &operator=(const CPcmRing &);
+public:
+  CPcmRing() : m_buf(NULL), m_frames(0), m_frameSize(0), m_head(0), m_tail(0) {}
+  ~CPcmRing() { Free(); }
+
+  enum { MAX_FRAMES = 1 << 20 };
+
+  // Not while any of the threads uses the ring. Fails on more frames than
+  // MAX_FRAMES, or on a buffer too large to address
+  bool Init(UINT32 frames, UINT32 frameSize) {
+    Free();
+    if(frames > MAX_FRAMES || frameSize == 0)
+      return false;
+    UINT32 count = 1;
+    while(count < frames)
+      count <<= 1;
+    if(count > ((size_t)-1) / frameSize)
+      return false;
+    m_frames = count;
+    m_frameSize = frameSize;
+    m_buf = new UINT8[(size_t)m_frames * frameSize];
+    m_head = m_tail = 0;
+    return true;
+  }
+
+  void Free() {
+    if(m_buf)
+      delete[] m_buf;
+    m_buf = NULL;
+    m_frames = 0;
+  }
+
+  UINT32 Capacity() const { return m_frames; }
+
+  // Any thread: the count of frames rendered, but not copied out yet
+  UINT32 Fill() const { return AtomicLoad(&m_tail) - AtomicLoad(&m_head); }
+
+  // Producer: the free part which follows the tail without wrapping
+  UINT8 *WritePtr(UINT32 &frames) {
+    const UINT32 tail = m_tail;
+    const UINT32 pos = tail & (m_frames - 1);
+    const UINT32 space = m_frames - (tail - AtomicLoad(&m_head));
+    frames = (m_frames - pos < space) ? m_frames - pos : space;
+    return m_buf + pos * m_frameSize;
+  }
+
+  void Commit(UINT32 frames) { AtomicStore(&m_tail, m_tail + frames); }
+
+  // Consumer: copies out up to the given count of frames, returns the
+  // count of copied ones
+  UINT32 Read(UINT8 *out, UINT32 frames) {
+    const UINT32 head = m_head;
+    const UINT32 fill = AtomicLoad(&m_tail) - head;
+    if(frames > fill)
+      frames = fill;
+    const UINT32 pos = head & (m_frames - 1);
+    const UINT32 first = (m_frames - pos < frames) ? m_frames - pos : frames;
+    std::memcpy(out, m_buf + pos * m_frameSize, first * m_frameSize);
+    std::memcpy(out + first * m_frameSize, m_buf, (frames - first) * m_frameSize);
+    AtomicStore(&m_head, head + frames);
+    return frames;
+  }
+};
+
+} // namespace dsa
+
+#endif // __CPCM_RING_HPP__
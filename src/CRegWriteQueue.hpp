@@ -0,0 +1,60 @@
+#ifndef __CREG_WRITE_QUEUE_HPP__
+#define __CREG_WRITE_QUEUE_HPP__
+#include "DsaCommon.hpp"
+
+namespace dsa {
+
+// Ring buffer of the register writes stamped with the sample clock of
+// the device. The device applies each write right before rendering the
+// sample it is stamped with.
+class CRegWriteQueue {
+public:
+  struct Entry {
+    UINT32 time;
+    UINT8 reg;
+    UINT8 val;
+    UINT8 id;   // Chip index inside of the device
+  };
+  enum { SIZE = 4096 }; // Must be a power of two
+private:
+  Entry m_buf[SIZE];
+  UINT32 m_head, m_tail;
+public:
+  CRegWriteQueue() : m_head(0), m_tail(0) {}
+
+  void Clear() { m_head = m_tail = 0; }
+  bool Empty() const { return m_head == m_tail; }
+  bool Full() const { return (m_tail - m_head) == SIZE; }
+
+  void Push(UINT32 time, UINT8 reg, UINT8 val, UINT8 id) {
+    Entry &e = m_buf[m_tail & (SIZE - 1)];
+    e.time = time;
+    e.reg = reg;
+    e.val = val;
+    e.id = id;
+    m_tail++;
+  }
+
+  const Entry &Front() const { return m_buf[m_head & (SIZE - 1)]; }
+  void Pop() { m_head++; }
+
+  // Is the oldest write due at the given sample clock?
+  bool Due(UINT32 now) const {
+    return !Empty() && (INT32)(Front().time - now) <= 0;
+  }
+
+  // Count of samples which can be rendered from `now` before the next
+  // write is due, but not more than `limit`.
+  UINT32 Until(UINT32 now, UINT32 limit) const {
+    if(Empty())
+      return limit;
+    INT32 d = (INT32)(Front().time - now);
+    if(d <= 0)
+      return 0;
+    return ((UINT32)d < limit) ? (UINT32)d : limit;
+  }
+};
+
+} // namespace dsa
+
+#endif // __CREG_WRITE_QUEUE_HPP__
@@ -0,0 +1,77 @@
+#ifndef __CRT_EVENT_QUEUE_HPP__
+#define __CRT_EVENT_QUEUE_HPP__
+#include "CAtomic.hpp"
+
+namespace dsa {
+
+// Queue of the real-time MIDI events which one thread pushes and the
+// rendering thread plays, over CLockFreeQueue.
+//
+// Every event is pushed with its offset in frames from the start of the
+// next rendered block. The consumer latches the pushed events at the
+// start of every block, which turns their offsets into the times of the
+// sample clock of the renderer, and plays each of them right before
+// rendering the frame it is due at.
+class CRtEventQueue {
+public:
+  struct Entry {
+    UINT32 time;   // Offset until latched, then the time at the clock
+    UINT8 status;  // MIDI status without the channel
+    UINT8 channel;
+    UINT8 data1;
+    UINT8 data2;
+  };
+  enum { SIZE = 1024 }; // Must be a power of two
+private:
+  CLockFreeQueue<Entry, SIZE> m_queue;
+  UINT32 m_latched;          // Consumer: the count of the latched entries
+
+  CRtEventQueue(const CRtEventQueue &);
+  CRtEventQueue &operator=(const CRtEventQueue &);
+
+public:
+  CRtEventQueue() : m_latched(0) {}
+
+  // Producer: fails when the consumer hasn't played enough events yet
+  bool Push(UINT32 offset, UINT8 status, UINT8 channel, UINT8 data1, UINT8 data2) {
+    Entry e;
+    e.time = offset;
+    e.status = status;
+    e.channel = channel;
+    e.data1 = data1;
+    e.data2 = data2;
+    return m_queue.Push(e);
+  }
+
+  // Consumer: takes the events pushed since the last call, `now` is the
+  // time at the clock of the first frame of the block to render
+  void Latch(UINT32 now) {
+    const UINT32 count = m_queue.Count();
+    for(; m_latched != count; m_latched++)
+      m_queue.Peek(m_latched).time += now;
+  }
+
+  bool Empty() const { return m_latched == 0; }
+  const Entry &Front() const { return m_queue.Front(); }
+  void Pop() { m_queue.Pop(); m_latched--; }
+
+  // Is the oldest latched event due at the given sample clock?
+  bool Due(UINT32 now) const {
+    return !Empty() && (INT32)(Front().time - now) <= 0;
+  }
+
+  // Count of frames which can be rendered from `now` before the next
+  // event is due, but not more than `limit`.
+  UINT32 Until(UINT32 now, UINT32 limit) const {
+    if(Empty())
+      return limit;
+    INT32 d = (INT32)(Front().time - now);
+    if(d <= 0)
+      return 0;
+    return ((UINT32)d < limit) ? (UINT32)d : limit;
+  }
+};
+
+} // namespace dsa
+
+#endif // __CRT_EVENT_QUEUE_HPP__
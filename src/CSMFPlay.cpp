@@ -24,6 +24,7 @@ typedef int32_t ssize_t;
 #endif
 
 #include <cstdio>
+#include <cstring>
 #include <limits.h> /* IWYU pragma: keep */
 #include <assert.h>
 #include <stdint.h>
@@ -31,6 +32,10 @@ typedef int32_t ssize_t;
 #include "CSMFPlay.hpp"
 #include "COpllDevice.hpp"
 #include "CSccDevice.hpp"
+#include "CStereoResampler.hpp"
+#include "CWorkerPool.hpp"
+#include "CThread.hpp"
+#include "CModuleReplay.hpp"
 
 #include "sequencer/midi_sequencer.hpp"
 
@@ -77,8 +82,93 @@ CSMFPlay::CSMFPlay(DWORD rate, int mods)
 {
     m_sequencer = NULL;
     m_sequencerInterface = NULL;
+    m_loadInterface = NULL;
     m_rate = rate;
     m_mods = mods;
+    m_nativeRate = false;
+    m_resampler = NULL;
+    m_busMaxFrames = 0;
+    m_pool = NULL;
+    m_modBuf = NULL;
+    m_modFrames = 0;
+    m_loadPool = NULL;
+    m_rtClock = 0;
+    m_asyncControl = false;
+    m_loopEnabled = false;
+    m_loopsNumber = -1;
+    m_loopHooksOnly = false;
+    m_modeEMIDI = false;
+    m_tempo = 1.0;
+    m_songNum = 0;
+    m_triggerHandler = NULL;
+    m_triggerUserData = NULL;
+    m_pubSeq = 0;
+    m_pubPosition[0] = m_pubPosition[1] = 0;
+    m_pubAtEnd = 1;
+    m_asyncThread = NULL;
+    std::memset(&m_asyncFormat, 0, sizeof(m_asyncFormat));
+    std::memset(m_asyncSilence, 0, sizeof(m_asyncSilence));
+    m_asyncChunk = 0;
+    m_asyncIdle = 1;
+    m_asyncQuit = 0;
+    m_asyncUnderruns = 0;
+    m_asyncPrevControl = false;
+    m_planarLeft = NULL;
+    m_planarRight = NULL;
+    createDevices();
+    // Ready for the real-time MIDI calls before any song is loaded
+    Reset();
+
+    initSequencerInterface();
+    m_front = m_sequencer;
+}
+
+CSMFPlay::~CSMFPlay()
+{
+    stopAsyncRender();
+
+    // The sequencers which were loaded, but never swapped in
+    while(!m_commands.Empty())
+    {
+        const Command &c = m_commands.Front();
+        if(c.type == CMD_SWAP_SEQUENCER)
+            delete reinterpret_cast<MidiSequencer *>(c.ptr);
+        m_commands.Pop();
+    }
+    freeRetired();
+
+    destroyDevices();
+    if(m_pool)
+        delete m_pool;
+    if(m_modBuf)
+        delete[] m_modBuf;
+    if(m_loadPool)
+        delete m_loadPool;
+    if(m_sequencer)
+        delete m_sequencer;
+    if(m_sequencerInterface)
+        delete m_sequencerInterface;
+    if(m_loadInterface)
+        delete m_loadInterface;
+}
+
+// Sample rate of the OPLL which has no rate converter inside (clock / 72)
+#define NATIVE_RATE (3579545 / 72)
+
+void CSMFPlay::createDevices()
+{
+    DWORD rate = m_rate;
+
+    if(m_nativeRate && m_rate != NATIVE_RATE)
+    {
+        rate = NATIVE_RATE;
+        m_resampler = new CStereoResampler(NATIVE_RATE, m_rate);
+        // Keep a margin for the frames which the resampler takes ahead
+        m_busMaxFrames = (size_t)((double)(sizeof(m_busBuf) / sizeof(int32_t) / 2 - CStereoResampler::TAPS) * m_rate / NATIVE_RATE);
+        if(m_busMaxFrames < 1)
+            m_busMaxFrames = 1;
+    }
+
     for(int i = 0; i < m_mods; i++)
     {
         if(i & 1)
@@ -86,46 +176,146 @@ CSMFPlay::CSMFPlay(DWORD rate, int mods)
         else
             m_module[i].AttachDevice(new COpllDevice(rate, 2));
     }
-
-    initSequencerInterface();
 }
 
-CSMFPlay::~CSMFPlay()
+void CSMFPlay::destroyDevices()
 {
     for(int i = 0; i < m_mods; i++)
         delete m_module[i].DetachDevice();
-    if(m_sequencer)
-        delete m_sequencer;
-    if(m_sequencerInterface)
-        delete m_sequencerInterface;
+    if(m_resampler)
+        delete m_resampler;
+    m_resampler = NULL;
 }
 
-bool CSMFPlay::Load(const void *buf, int size)
+void CSMFPlay::loadTrackTitles()
 {
-    m_sequencer->setDeviceMask(DEFAULT_MASK_GM);
-    bool ret = m_sequencer->loadMIDI(buf, size);
     m_trackTitles.clear();
-    const MidiSequencer::MusTrackTitlesList &tracks = m_sequencer->getTrackTitles();
+    const MidiSequencer::MusTrackTitlesList &tracks = m_front->getTrackTitles();
     for(const MidiSequencer::DataBlock *i = tracks.begin(); i != tracks.end(); ++i)
-        m_trackTitles.push_back(std::string(reinterpret_cast<const char*>(m_sequencer->getData(*i)), i->size));
+        m_trackTitles.push_back(std::string(reinterpret_cast<const char*>(m_front->getData(*i)), i->size));
+}
+
+enum LoadKind
+{
+    LOAD_DATA, LOAD_CACHE, LOAD_FILE
+};
+
+bool CSMFPlay::loadAsync(const void *buf, size_t size, int kind)
+{
+    freeRetired();
+
+    MidiSequencer *seq = new MidiSequencer;
+    seq->setInterface(m_loadInterface);
+    seq->setDeviceMask(DEFAULT_MASK_GM);
+    seq->setLoopEnabled(m_loopEnabled);
+    seq->setLoopsCount(m_loopsNumber);
+    seq->setLoopHooksOnly(m_loopHooksOnly);
+    seq->setModeEMIDI(m_modeEMIDI);
+    seq->setTempo(m_tempo);
+    seq->setSongNum(m_songNum);
+    seq->setTriggerHandler(m_triggerHandler, m_triggerUserData);
+
+    bool ret;
+    switch(kind)
+    {
+    case LOAD_CACHE:
+        ret = seq->loadSongCache(buf, size);
+        break;
+    case LOAD_FILE:
+        ret = seq->loadMIDI(reinterpret_cast<const char *>(buf));
+        break;
+    default:
+        ret = seq->loadMIDI(buf, size);
+        break;
+    }
+
+    // The current song keeps playing when the new one can't be loaded
+    if(!ret)
+    {
+        m_error = seq->getErrorString();
+        delete seq;
+        return false;
+    }
+
+    // Walk the song here rather than on the first seek by the renderer
+    seq->buildSeekIndex();
+    keepCache(seq);
+
+    if(!postCommand(CMD_SWAP_SEQUENCER, 0, false, 0.0, seq))
+    {
+        delete seq;
+        return false;
+    }
+
+    m_front = seq;
+    loadTrackTitles();
+    return true;
+}
+
+bool CSMFPlay::Load(const void *buf, int size, bool noCopy)
+{
+    // The renderer plays the previous song until it swaps the new one in,
+    // which the caller can't see, so the caller's memory can't be borrowed
+    if(m_asyncControl)
+        return loadAsync(buf, static_cast<size_t>(size), LOAD_DATA);
+
+    m_sequencer->setDeviceMask(DEFAULT_MASK_GM);
+    bool ret = noCopy ? m_sequencer->loadMIDINoCopy(buf, size) : m_sequencer->loadMIDI(buf, size);
+    loadTrackTitles();
     Reset();
     return ret;
 }
 
+bool CSMFPlay::LoadCache(const void *buf, size_t size)
+{
+    if(m_asyncControl)
+        return loadAsync(buf, size, LOAD_CACHE);
+
+    m_sequencer->setDeviceMask(DEFAULT_MASK_GM);
+    bool ret = m_sequencer->loadSongCache(buf, size);
+    loadTrackTitles();
+    Reset();
+    return ret;
+}
+
+size_t CSMFPlay::SaveCache(void *buf, size_t size)
+{
+    // The renderer plays the latest loaded song, so it was saved before
+    if(m_asyncControl)
+    {
+        if(buf && size >= m_frontCache.size() && !m_frontCache.empty())
+            std::memcpy(buf, &m_frontCache[0], m_frontCache.size());
+        return m_frontCache.size();
+    }
+    return m_front->saveSongCache(buf, size);
+}
+
+void CSMFPlay::keepCache(MidiSequencer *seq)
+{
+    m_frontCache.resize(seq->saveSongCache(NULL, 0));
+    if(!m_frontCache.empty())
+        seq->saveSongCache(&m_frontCache[0], m_frontCache.size());
+}
+
 bool CSMFPlay::Open(const char *filename)
 {
+    if(m_asyncControl)
+        return loadAsync(filename, 0, LOAD_FILE);
+
     m_sequencer->setDeviceMask(DEFAULT_MASK_GM);
     bool ret = m_sequencer->loadMIDI(filename);
-    m_trackTitles.clear();
-    const MidiSequencer::MusTrackTitlesList &tracks = m_sequencer->getTrackTitles();
-    for(const MidiSequencer::DataBlock *i = tracks.begin(); i != tracks.end(); ++i)
-        m_trackTitles.push_back(std::string(reinterpret_cast<const char*>(m_sequencer->getData(*i)), i->size));
+    loadTrackTitles();
     Reset();
     return ret;
 }
 
 void CSMFPlay::Start(bool reset)
 {
+    if(m_asyncControl)
+    {
+        postCommand(CMD_START, 0, reset);
+        return;
+    }
     if(reset)
         Reset();
     m_sequencer->rewind();
@@ -133,124 +323,436 @@ void CSMFPlay::Start(bool reset)
 
 void CSMFPlay::Reset()
 {
+    if(m_asyncControl)
+    {
+        postCommand(CMD_RESET);
+        return;
+    }
     for(int i = 0; i < m_mods; i++)
         m_module[i].Reset();
 }
 
 void CSMFPlay::Rewind()
 {
+    if(m_asyncControl)
+    {
+        postCommand(CMD_REWIND);
+        return;
+    }
     m_sequencer->rewind();
 }
 
 void CSMFPlay::Panic()
 {
+    if(m_asyncControl)
+    {
+        postCommand(CMD_PANIC);
+        return;
+    }
     for(int i = 0; i < m_mods; i++)
         m_module[i].SendPanic();
 }
 
 void CSMFPlay::Seek(double seconds)
 {
+    if(m_asyncControl)
+    {
+        postCommand(CMD_SEEK, 0, false, seconds);
+        return;
+    }
     m_sequencer->seek(seconds, 1.0);
 }
 
 double CSMFPlay::Tell()
 {
-    return m_sequencer->tell();
+    if(!m_asyncControl)
+        return m_sequencer->tell();
+
+    // Retry when the renderer has published a new position meanwhile
+    UINT32 seq, pos[2];
+    do
+    {
+        seq = AtomicLoad(&m_pubSeq);
+        pos[0] = AtomicLoad(&m_pubPosition[0]);
+        pos[1] = AtomicLoad(&m_pubPosition[1]);
+    } while((seq & 1) || AtomicLoad(&m_pubSeq) != seq);
+
+    double ret;
+    std::memcpy(&ret, pos, sizeof(ret));
+    return ret;
 }
 
 double CSMFPlay::Duration()
 {
-    return m_sequencer->timeLength();
+    return m_front->timeLength();
 }
 
 double CSMFPlay::loopStart()
 {
-    return m_sequencer->getLoopStart();
+    return m_front->getLoopStart();
 }
 
 double CSMFPlay::loopEnd()
 {
-    return m_sequencer->getLoopEnd();
+    return m_front->getLoopEnd();
 }
 
 void CSMFPlay::SetLoop(bool enabled)
 {
-    m_sequencer->setLoopEnabled(enabled);
+    m_loopEnabled = enabled;
+    if(m_asyncControl)
+        postCommand(CMD_LOOP, 0, enabled);
+    else
+        m_sequencer->setLoopEnabled(enabled);
 }
 
 void CSMFPlay::SetLoopsNumber(int loops)
 {
-    m_sequencer->setLoopsCount(loops);
+    m_loopsNumber = loops;
+    if(m_asyncControl)
+        postCommand(CMD_LOOPS_NUMBER, loops);
+    else
+        m_sequencer->setLoopsCount(loops);
 }
 
 void CSMFPlay::setLoopHooksOnly(bool enabled)
 {
-    m_sequencer->setLoopHooksOnly(enabled);
+    m_loopHooksOnly = enabled;
+    if(m_asyncControl)
+        postCommand(CMD_LOOP_HOOKS_ONLY, 0, enabled);
+    else
+        m_sequencer->setLoopHooksOnly(enabled);
 }
 
 bool CSMFPlay::GetLoop()
 {
-    return m_sequencer->getLoopEnabled();
+    return m_loopEnabled;
 }
 
 bool CSMFPlay::SeqEof()
 {
+    if(m_asyncControl)
+        return AtomicLoad(&m_pubAtEnd) != 0;
     return m_sequencer->positionAtEnd();
 }
 
 void CSMFPlay::SetModeEMIDI(bool enabled)
 {
-    m_sequencer->setModeEMIDI(enabled);
+    m_modeEMIDI = enabled;
+    if(m_asyncControl)
+        postCommand(CMD_EMIDI, 0, enabled);
+    else
+        m_sequencer->setModeEMIDI(enabled);
+}
+
+bool CSMFPlay::setNativeRateMixing(bool enabled)
+{
+    if(m_asyncThread)
+        return false; // The devices are being rendered
+    if(m_nativeRate == enabled)
+        return true;
+    m_nativeRate = enabled;
+    destroyDevices();
+    createDevices();
+    Reset();
+    return true;
+}
+
+bool CSMFPlay::setRenderThreads(int threads)
+{
+    if(m_asyncThread)
+        return false; // The pool is in use
+    if(m_pool)
+        delete m_pool;
+    m_pool = NULL;
+    if(m_modBuf)
+        delete[] m_modBuf;
+    m_modBuf = NULL;
+
+    if(threads <= 1)
+        return true;
+    if(!CThread::IsSupported())
+        return false;
+
+    m_pool = new CWorkerPool(threads > m_mods ? m_mods : threads);
+    m_modBuf = new int32_t[m_mods * MODBUF_FRAMES * 2];
+    return true;
+}
+
+void CSMFPlay::runLoadJobs(void *userdata, void (*job)(void *ctx, int index), void *ctx, int count)
+{
+    CSMFPlay *c = reinterpret_cast<CSMFPlay *>(userdata);
+    c->m_loadPool->Run(job, ctx, count);
+}
+
+bool CSMFPlay::setLoadThreads(int threads)
+{
+    if(m_asyncThread)
+        return false; // The renderer reads the interface
+    if(m_loadPool)
+        delete m_loadPool;
+    m_loadPool = NULL;
+    m_sequencerInterface->runParallelJobs = NULL;
+    m_sequencerInterface->runParallelJobs_userData = NULL;
+    syncLoadInterface();
+
+    if(threads <= 1)
+        return true;
+    if(!CThread::IsSupported())
+        return false;
+
+    m_loadPool = new CWorkerPool(threads);
+    m_sequencerInterface->runParallelJobs = runLoadJobs;
+    m_sequencerInterface->runParallelJobs_userData = this;
+    syncLoadInterface();
+    return true;
+}
+
+bool CSMFPlay::postCommand(int type, int arg, bool flag, double value, void *ptr, void *userData)
+{
+    freeRetired();
+
+    Command c;
+    c.type = type;
+    c.arg = arg;
+    c.flag = flag;
+    c.value = value;
+    c.ptr = ptr;
+    c.userData = userData;
+    if(!m_commands.Push(c))
+    {
+        m_error = "Emu De MIDI: Too many commands wait for the audio rendering";
+        return false;
+    }
+    return true;
+}
+
+void CSMFPlay::applyCommands()
+{
+    while(!m_commands.Empty())
+    {
+        const Command &c = m_commands.Front();
+        switch(c.type)
+        {
+        case CMD_SEEK:
+            m_sequencer->seek(c.value, 1.0);
+            break;
+        case CMD_REWIND:
+            m_sequencer->rewind();
+            break;
+        case CMD_START:
+            if(c.flag)
+            {
+                for(int i = 0; i < m_mods; i++)
+                    m_module[i].Reset();
+            }
+            m_sequencer->rewind();
+            break;
+        case CMD_RESET:
+            for(int i = 0; i < m_mods; i++)
+                m_module[i].Reset();
+            break;
+        case CMD_PANIC:
+            for(int i = 0; i < m_mods; i++)
+                m_module[i].SendPanic();
+            break;
+        case CMD_TEMPO:
+            m_sequencer->setTempo(c.value);
+            break;
+        case CMD_TRACK_ENABLED:
+            m_sequencer->setTrackEnabled(c.arg, c.flag);
+            break;
+        case CMD_CHANNEL_ENABLED:
+            m_sequencer->setChannelEnabled(c.arg, c.flag);
+            break;
+        case CMD_LOOP:
+            m_sequencer->setLoopEnabled(c.flag);
+            break;
+        case CMD_LOOPS_NUMBER:
+            m_sequencer->setLoopsCount(c.arg);
+            break;
+        case CMD_LOOP_HOOKS_ONLY:
+            m_sequencer->setLoopHooksOnly(c.flag);
+            break;
+        case CMD_EMIDI:
+            m_sequencer->setModeEMIDI(c.flag);
+            break;
+        case CMD_TRIGGER_HANDLER:
+            m_sequencer->setTriggerHandler(reinterpret_cast<EDMIDI_TriggerHandler>(c.ptr), c.userData);
+            break;
+        case CMD_DEBUG_HOOK:
+            m_sequencerInterface->onDebugMessage = reinterpret_cast<EDMIDI_DebugMessageHook>(c.ptr);
+            m_sequencerInterface->onDebugMessage_userData = c.userData;
+            break;
+        case CMD_LOOP_START_HOOK:
+            m_sequencerInterface->onloopStart = reinterpret_cast<EDMIDI_LoopPointHook>(c.ptr);
+            m_sequencerInterface->onloopStart_userData = c.userData;
+            break;
+        case CMD_LOOP_END_HOOK:
+            m_sequencerInterface->onloopEnd = reinterpret_cast<EDMIDI_LoopPointHook>(c.ptr);
+            m_sequencerInterface->onloopEnd_userData = c.userData;
+            break;
+        case CMD_SWAP_SEQUENCER:
+        {
+            MidiSequencer *old = m_sequencer;
+            m_sequencer = reinterpret_cast<MidiSequencer *>(c.ptr);
+            m_sequencer->setInterface(m_sequencerInterface);
+            for(int i = 0; i < m_mods; i++)
+                m_module[i].Reset();
+            // Freeing a song takes time, leave it to the controlling thread
+            if(!m_retired.Push(old))
+                delete old;
+            break;
+        }
+        default:
+            break;
+        }
+        m_commands.Pop();
+    }
+}
+
+void CSMFPlay::freeRetired()
+{
+    while(!m_retired.Empty())
+    {
+        delete m_retired.Front();
+        m_retired.Pop();
+    }
+}
+
+void CSMFPlay::publishState()
+{
+    const double pos = m_sequencer->tell();
+    UINT32 words[2];
+    std::memcpy(words, &pos, sizeof(words));
+
+    // The reader retries while the counter is odd or has changed
+    const UINT32 seq = m_pubSeq;
+    AtomicStore(&m_pubSeq, seq + 1);
+    AtomicStore(&m_pubPosition[0], words[0]);
+    AtomicStore(&m_pubPosition[1], words[1]);
+    AtomicStore(&m_pubSeq, seq + 2);
+    AtomicStore(&m_pubAtEnd, m_sequencer->positionAtEnd() ? 1 : 0);
+}
+
+void CSMFPlay::beginBlock()
+{
+    if(m_asyncControl)
+        applyCommands();
+    m_rtEvents.Latch(m_rtClock);
+}
+
+void CSMFPlay::endBlock()
+{
+    if(m_asyncControl)
+        publishState();
+}
+
+bool CSMFPlay::setAsyncControl(bool enabled)
+{
+    // The render thread is the only one to apply the commands
+    if(m_asyncThread)
+        return false;
+    if(m_asyncControl == enabled)
+        return true;
+
+    if(!enabled)
+    {
+        // Nothing renders now, so apply the rest right here
+        applyCommands();
+        freeRetired();
+        m_frontCache.clear();
+    }
+
+    m_asyncControl = enabled;
+    if(enabled)
+    {
+        if(!m_loadInterface)
+            m_loadInterface = new BW_MidiRtInterface;
+        syncLoadInterface();
+        keepCache(m_front);
+        // The song may be played after the next load returns
+        m_sequencer->ownBorrowedData();
+        publishState();
+    }
+    return true;
+}
+
+void CSMFPlay::syncLoadInterface()
+{
+    if(m_loadInterface)
+        *m_loadInterface = *m_sequencerInterface;
 }
 
 void CSMFPlay::setSongNum(int track)
 {
-    m_sequencer->setSongNum(track);
+    // Switching the song reloads it: with the asynchronous control, it's
+    // left to the next load
+    m_songNum = track;
+    if(!m_asyncControl)
+        m_sequencer->setSongNum(track);
 }
 
 int CSMFPlay::getSongsCount()
 {
-    return m_sequencer->getSongsCount();
+    return m_front->getSongsCount();
 }
 
 void CSMFPlay::setTempo(double tempo)
 {
-    m_sequencer->setTempo(tempo);
+    m_tempo = tempo;
+    if(m_asyncControl)
+        postCommand(CMD_TEMPO, 0, false, tempo);
+    else
+        m_sequencer->setTempo(tempo);
 }
 
 double CSMFPlay::getTempo()
 {
-    return m_sequencer->getTempoMultiplier();
+    return m_tempo;
 }
 
 int CSMFPlay::tracksCount()
 {
-    return (int)m_sequencer->getTrackCount();
+    return (int)m_front->getTrackCount();
 }
 
 int CSMFPlay::setTrackEnabled(int track, bool en)
 {
-    return (int)m_sequencer->setTrackEnabled(track, en);
+    if(!m_asyncControl)
+        return (int)m_sequencer->setTrackEnabled(track, en);
+    if(track < 0 || (size_t)track >= m_front->getTrackCount())
+        return 0;
+    return (int)postCommand(CMD_TRACK_ENABLED, track, en);
 }
 
 int CSMFPlay::setChannelEnabled(int chan, bool en)
 {
-    return (int)m_sequencer->setChannelEnabled(chan, en);
+    if(!m_asyncControl)
+        return (int)m_sequencer->setChannelEnabled(chan, en);
+    if(chan < 0 || chan >= 16)
+        return 0;
+    return (int)postCommand(CMD_CHANNEL_ENABLED, chan, en);
 }
 
 void CSMFPlay::setTriggerHandler(EDMIDI_TriggerHandler handler, void *userData)
 {
-    m_sequencer->setTriggerHandler(handler, userData);
+    m_triggerHandler = handler;
+    m_triggerUserData = userData;
+    if(m_asyncControl)
+        postCommand(CMD_TRIGGER_HANDLER, 0, false, 0.0, reinterpret_cast<void *>(handler), userData);
+    else
+        m_sequencer->setTriggerHandler(handler, userData);
 }
 
 const char *CSMFPlay::getMusicTitle()
 {
-    return m_sequencer->getMusicTitle();
+    return m_front->getMusicTitle();
 }
 
 const char *CSMFPlay::getMusicCopyright()
 {
-    return m_sequencer->getMusicCopyright();
+    return m_front->getMusicCopyright();
 }
 
 const std::vector<std::string> &CSMFPlay::getTrackTitles()
@@ -260,13 +762,13 @@ const std::vector<std::string> &CSMFPlay::getTrackTitles()
 
 size_t CSMFPlay::getMarkersCount()
 {
-    return m_sequencer->getMarkers().size;
+    return m_front->getMarkers().size;
 }
 
 EdMidi_MarkerEntry CSMFPlay::getMarker(size_t index)
 {
     struct EdMidi_MarkerEntry marker;
-    const MidiSequencer::MusMarkersList &markers = m_sequencer->getMarkers();
+    const MidiSequencer::MusMarkersList &markers = m_front->getMarkers();
     if(index >= markers.size)
     {
         marker.label = "INVALID";
@@ -276,29 +778,56 @@ EdMidi_MarkerEntry CSMFPlay::getMarker(size_t index)
     }
 
     const MidiSequencer::MIDI_MarkerEntry &mk = markers[index];
-    marker.label = reinterpret_cast<const char*>(m_sequencer->getData(mk.label));
+    marker.label = reinterpret_cast<const char*>(m_front->getData(mk.label));
     marker.pos_time = mk.pos_time;
     marker.pos_ticks = (unsigned long)mk.pos_ticks;
 
     return marker;
 }
 
+// With the asynchronous control, the renderer reads the hooks on every event,
+// so it takes each of them with its user data at once by a command, and the
+// interface of the loading thread gets them right away.
 void CSMFPlay::setDebugMessageHook(EDMIDI_DebugMessageHook debugMessageHook, void *userData)
 {
+    if(m_asyncControl)
+    {
+        m_loadInterface->onDebugMessage = debugMessageHook;
+        m_loadInterface->onDebugMessage_userData = userData;
+        postCommand(CMD_DEBUG_HOOK, 0, false, 0.0, reinterpret_cast<void *>(debugMessageHook), userData);
+        return;
+    }
     m_sequencerInterface->onDebugMessage = debugMessageHook;
     m_sequencerInterface->onDebugMessage_userData = userData;
+    syncLoadInterface();
 }
 
 void CSMFPlay::adl_setLoopStartHook(EDMIDI_LoopPointHook loopStartHook, void *userData)
 {
+    if(m_asyncControl)
+    {
+        m_loadInterface->onloopStart = loopStartHook;
+        m_loadInterface->onloopStart_userData = userData;
+        postCommand(CMD_LOOP_START_HOOK, 0, false, 0.0, reinterpret_cast<void *>(loopStartHook), userData);
+        return;
+    }
     m_sequencerInterface->onloopStart = loopStartHook;
     m_sequencerInterface->onloopStart_userData = userData;
+    syncLoadInterface();
 }
 
 void CSMFPlay::adl_setLoopEndHook(EDMIDI_LoopPointHook loopEndHook, void *userData)
 {
+    if(m_asyncControl)
+    {
+        m_loadInterface->onloopEnd = loopEndHook;
+        m_loadInterface->onloopEnd_userData = userData;
+        postCommand(CMD_LOOP_END_HOOK, 0, false, 0.0, reinterpret_cast<void *>(loopEndHook), userData);
+        return;
+    }
     m_sequencerInterface->onloopEnd = loopEndHook;
     m_sequencerInterface->onloopEnd_userData = userData;
+    syncLoadInterface();
 }
 
 const std::string &CSMFPlay::getErrorString() const
@@ -317,6 +846,18 @@ namespace dsa
 extern void playSynth(void *userdata, uint8_t *stream, size_t length);
 extern void playSynthS16(void *userdata, uint8_t *stream, size_t length);
 extern void playSynthF32(void *userdata, uint8_t *stream, size_t length);
+extern void playSynthS32(void *userdata, uint8_t *stream, size_t length);
+extern void playSynthF32Planar(void *userdata, uint8_t *stream, size_t length);
+}
+
+int CSMFPlay::playStream(uint8_t *stream, size_t length, bool sequence)
+{
+    if(sequence)
+        return m_sequencer->playStream(stream, length);
+
+    // The chips only, the song doesn't move
+    m_sequencerInterface->onPcmRender(this, stream, length);
+    return static_cast<int>(length);
 }
 
 int CSMFPlay::Render(int *buf, size_t length)
@@ -327,17 +868,23 @@ int CSMFPlay::Render(int *buf, size_t length)
         m_sequencerInterface->pcmFrameSize = 2 /*channels*/ * 4 /*size of one sample*/;
     }
 
-    return m_sequencer->playStream(reinterpret_cast<uint8_t *>(buf), static_cast<size_t>(length * 8));
+    beginBlock();
+    int ret = m_sequencer->playStream(reinterpret_cast<uint8_t *>(buf), static_cast<size_t>(length * 8));
+    endBlock();
+    return ret;
 }
 
-int CSMFPlay::RenderS16(short *buf, size_t length)
+int CSMFPlay::RenderS16(short *buf, size_t length, bool sequence)
 {
     if(m_sequencerInterface->onPcmRender != playSynthS16)
     {
         m_sequencerInterface->onPcmRender = playSynthS16;
         m_sequencerInterface->pcmFrameSize = 2 /*channels*/ * 2 /*size of one sample*/;
     }
-    return m_sequencer->playStream(reinterpret_cast<uint8_t *>(buf), static_cast<size_t>(length * 4));
+    beginBlock();
+    int ret = playStream(reinterpret_cast<uint8_t *>(buf), static_cast<size_t>(length * 4), sequence);
+    endBlock();
+    return ret;
 }
 
 int CSMFPlay::RenderF32(float *buf, size_t length)
@@ -347,7 +894,15 @@ int CSMFPlay::RenderF32(float *buf, size_t length)
         m_sequencerInterface->onPcmRender = playSynthF32;
         m_sequencerInterface->pcmFrameSize = 2 /*channels*/ * 4 /*size of one sample*/;
     }
-    return m_sequencer->playStream(reinterpret_cast<uint8_t *>(buf), static_cast<size_t>(length * 8));
+    beginBlock();
+    int ret = m_sequencer->playStream(reinterpret_cast<uint8_t *>(buf), static_cast<size_t>(length * 8));
+    endBlock();
+    return ret;
+}
+
+bool CSMFPlay::rtEvent(UINT8 status, UINT8 channel, UINT8 data1, UINT8 data2, UINT32 frameOffset)
+{
+    return m_rtEvents.Push(frameOffset, status, channel, data1, data2);
 }
 
 
@@ -532,11 +1087,60 @@ static int SendStereoAudio(int        samples_requested,
 }
 
 
+int CSMFPlay::renderDirect(int frames, uint8_t *stream,
+                           void (*render)(void *, uint8_t *, size_t), uint32_t frameSize,
+                           bool sequence)
+{
+    if(m_sequencerInterface->onPcmRender != render || m_sequencerInterface->pcmFrameSize != frameSize)
+    {
+        m_sequencerInterface->onPcmRender = render;
+        m_sequencerInterface->pcmFrameSize = frameSize;
+    }
+
+    int generated = playStream(stream, static_cast<size_t>(frames) * frameSize, sequence);
+    return (generated / static_cast<int>(frameSize)) * 2;
+}
+
 int CSMFPlay::RenderFormat(int sampleCount,
                            EDMIDI_UInt8 *out_left,
                            EDMIDI_UInt8 *out_right,
-                           const EDMIDI_AudioFormat *format)
+                           const EDMIDI_AudioFormat *format, bool sequence)
+{
+    if(sampleCount < 2)
+        return 0;
+
+    beginBlock();
+    int ret = renderFormat(sampleCount, out_left, out_right, format, sequence);
+    endBlock();
+    return ret;
+}
+
+int CSMFPlay::renderFormat(int sampleCount,
+                           EDMIDI_UInt8 *out_left,
+                           EDMIDI_UInt8 *out_right,
+                           const EDMIDI_AudioFormat *format, bool sequence)
 {
+    const unsigned containerSize = format->containerSize;
+    const unsigned sampleOffset = format->sampleOffset;
+
+    // The common layouts are rendered right into the output
+    if(out_right == out_left + containerSize && sampleOffset == containerSize * 2)
+    {
+        if(format->type == EDMIDI_SampleType_S16 && containerSize == sizeof(int16_t))
+            return renderDirect(sampleCount / 2, out_left, playSynthS16, 2 * sizeof(int16_t), sequence);
+        if(format->type == EDMIDI_SampleType_S32 && containerSize == sizeof(int32_t))
+            return renderDirect(sampleCount / 2, out_left, playSynthS32, 2 * sizeof(int32_t), sequence);
+        if(format->type == EDMIDI_SampleType_F32 && containerSize == sizeof(float))
+            return renderDirect(sampleCount / 2, out_left, playSynthF32, 2 * sizeof(float), sequence);
+    }
+    else if(format->type == EDMIDI_SampleType_F32 && containerSize == sizeof(float) &&
+            sampleOffset == sizeof(float))
+    {
+        m_planarLeft = out_left;
+        m_planarRight = out_right;
+        return renderDirect(sampleCount / 2, out_left, playSynthF32Planar, sizeof(float), sequence);
+    }
+
     size_t doRead = 1024;
     size_t doReadStereo = 512;
     int left = sampleCount;
@@ -559,8 +1163,9 @@ int CSMFPlay::RenderFormat(int sampleCount,
     {
         doRead = left > 1024 ? 1024 : left;
         doReadStereo = doRead / 2;
-        generated = m_sequencer->playStream(reinterpret_cast<uint8_t *>(m_outBuf), static_cast<size_t>(doReadStereo * 8));
-        assert(generated > 0);
+        generated = playStream(reinterpret_cast<uint8_t *>(m_outBuf), static_cast<size_t>(doReadStereo * 8), sequence);
+        if(generated <= 0)
+            break; // Reached the song end
         generatedSamples = generated / 4;
 
         /* Process it */
@@ -573,3 +1178,239 @@ int CSMFPlay::RenderFormat(int sampleCount,
 
     return gotten_len;
 }
+
+bool CSMFPlay::IsFormatSupported(const EDMIDI_AudioFormat *format)
+{
+    if(format->containerSize == 0 || format->containerSize > 8)
+        return false;
+    int32_t zero[2] = {0, 0};
+    UINT8 frame[16];
+    return SendStereoAudio(2, 1, zero, 0, frame, frame + format->containerSize, format) != -1;
+}
+
+bool CSMFPlay::startAsyncRender(UINT32 bufferFrames, const EDMIDI_AudioFormat *format)
+{
+    if(m_asyncThread || bufferFrames < 16 || bufferFrames > CPcmRing::MAX_FRAMES)
+        return false;
+
+    // The ring keeps whole frames, the channels must be interleaved
+    const unsigned containerSize = format->containerSize;
+    if(containerSize == 0 || containerSize * 2 > sizeof(m_asyncSilence) ||
+       format->sampleOffset != containerSize * 2)
+        return false;
+
+    int32_t zero[2] = {0, 0};
+    if(SendStereoAudio(2, 1, zero, 0, m_asyncSilence, m_asyncSilence + containerSize, format) == -1)
+        return false;
+
+    m_asyncFormat = *format;
+    if(!m_asyncRing.Init(bufferFrames, containerSize * 2))
+        return false;
+    m_asyncChunk = std::min<UINT32>(m_asyncRing.Capacity() / 4, 512);
+    m_asyncIdle = std::max<unsigned>(1, m_asyncChunk * 500 / static_cast<unsigned>(m_rate));
+    m_asyncQuit = 0;
+    m_asyncUnderruns = 0;
+
+    // The thread becomes the renderer, the caller sends the commands
+    m_asyncPrevControl = m_asyncControl;
+    setAsyncControl(true);
+
+    m_asyncThread = new CThread;
+    if(!m_asyncThread->Start(asyncRenderEntry, this))
+    {
+        delete m_asyncThread;
+        m_asyncThread = NULL;
+        setAsyncControl(m_asyncPrevControl);
+        m_asyncRing.Free();
+        return false;
+    }
+
+    return true;
+}
+
+void CSMFPlay::stopAsyncRender()
+{
+    if(!m_asyncThread)
+        return;
+
+    AtomicStore(&m_asyncQuit, 1);
+    m_asyncThread->Join();
+    delete m_asyncThread;
+    m_asyncThread = NULL;
+
+    setAsyncControl(m_asyncPrevControl);
+    m_asyncRing.Free();
+}
+
+bool CSMFPlay::isAsyncRendering() const
+{
+    return m_asyncThread != NULL;
+}
+
+size_t CSMFPlay::readAsyncRender(UINT8 *out, size_t frames)
+{
+    if(!m_asyncThread)
+        return 0;
+
+    const UINT32 frameSize = m_asyncFormat.containerSize * 2;
+    size_t got = m_asyncRing.Read(out, static_cast<UINT32>(frames));
+    if(got < frames)
+    {
+        for(size_t i = got; i < frames; i++)
+            std::memcpy(out + i * frameSize, m_asyncSilence, frameSize);
+        AtomicStore(&m_asyncUnderruns, m_asyncUnderruns + 1);
+    }
+
+    return frames;
+}
+
+size_t CSMFPlay::getAsyncRenderFill() const
+{
+    return m_asyncThread ? m_asyncRing.Fill() : 0;
+}
+
+size_t CSMFPlay::getAsyncRenderUnderruns() const
+{
+    return AtomicLoad(&m_asyncUnderruns);
+}
+
+void CSMFPlay::asyncRenderEntry(void *arg)
+{
+    static_cast<CSMFPlay *>(arg)->asyncRender();
+}
+
+void CSMFPlay::asyncRender()
+{
+    const unsigned containerSize = m_asyncFormat.containerSize;
+
+    while(!AtomicLoad(&m_asyncQuit))
+    {
+        // The blocks are aligned to the chunk, so the free part never wraps
+        // in the middle of one
+        UINT32 frames;
+        UINT8 *out = m_asyncRing.WritePtr(frames);
+        if(frames < m_asyncChunk)
+        {
+            CThread::Sleep(m_asyncIdle);
+            continue;
+        }
+        frames = m_asyncChunk;
+
+        const int samples = static_cast<int>(frames * 2);
+        int done = 0;
+
+        beginBlock();
+        if(!m_sequencer->positionAtEnd())
+            done = renderFormat(samples, out, out + containerSize, &m_asyncFormat, true);
+        // After the song end, the chips keep playing the real-time events
+        if(done < samples)
+        {
+            UINT8 *rest = out + (done / 2) * containerSize * 2;
+            renderFormat(samples - done, rest, rest + containerSize, &m_asyncFormat, false);
+        }
+        endBlock();
+
+        m_asyncRing.Commit(frames);
+    }
+}
+
+// The song sounds as by a new player: the loading rewinds the song before
+// the chips get reset, and the resampler forgets the past too
+void CSMFPlay::startOffline()
+{
+    m_sequencer->rewind();
+    for(int i = 0; i < m_mods; i++)
+        m_module[i].Reset();
+    if(m_resampler)
+        m_resampler->Reset();
+}
+
+long CSMFPlay::renderOffline(UINT8 *buf, const EDMIDI_AudioFormat *format,
+                             EDMIDI_BatchSink sink, void *userData, unsigned long maxFrames)
+{
+    const unsigned frameSize = format->containerSize * 2;
+    unsigned long done = 0;
+
+    for(;;)
+    {
+        unsigned long frames = OFFLINE_FRAMES;
+        if(maxFrames)
+        {
+            if(done >= maxFrames)
+                break;
+            if(maxFrames - done < frames)
+                frames = maxFrames - done;
+        }
+        int got = RenderFormat(static_cast<int>(frames) * 2, buf, buf + format->containerSize, format) / 2;
+        if(got <= 0)
+            break;
+        if(sink && sink(userData, buf, static_cast<unsigned long>(got) * frameSize) != 0)
+            return -2;
+        done += static_cast<unsigned long>(got);
+        if(static_cast<unsigned long>(got) < frames)
+            break; // Reached the song end
+    }
+
+    return static_cast<long>(done);
+}
+
+long CSMFPlay::RenderOffline(int threads, const EDMIDI_AudioFormat *format,
+                             EDMIDI_BatchSink sink, void *userData, double maxSeconds)
+{
+    if(m_asyncControl || m_asyncThread)
+        return -1;
+
+    const unsigned long maxFrames = (maxSeconds > 0.0) ? static_cast<unsigned long>(maxSeconds * m_rate) : 0;
+    std::vector<UINT8> buf(OFFLINE_FRAMES * format->containerSize * 2);
+    long ret;
+
+    if(threads <= 1 || m_mods < 2)
+    {
+        startOffline();
+        ret = renderOffline(&buf[0], format, sink, userData, maxFrames);
+    }
+    else
+    {
+        // The modules replay their chips by themselves
+        CWorkerPool *pool = m_pool;
+        m_pool = NULL;
+
+        CModuleReplay replay(m_module, m_mods, threads);
+
+        // The first pass only logs the calls of the modules. Everything else
+        // it changes gets restored, and the hooks see the second pass only.
+        const UINT32 rtClock = m_rtClock;
+        BW_MidiRtInterface hooks = *m_sequencerInterface;
+        m_sequencerInterface->onDebugMessage = NULL;
+        m_sequencerInterface->onloopStart = NULL;
+        m_sequencerInterface->onloopEnd = NULL;
+        m_sequencer->setTriggerHandler(NULL, NULL);
+
+        replay.Record();
+        startOffline();
+        renderOffline(&buf[0], format, NULL, NULL, maxFrames);
+
+        m_rtClock = rtClock;
+        m_sequencerInterface->onDebugMessage = hooks.onDebugMessage;
+        m_sequencerInterface->onloopStart = hooks.onloopStart;
+        m_sequencerInterface->onloopEnd = hooks.onloopEnd;
+        m_sequencer->setTriggerHandler(m_triggerHandler, m_triggerUserData);
+
+        replay.Play();
+        startOffline();
+        ret = renderOffline(&buf[0], format, sink, userData, maxFrames);
+        if(ret < 0)
+            replay.Discard();
+
+        m_pool = pool;
+    }
+
+    // Canceled in the middle of the song: the chips get silenced, as the
+    // replayed ones are ahead of it
+    if(ret < 0)
+    {
+        for(int i = 0; i < m_mods; i++)
+            m_module[i].Reset();
+    }
+    return ret;
+}
@@ -5,6 +5,9 @@
 
 #include "emu_de_midi.h"
 #include "CMIDIModule.hpp"
+#include "CAtomic.hpp"
+#include "CRtEventQueue.hpp"
+#include "CPcmRing.hpp"
 
 // クラスの名前を変更してABIの衝突を回避する
 #define BW_MidiSequencer EmuDeMidiMidiSequencer
@@ -15,6 +18,10 @@ typedef struct BW_MidiRtInterface BW_MidiRtInterface;
 namespace dsa
 {
 
+class CStereoResampler;
+class CWorkerPool;
+class CThread;
+
 class CSMFPlay
 {
     friend CMIDIModule &getModule(void *userdata, uint8_t channel);
@@ -22,19 +29,138 @@ class CSMFPlay
     friend void playSynth(void *userdata, uint8_t *stream, size_t length);
     friend void playSynthS16(void *userdata, uint8_t *stream, size_t length);
     friend void playSynthF32(void *userdata, uint8_t *stream, size_t length);
+    friend void playSynthS32(void *userdata, uint8_t *stream, size_t length);
+    friend void playSynthF32Planar(void *userdata, uint8_t *stream, size_t length);
     CMIDIModule m_module[16];
 
     int m_mods;
     int m_rate;
 
     int32_t m_outBuf[2048];
+    // Intermediate 32-bit mix of all modules for the 16-bit and float outputs
+    int32_t m_mixBuf[2048];
+    // Planar float output: the stream of the sequencer walks the left
+    // channel, and the right one is found at the same offset from its start
+    uint8_t *m_planarLeft;
+    uint8_t *m_planarRight;
+
+    // Native-rate mix bus: the chips render at the OPLL sample rate, and
+    // one resampler converts their sum into the output rate.
+    bool m_nativeRate;
+    CStereoResampler *m_resampler;
+    size_t m_busMaxFrames; // Output frames to render per one bus buffer
+    int32_t m_busBuf[4096];
+
+    // Parallel rendering: every module renders into its own buffer on
+    // the worker pool, and the buffers are summed in the module order.
+    enum { MODBUF_FRAMES = 2048 };
+    CWorkerPool *m_pool;
+    int32_t *m_modBuf;     // One buffer per module
+    size_t m_modFrames;    // Frames of the current parallel block
+    static void renderJob(void *ctx, int index);
+
+    // Parallel decoding of the tracks of loaded MIDI files
+    CWorkerPool *m_loadPool;
+    static void runLoadJobs(void *userdata, void (*job)(void *ctx, int index), void *ctx, int count);
+
+    // Real-time MIDI events pushed by other thread, played at their frames
+    CRtEventQueue m_rtEvents;
+    UINT32 m_rtClock;      // Count of frames rendered by the modules
+    void applyRtEvent(const CRtEventQueue::Entry &e);
+
+    // Asynchronous control: the setters post the commands which the next
+    // rendered block applies, and the songs get loaded into a new sequencer
+    // by the calling thread, and the renderer swaps it in.
+    enum CommandType
+    {
+        CMD_SEEK, CMD_REWIND, CMD_START, CMD_RESET, CMD_PANIC, CMD_TEMPO,
+        CMD_TRACK_ENABLED, CMD_CHANNEL_ENABLED, CMD_LOOP, CMD_LOOPS_NUMBER,
+        CMD_LOOP_HOOKS_ONLY, CMD_EMIDI, CMD_TRIGGER_HANDLER, CMD_DEBUG_HOOK,
+        CMD_LOOP_START_HOOK, CMD_LOOP_END_HOOK, CMD_SWAP_SEQUENCER
+    };
+    struct Command
+    {
+        int type;
+        int arg;
+        bool flag;
+        double value;
+        void *ptr;          // Sequencer to swap in, or the handler or hook
+        void *userData;
+    };
+    bool m_asyncControl;
+    CLockFreeQueue<Command, 256> m_commands;
+    CLockFreeQueue<MidiSequencer *, 256> m_retired; // Swapped out, to delete by the controlling thread
+    bool postCommand(int type, int arg = 0, bool flag = false, double value = 0.0,
+                     void *ptr = NULL, void *userData = NULL);
+    void applyCommands();
+    void freeRetired();
+    bool loadAsync(const void *buf, size_t size, int kind);
+    // The cache of the latest loaded song, saved before the renderer gets it
+    std::vector<UINT8> m_frontCache;
+    void keepCache(MidiSequencer *seq);
+    void beginBlock();
+    void endBlock();
+
+    // Settings of the controlling thread, given to every newly loaded sequencer
+    bool m_loopEnabled;
+    int m_loopsNumber;
+    bool m_loopHooksOnly;
+    bool m_modeEMIDI;
+    double m_tempo;
+    int m_songNum;
+    EDMIDI_TriggerHandler m_triggerHandler;
+    void *m_triggerUserData;
+
+    // The state of the song which the renderer publishes for the controlling thread
+    volatile UINT32 m_pubSeq;
+    volatile UINT32 m_pubPosition[2];
+    volatile UINT32 m_pubAtEnd;
+    void publishState();
+
+    // Render-ahead thread: it renders into the PCM ring with the asynchronous
+    // control enabled, and the audio callback only copies out of the ring.
+    CThread *m_asyncThread;
+    CPcmRing m_asyncRing;
+    EDMIDI_AudioFormat m_asyncFormat;
+    UINT8 m_asyncSilence[16];       // One silent frame in the output format
+    UINT32 m_asyncChunk;            // Frames to render per one block
+    unsigned m_asyncIdle;           // Milliseconds to wait while the ring is full
+    volatile UINT32 m_asyncQuit;
+    volatile UINT32 m_asyncUnderruns; // Written by the reading thread only
+    bool m_asyncPrevControl;
+    static void asyncRenderEntry(void *arg);
+    void asyncRender();
+
+    // Offline rendering of the whole song into a sink
+    enum { OFFLINE_FRAMES = 4096 };
+    void startOffline();
+    long renderOffline(UINT8 *buf, const EDMIDI_AudioFormat *format,
+                       EDMIDI_BatchSink sink, void *userData, unsigned long maxFrames);
 
     std::string m_error;
 
-    MidiSequencer *m_sequencer;
+    MidiSequencer *m_sequencer;     // Played by the renderer
+    MidiSequencer *m_front;         // The latest loaded one, for the controlling thread
     BW_MidiRtInterface *m_sequencerInterface;
+    // Copy of the interface for the loading thread, as the renderer changes
+    // the PCM fields of the other one. The swap gives the other one back.
+    BW_MidiRtInterface *m_loadInterface;
+    void syncLoadInterface();
     void initSequencerInterface();
+    void createDevices();
+    void destroyDevices();
+    void renderModules(int32_t *buf, size_t frames);
+    void mixBlock(int32_t *buf, size_t frames);
+    void mixModules(int32_t *buf, size_t frames);
+    int playStream(uint8_t *stream, size_t length, bool sequence);
+    int renderDirect(int frames, uint8_t *stream,
+                     void (*render)(void *, uint8_t *, size_t), uint32_t frameSize,
+                     bool sequence);
+    int renderFormat(int sampleCount,
+                     EDMIDI_UInt8 *left, EDMIDI_UInt8 *right,
+                     const EDMIDI_AudioFormat *format, bool sequence);
     std::vector<std::string> m_trackTitles;
+    void loadTrackTitles();
 
     double Tick(double s, double granularity);
 
@@ -43,14 +169,26 @@ public:
     ~CSMFPlay();
 
     bool Open(const char *filename);
-    bool Load(const void *buf, int size);
+    // With noCopy, the buffer must stay valid until other song is loaded.
+    // The asynchronous control copies it.
+    bool Load(const void *buf, int size, bool noCopy = false);
+    // Song cache made by SaveCache() of the same library build
+    bool LoadCache(const void *buf, size_t size);
+    // Returns the size of the cache, writes it only if buf can hold it
+    size_t SaveCache(void *buf, size_t size);
 
+    // Without sequence, only the chips are rendered, and the song stays still
     int Render(int *buf, size_t length);
-    int RenderS16(short *buf, size_t length);
+    int RenderS16(short *buf, size_t length, bool sequence = true);
     int RenderF32(float *buf, size_t length);
     int RenderFormat(int sampleCount,
                      EDMIDI_UInt8 *left, EDMIDI_UInt8 *right,
-                     const EDMIDI_AudioFormat *format);
+                     const EDMIDI_AudioFormat *format, bool sequence = true);
+    static bool IsFormatSupported(const EDMIDI_AudioFormat *format);
+
+    // Can be called by other thread than the rendering one, but by a single
+    // one. The offset is in frames from the start of the next rendered block.
+    bool rtEvent(UINT8 status, UINT8 channel, UINT8 data1, UINT8 data2, UINT32 frameOffset);
 
     void Start(bool reset = true);
     void Reset();
@@ -70,6 +208,26 @@ public:
     bool SeqEof();
 
     void SetModeEMIDI(bool enabled);
+    bool setNativeRateMixing(bool enabled);
+    bool setRenderThreads(int threads);
+    bool setLoadThreads(int threads);
+    // Don't call while another thread renders
+    bool setAsyncControl(bool enabled);
+
+    // Interleaved formats only
+    bool startAsyncRender(UINT32 bufferFrames, const EDMIDI_AudioFormat *format);
+    void stopAsyncRender();
+    bool isAsyncRendering() const;
+    // Copies the rendered frames out, the missing ones are silent
+    size_t readAsyncRender(UINT8 *out, size_t frames);
+    size_t getAsyncRenderFill() const;
+    size_t getAsyncRenderUnderruns() const;
+
+    // Renders the song from its start into the sink, the chips of the modules
+    // run on the threads. Interleaved formats only. Returns the count of the
+    // frames, -1 while the control is asynchronous, or -2 when the sink cancels.
+    long RenderOffline(int threads, const EDMIDI_AudioFormat *format,
+                       EDMIDI_BatchSink sink, void *userData, double maxSeconds);
 
     void setSongNum(int track);
     int getSongsCount();
@@ -21,6 +21,29 @@ static BYTE scctone[128][32] = {
 #include "SccWave.h"
 };
 
+// Pseudo registers 0xF8-0xFC carry the pan of the channels. The chip
+// doesn't decode them.
+#define PAN_REG 0xF8
+
+// Longest run of samples rendered before the silence of the chip is checked
+#define GATE_PERIOD 1024
+
+// Stereo gains (8.8 fixed point) per MIDI pan value: one step of the 4-bit
+// volume register per 4 steps off the center, like the volume register
+// attenuation used by the older two-chip output.
+static INT32 pan_table[128][2];
+static bool pan_table_initialized = false;
+
+static void makePanTable(void) {
+  for(int i=0;i<128;i++) {
+    int l = (64<i) ? 256 - (i-64)*256/60 : 256;
+    int r = (i<64) ? 256 - (64-i)*256/60 : 256;
+    pan_table[i][0] = (0<l) ? l : 0;
+    pan_table[i][1] = (0<r) ? r : 0;
+  }
+  pan_table_initialized = true;
+}
+
 void CSccDevice::_CalcEnvelope(void) {
 
   m_env_counter += m_env_incr;
@@ -74,16 +97,17 @@ void CSccDevice::_CalcEnvelope(void) {
 }
 
 CSccDevice::CSccDevice(DWORD rate, UINT nch): ISoundDevice(),
-    m_rbuf(2, RBuf(8200))
+    m_time(0), m_silent(false)
 {
 
   if(nch==2) m_nch = 2; else m_nch = 1;
   m_rate = rate;
 
-  {
-  for(UINT i=0;i<m_nch; i++)
-    m_scc[i] = SCC_new(3579545,rate);
-  }
+  if(!pan_table_initialized)
+    makePanTable();
+
+  // The stereo output is mixed by the chip from the per-channel pan gains
+  m_scc = SCC_new(3579545,rate);
 
   CSccDevice::Reset();
 
@@ -110,33 +134,26 @@ CSccDevice::CSccDevice(DWORD rate, UINT nch): ISoundDevice(),
 }
 
 CSccDevice::~CSccDevice(){
-  for(UINT i=0;i<m_nch; i++) {
-    m_rbuf[i].clear();
-    SCC_delete(m_scc[i]);
-  }
+  SCC_delete(m_scc);
 }
 
 const SoundDeviceInfo &
 CSccDevice::GetDeviceInfo(void) const {
 
-  static SoundDeviceInfo si;
-  si.max_ch = 5;
-  si.version = 0x0001;
-  si.name = (BYTE *)"SCC";
-  si.desc = (BYTE *)"";
+  static const SoundDeviceInfo si = { (BYTE *)"SCC", (BYTE *)"", 5, 0x0001 };
   return si;
 }
 
 RESULT CSccDevice::Reset(void) {
 
-  {
-  for(UINT i=0;i<m_nch; i++) {
-    SCC_reset(m_scc[i]);
-    SCC_set_type(m_scc[i],SCC_ENHANCED);
-    memset(m_reg_cache[i],0,256);
-    m_rbuf[i].clear();
-  }
-  }
+  SCC_reset(m_scc);
+  SCC_set_type(m_scc,SCC_ENHANCED);
+  memset(m_reg_cache,0,256);
+  // The chip resets the pan gains to the center
+  memset(m_reg_cache+PAN_REG,64,5);
+
+  m_wq.Clear();
+  m_silent = false;
 
   m_env_counter = 0;
   m_env_incr = (0x10000000/m_rate) * 60;
@@ -159,51 +176,96 @@ RESULT CSccDevice::Reset(void) {
   return SUCCESS;
 }
 
-void CSccDevice::_WriteReg(BYTE reg, BYTE val, INT pan) {
+void CSccDevice::_WriteReg(BYTE reg, BYTE val) {
 
-  if(m_nch==2) {
-    if(pan<0||1<pan) {
-      _WriteReg(reg,val,1);
-      pan = 0;
+  if(m_reg_cache[reg]!=val) {
+    // The queue is full: apply the oldest write ahead of its time
+    if(m_wq.Full()) {
+      const CRegWriteQueue::Entry &e = m_wq.Front();
+      _ApplyReg(e.reg, e.val);
+      m_wq.Pop();
     }
-  } else pan = 0;
-
-  if(m_reg_cache[pan][reg]!=val) {
-    SCC_writeReg(m_scc[pan], reg, val);
-    m_reg_cache[pan][reg] = val;  
+    m_wq.Push(m_time, reg, val, 0);
+    m_reg_cache[reg] = val;  
+  } 
+}
 
-    if(m_rbuf[pan].size() > 8185)
-        m_rbuf[pan].pop_front();// Clean-up the fill buffer from off the junk
+void CSccDevice::_ApplyReg(BYTE reg, BYTE val) {
+  m_silent = false;
+  if(reg<PAN_REG)
+    SCC_writeReg(m_scc, reg, val);
+  else
+    SCC_setPanGain(m_scc, reg-PAN_REG, pan_table[val&0x7F][0], pan_table[val&0x7F][1]);
+}
 
-    if(m_rbuf[pan].size()<8192) {
-      m_rbuf[pan].push_back(SCC_calc(m_scc[pan]));
-      if (!pan) _CalcEnvelope();
-    } else {
-      throw RuntimeException("Buffer Overflow",__FILE__,__LINE__);
-    }
-  } 
+void CSccDevice::_ApplyWrites(void) {
+  while(m_wq.Due(m_time)) {
+    const CRegWriteQueue::Entry &e = m_wq.Front();
+    _ApplyReg(e.reg, e.val);
+    m_wq.Pop();
+  }
 }
 
 RESULT CSccDevice::Render(INT32 buf[2]) {
+  buf[0] = buf[1] = 0;
+  return RenderBlock(buf, 1);
+}
+
+RESULT CSccDevice::RenderBlock(INT32 *buf, size_t frames) {
+
+  while(frames > 0) {
+    _ApplyWrites();
 
-  for(UINT i=0;i<m_nch;i++) {
-    if(m_rbuf[i].empty()) {
-      buf[i] = SCC_calc(m_scc[i]);
-	  if (!i) _CalcEnvelope();
-    } else {
-      buf[i] = m_rbuf[i].front().value;
-      m_rbuf[i].pop_front();
+    if(m_silent) {
+      // All zeros until the next write: skip the chip, and step only the
+      // counter of the envelopes, which are all finished.
+      UINT32 run = m_wq.Until(m_time, frames > 0x10000 ? 0x10000 : (UINT32)frames);
+      m_env_counter = (m_env_counter + run * m_env_incr) & 0xFFFFFFF;
+      m_time += run;
+      buf += run * 2;
+      frames -= run;
+      continue;
     }
+
+    // The envelope is stepped at every sample and writes the volume
+    // registers, so there are no long runs without writes here.
+    size_t run = frames > GATE_PERIOD ? GATE_PERIOD : frames;
+    for(size_t n=0; n<run; n++, buf+=2) {
+      _ApplyWrites();
+      if(m_nch<2) {
+        INT32 v = SCC_calc(m_scc);
+        buf[0] += v;
+        buf[1] += v;
+      } else {
+        // SCC_calc_stereo() has half of the SCC_calc() output level
+        C::e_int16 v[2];
+        SCC_calc_stereo(m_scc, v);
+        buf[0] += (INT32)v[0]<<1;
+        buf[1] += (INT32)v[1]<<1;
+      }
+      m_time++;
+      _CalcEnvelope();
+    }
+    frames -= run;
+
+    m_silent = _IsSilent();
   }
-  if(m_nch<2) 
-    buf[1] = buf[0];
   return SUCCESS;
 
 }
 
+bool CSccDevice::_IsSilent(void) {
+  for(int ch=0; ch<5; ch++) {
+    if(m_ci[ch].env_state != FINISH)
+      return false;
+  }
+  return SCC_isSilent(m_scc) != 0;
+}
+
 void CSccDevice::SetPan(UINT ch, UINT8 pan) {
   m_ci[ch].pan = pan;
-  _UpdateVolume(ch);
+  if(m_nch==2)
+    _WriteReg(PAN_REG+ch,pan);
 }
 
 void CSccDevice::_UpdateVolume(UINT ch) {
@@ -217,26 +279,7 @@ void CSccDevice::_UpdateVolume(UINT ch) {
     return;
   }
   
-  if(m_nch<2) {
-    _WriteReg(0xD0+ch,vol);
-    return;
-  }
-
-  // LEFT CHANNEL
-  if(64<m_ci[ch].pan) {
-    int tmp = vol - (m_ci[ch].pan-64)/4;
-    _WriteReg(0xD0+ch,(0<tmp)?tmp:0,0);
-  } else {
-    _WriteReg(0xD0+ch,vol,0);
-  }
-
-  // RIGHT CHANNEL
-  if(m_ci[ch].pan<64) {
-    int tmp = vol - (63-m_ci[ch].pan)/4;
-    _WriteReg(0xD0+ch,(0<tmp)?tmp:0,1);
-  } else {
-    _WriteReg(0xD0+ch,vol,1);
-  }
+  _WriteReg(0xD0+ch,vol);
 }
 
 void CSccDevice::_UpdateFreq(UINT ch) {
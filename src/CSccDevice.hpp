@@ -1,7 +1,6 @@
 #ifndef __CSCC_DEVICE_HPP__
 #define __CSCC_DEVICE_HPP__
-#include "structures/pl_list.hpp"
-#include <vector>
+#include <stdint.h>
 
 namespace dsa {
     namespace C {
@@ -11,6 +10,7 @@ namespace dsa {
 
 #include "DsaCommon.hpp"
 #include "ISoundDevice.hpp"
+#include "CRegWriteQueue.hpp"
 
 namespace dsa {
 
@@ -41,23 +41,28 @@ private:
   DWORD m_rate;
   UINT32 m_env_counter, m_env_incr;
   UINT m_nch;
-  C::SCC *m_scc[2];
-  BYTE m_reg_cache[2][0x100]; 
+  C::SCC *m_scc;
+  BYTE m_reg_cache[0x100]; 
   UINT16 m_note2freq[128];
   ChannelInfo m_ci[5];
-  typedef pl_list<INT32> RBuf;
-  std::vector<RBuf> m_rbuf; // The rendering buffer
+  CRegWriteQueue m_wq; // Register writes waiting for their sample
+  UINT32 m_time;       // Count of rendered samples
+  bool m_silent;       // Nothing sounds until the next register write
   void _UpdateVolume(UINT ch);
   void _UpdateFreq(UINT ch);
   void _UpdateProgram(UINT ch);
-  void _WriteReg(BYTE reg, BYTE val, INT pan=-1);
+  void _WriteReg(BYTE reg, BYTE val);
+  void _ApplyReg(BYTE reg, BYTE val);
   void _CalcEnvelope(void);
+  void _ApplyWrites(void);
+  bool _IsSilent(void);
 public:
   CSccDevice(DWORD rate=44100, UINT nch=2);
   virtual ~CSccDevice();
   const SoundDeviceInfo &GetDeviceInfo(void) const;
   RESULT Reset(void);
   RESULT Render(INT32 buf[2]);
+  RESULT RenderBlock(INT32 *buf, size_t frames);
 
   void PercKeyOn(UINT8 note){(void)note;}
   void PercKeyOff(UINT8 note){(void)note;}
@@ -0,0 +1,99 @@
+#include <math.h>
+#include <string.h>
+#include <stdint.h>
+#include "CStereoResampler.hpp"
+
+#if defined (_MSC_VER)
+#if defined (_DEBUG)
+#define new new( _CLIENT_BLOCK, __FILE__, __LINE__)
+#endif
+#endif
+
+using namespace dsa;
+
+static const double PI = 3.14159265358979323846;
+
+static double sinc(double x) {
+  return (x == 0.0) ? 1.0 : sin(PI * x) / (PI * x);
+}
+
+// Blackman window over -TAPS/2 <= x <= TAPS/2
+static double window(double x) {
+  double w = 0.5 + 0.5 * x / (CStereoResampler::TAPS / 2);
+  if(w < 0.0 || 1.0 < w) return 0.0;
+  return 0.42 - 0.5 * cos(2 * PI * w) + 0.08 * cos(4 * PI * w);
+}
+
+CStereoResampler::CStereoResampler(double inRate, double outRate) {
+
+  double ratio = inRate / outRate;
+  m_step_int = (UINT32)ratio;
+  m_step_frac = (UINT32)((ratio - m_step_int) * 4294967296.0);
+
+  // Cut off below the output Nyquist frequency when downsampling
+  double cut = (ratio > 1.0) ? 1.0 / ratio : 1.0;
+
+  for(int p=0; p<=PHASES; p++) {
+    double t = (double)p / PHASES;
+    double sum = 0.0;
+    double h[TAPS];
+    for(int k=0; k<TAPS; k++) {
+      double x = (k - (TAPS / 2 - 1)) - t;
+      h[k] = window(x) * sinc(x * cut);
+      sum += h[k];
+    }
+    // Every phase has the unity gain at DC
+    for(int k=0; k<TAPS; k++)
+      m_coef[p][k] = (float)(h[k] / sum);
+  }
+
+  Reset();
+}
+
+void CStereoResampler::Reset() {
+  memset(m_hist, 0, sizeof(m_hist));
+  m_pos = 0;
+  m_frac = 0;
+  // Fill the window up to the first input, so that the first output
+  // lands on it.
+  m_need = TAPS / 2 + 1;
+}
+
+size_t CStereoResampler::InputFrames(size_t outFrames) const {
+  if(outFrames == 0)
+    return 0;
+  uint64_t n = outFrames - 1;
+  return (size_t)(m_need + n * m_step_int + ((m_frac + n * m_step_frac) >> 32));
+}
+
+void CStereoResampler::Process(const INT32 *in, INT32 *out, size_t outFrames) {
+
+  for(size_t n=0; n<outFrames; n++, out+=2) {
+
+    for(; m_need > 0; m_need--, in+=2) {
+      m_hist[0][m_pos] = m_hist[0][m_pos + TAPS] = in[0];
+      m_hist[1][m_pos] = m_hist[1][m_pos + TAPS] = in[1];
+      m_pos = (m_pos + 1) & (TAPS - 1);
+    }
+
+    const float *c0 = m_coef[m_frac >> 24];
+    const float *c1 = m_coef[(m_frac >> 24) + 1];
+    const float t = (float)(m_frac & 0xFFFFFF) * (1.0f / 0x1000000);
+    const INT32 *l = m_hist[0] + m_pos;
+    const INT32 *r = m_hist[1] + m_pos;
+    double suml = 0.0, sumr = 0.0;
+
+    for(int k=0; k<TAPS; k++) {
+      float c = c0[k] + (c1[k] - c0[k]) * t;
+      suml += l[k] * c;
+      sumr += r[k] * c;
+    }
+    out[0] = (INT32)floor(suml + 0.5);
+    out[1] = (INT32)floor(sumr + 0.5);
+
+    UINT32 frac = m_frac + m_step_frac;
+    m_need = m_step_int + (frac < m_frac ? 1 : 0);
+    m_frac = frac;
+  }
+
+}
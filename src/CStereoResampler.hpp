@@ -0,0 +1,36 @@
+#ifndef __CSTEREO_RESAMPLER_HPP__
+#define __CSTEREO_RESAMPLER_HPP__
+#include <stddef.h>
+#include "DsaCommon.hpp"
+
+namespace dsa {
+
+// Windowed-sinc resampler of the interleaved stereo mix bus. The taps are
+// read from a polyphase table, which is interpolated linearly between the
+// phases, and the position is kept as a 32.32 fixed point counter.
+class CStereoResampler {
+public:
+  enum { TAPS = 16, PHASES = 256 };
+private:
+  float m_coef[PHASES + 1][TAPS];
+  INT32 m_hist[2][TAPS * 2];  // History, doubled to read the window in one piece
+  UINT m_pos;                 // Oldest frame of the window
+  UINT32 m_step_int, m_step_frac; // Input frames per output frame
+  UINT32 m_frac;              // Position of the next output between the inputs
+  UINT32 m_need;              // Input frames to take before the next output
+public:
+  CStereoResampler(double inRate, double outRate);
+
+  void Reset();
+
+  // Count of input frames which Process() takes to make `outFrames`
+  size_t InputFrames(size_t outFrames) const;
+
+  // Resample exactly InputFrames(outFrames) frames from `in` into
+  // `outFrames` frames of `out`. Both buffers are interleaved (L,R,L,R...).
+  void Process(const INT32 *in, INT32 *out, size_t outFrames);
+};
+
+} // namespace dsa
+
+#endif // __CSTEREO_RESAMPLER_HPP__
@@ -0,0 +1,228 @@
+#include <stddef.h>
+#include <time.h>
+#include "CThread.hpp"
+
+#if !defined(EDMIDI_DISABLE_THREADS)
+#   if defined(_WIN32)
+#       if !defined(_WIN32_WINNT) || _WIN32_WINNT < 0x0600
+#           undef _WIN32_WINNT
+#           define _WIN32_WINNT 0x0600 // Condition variables need Vista
+#       endif
+#       define NOMINMAX 1
+#       include <windows.h>
+#       define EDMIDI_THREADS_WIN32
+#   else
+#       include <pthread.h>
+#       define EDMIDI_THREADS_PTHREAD
+#   endif
+#endif
+
+#if defined (_MSC_VER)
+#if defined (_DEBUG)
+#define new new( _CLIENT_BLOCK, __FILE__, __LINE__)
+#endif
+#endif
+
+using namespace dsa;
+
+#if defined(EDMIDI_THREADS_PTHREAD)
+
+CMutex::CMutex() {
+  pthread_mutex_t *m = new pthread_mutex_t;
+  pthread_mutex_init(m, NULL);
+  m_impl = m;
+}
+
+CMutex::~CMutex() {
+  pthread_mutex_t *m = static_cast<pthread_mutex_t *>(m_impl);
+  pthread_mutex_destroy(m);
+  delete m;
+}
+
+void CMutex::Lock() { pthread_mutex_lock(static_cast<pthread_mutex_t *>(m_impl)); }
+void CMutex::Unlock() { pthread_mutex_unlock(static_cast<pthread_mutex_t *>(m_impl)); }
+
+CCondition::CCondition() {
+  pthread_cond_t *c = new pthread_cond_t;
+  pthread_cond_init(c, NULL);
+  m_impl = c;
+}
+
+CCondition::~CCondition() {
+  pthread_cond_t *c = static_cast<pthread_cond_t *>(m_impl);
+  pthread_cond_destroy(c);
+  delete c;
+}
+
+void CCondition::Wait(CMutex &mutex) {
+  pthread_cond_wait(static_cast<pthread_cond_t *>(m_impl),
+                    static_cast<pthread_mutex_t *>(mutex.m_impl));
+}
+
+void CCondition::Signal() { pthread_cond_signal(static_cast<pthread_cond_t *>(m_impl)); }
+void CCondition::Broadcast() { pthread_cond_broadcast(static_cast<pthread_cond_t *>(m_impl)); }
+
+struct ThreadStart {
+  pthread_t thread;
+  CThread::Entry entry;
+  void *arg;
+};
+
+static void *threadProc(void *arg) {
+  ThreadStart *s = static_cast<ThreadStart *>(arg);
+  s->entry(s->arg);
+  return NULL;
+}
+
+bool CThread::Start(Entry entry, void *arg) {
+  if(m_impl)
+    return false;
+  ThreadStart *s = new ThreadStart;
+  s->entry = entry;
+  s->arg = arg;
+  if(pthread_create(&s->thread, NULL, threadProc, s) != 0) {
+    delete s;
+    return false;
+  }
+  m_impl = s;
+  return true;
+}
+
+void CThread::Join() {
+  if(!m_impl)
+    return;
+  ThreadStart *s = static_cast<ThreadStart *>(m_impl);
+  pthread_join(s->thread, NULL);
+  delete s;
+  m_impl = NULL;
+}
+
+bool CThread::IsSupported() { return true; }
+
+void CThread::Sleep(unsigned milliseconds) {
+  struct timespec ts;
+  ts.tv_sec = milliseconds / 1000;
+  ts.tv_nsec = static_cast<long>(milliseconds % 1000) * 1000000L;
+  nanosleep(&ts, NULL);
+}
+
+double CThread::Clock() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) * 1e-9;
+}
+
+#elif defined(EDMIDI_THREADS_WIN32)
+
+CMutex::CMutex() {
+  CRITICAL_SECTION *m = new CRITICAL_SECTION;
+  InitializeCriticalSection(m);
+  m_impl = m;
+}
+
+CMutex::~CMutex() {
+  CRITICAL_SECTION *m = static_cast<CRITICAL_SECTION *>(m_impl);
+  DeleteCriticalSection(m);
+  delete m;
+}
+
+void CMutex::Lock() { EnterCriticalSection(static_cast<CRITICAL_SECTION *>(m_impl)); }
+void CMutex::Unlock() { LeaveCriticalSection(static_cast<CRITICAL_SECTION *>(m_impl)); }
+
+CCondition::CCondition() {
+  CONDITION_VARIABLE *c = new CONDITION_VARIABLE;
+  InitializeConditionVariable(c);
+  m_impl = c;
+}
+
+CCondition::~CCondition() {
+  delete static_cast<CONDITION_VARIABLE *>(m_impl);
+}
+
+void CCondition::Wait(CMutex &mutex) {
+  SleepConditionVariableCS(static_cast<CONDITION_VARIABLE *>(m_impl),
+                           static_cast<CRITICAL_SECTION *>(mutex.m_impl), INFINITE);
+}
+
+void CCondition::Signal() { WakeConditionVariable(static_cast<CONDITION_VARIABLE *>(m_impl)); }
+void CCondition::Broadcast() { WakeAllConditionVariable(static_cast<CONDITION_VARIABLE *>(m_impl)); }
+
+struct ThreadStart {
+  HANDLE thread;
+  CThread::Entry entry;
+  void *arg;
+};
+
+static DWORD WINAPI threadProc(LPVOID arg) {
+  ThreadStart *s = static_cast<ThreadStart *>(arg);
+  s->entry(s->arg);
+  return 0;
+}
+
+bool CThread::Start(Entry entry, void *arg) {
+  if(m_impl)
+    return false;
+  ThreadStart *s = new ThreadStart;
+  s->entry = entry;
+  s->arg = arg;
+  s->thread = CreateThread(NULL, 0, threadProc, s, 0, NULL);
+  if(!s->thread) {
+    delete s;
+    return false;
+  }
+  m_impl = s;
+  return true;
+}
+
+void CThread::Join() {
+  if(!m_impl)
+    return;
+  ThreadStart *s = static_cast<ThreadStart *>(m_impl);
+  WaitForSingleObject(s->thread, INFINITE);
+  CloseHandle(s->thread);
+  delete s;
+  m_impl = NULL;
+}
+
+bool CThread::IsSupported() { return true; }
+
+void CThread::Sleep(unsigned milliseconds) { ::Sleep(milliseconds); }
+
+double CThread::Clock() {
+  LARGE_INTEGER count, freq;
+  QueryPerformanceCounter(&count);
+  QueryPerformanceFrequency(&freq);
+  return static_cast<double>(count.QuadPart) / static_cast<double>(freq.QuadPart);
+}
+
+#else // No threads
+
+CMutex::CMutex() : m_impl(NULL) {}
+CMutex::~CMutex() {}
+void CMutex::Lock() {}
+void CMutex::Unlock() {}
+
+CCondition::CCondition() : m_impl(NULL) {}
+CCondition::~CCondition() {}
+void CCondition::Wait(CMutex &) {}
+void CCondition::Signal() {}
+void CCondition::Broadcast() {}
+
+bool CThread::Start(Entry, void *) { return false; }
+void CThread::Join() {}
+
+bool CThread::IsSupported() { return false; }
+
+void CThread::Sleep(unsigned) {}
+
+double CThread::Clock() {
+  return static_cast<double>(clock()) / CLOCKS_PER_SEC;
+}
+
+#endif
+
+CThread::CThread() : m_impl(NULL) {}
+
+CThread::~CThread() {
+  Join();
+}
@@ -0,0 +1,61 @@
+#ifndef __CTHREAD_HPP__
+#define __CTHREAD_HPP__
+#include "DsaCommon.hpp"
+
+namespace dsa {
+
+// Thin wrappers over the threads of the platform (pthreads or Win32).
+// When the library is built with EDMIDI_DISABLE_THREADS they do nothing
+// and CThread::Start() always fails.
+class CMutex {
+  friend class CCondition;
+  void *m_impl;
+  CMutex(const CMutex &);
+  CMutex &operator=(const CMutex &);
+public:
+  CMutex();
+  ~CMutex();
+  void Lock();
+  void Unlock();
+};
+
+class CCondition {
+  void *m_impl;
+  CCondition(const CCondition &);
+  CCondition &operator=(const CCondition &);
+public:
+  CCondition();
+  ~CCondition();
+  // The mutex must be locked by the caller
+  void Wait(CMutex &mutex);
+  void Signal();
+  void Broadcast();
+};
+
+class CThread {
+public:
+  typedef void (*Entry)(void *arg);
+private:
+  void *m_impl;
+  CThread(const CThread &);
+  CThread &operator=(const CThread &);
+public:
+  CThread();
+  ~CThread();
+  bool Start(Entry entry, void *arg);
+  void Join();
+  bool IsRunning() const { return m_impl != NULL; }
+
+  // Can this build start threads at all?
+  static bool IsSupported();
+
+  // Let other threads run for about the given time
+  static void Sleep(unsigned milliseconds);
+
+  // Seconds of a monotonic clock, to measure the time spent
+  static double Clock();
+};
+
+} // namespace dsa
+
+#endif // __CTHREAD_HPP__
@@ -0,0 +1,82 @@
+#include <stddef.h>
+#include "CWorkerPool.hpp"
+
+#if defined (_MSC_VER)
+#if defined (_DEBUG)
+#define new new( _CLIENT_BLOCK, __FILE__, __LINE__)
+#endif
+#endif
+
+using namespace dsa;
+
+CWorkerPool::CWorkerPool(int threads)
+  : m_threads(1), m_job(NULL), m_ctx(NULL), m_count(0), m_next(0),
+    m_pending(0), m_generation(0), m_quit(false) {
+
+  if(threads > MAX_THREADS) threads = MAX_THREADS;
+  for(int i=1; i<threads; i++) {
+    if(!m_thread[i].Start(WorkerEntry, this))
+      break;
+    m_threads++;
+  }
+}
+
+CWorkerPool::~CWorkerPool() {
+  m_mutex.Lock();
+  m_quit = true;
+  m_wake.Broadcast();
+  m_mutex.Unlock();
+  for(int i=1; i<MAX_THREADS; i++)
+    m_thread[i].Join();
+}
+
+void CWorkerPool::WorkerEntry(void *arg) {
+  static_cast<CWorkerPool *>(arg)->Worker();
+}
+
+void CWorkerPool::Drain() {
+  while(m_next < m_count) {
+    int index = m_next++;
+    m_mutex.Unlock();
+    m_job(m_ctx, index);
+    m_mutex.Lock();
+    if(--m_pending == 0)
+      m_done.Broadcast();
+  }
+}
+
+void CWorkerPool::Worker() {
+  UINT32 seen = 0;
+  m_mutex.Lock();
+  for(;;) {
+    while(!m_quit && seen == m_generation)
+      m_wake.Wait(m_mutex);
+    if(m_quit)
+      break;
+    seen = m_generation;
+    Drain();
+  }
+  m_mutex.Unlock();
+}
+
+void CWorkerPool::Run(Job job, void *ctx, int count) {
+
+  if(m_threads <= 1 || count <= 1) {
+    for(int i=0; i<count; i++)
+      job(ctx, i);
+    return;
+  }
+
+  m_mutex.Lock();
+  m_job = job;
+  m_ctx = ctx;
+  m_count = count;
+  m_next = 0;
+  m_pending = count;
+  m_generation++;
+  m_wake.Broadcast();
+  Drain();
+  while(m_pending > 0)
+    m_done.Wait(m_mutex);
+  m_mutex.Unlock();
+}
@@ -0,0 +1,44 @@
+#ifndef __CWORKER_POOL_HPP__
+#define __CWORKER_POOL_HPP__
+#include "CThread.hpp"
+
+namespace dsa {
+
+// Persistent pool of the threads which run the numbered jobs of a batch.
+// The calling thread takes the jobs too, so a pool of N threads starts
+// only N-1 workers.
+class CWorkerPool {
+public:
+  typedef void (*Job)(void *ctx, int index);
+  enum { MAX_THREADS = 16 };
+private:
+  CThread m_thread[MAX_THREADS];
+  int m_threads;            // Including the caller
+  CMutex m_mutex;
+  CCondition m_wake, m_done;
+  Job m_job;
+  void *m_ctx;
+  int m_count;              // Jobs in the current batch
+  int m_next;               // Next job to take
+  int m_pending;            // Jobs not finished yet
+  UINT32 m_generation;      // Counts the batches
+  bool m_quit;
+
+  static void WorkerEntry(void *arg);
+  void Worker();
+  // Take and run the jobs of the current batch. The mutex must be locked.
+  void Drain();
+public:
+  CWorkerPool(int threads);
+  ~CWorkerPool();
+
+  // Count of the threads which really run, including the caller
+  int Threads() const { return m_threads; }
+
+  // Run job(ctx, 0) ... job(ctx, count-1) and return when all are done.
+  void Run(Job job, void *ctx, int count);
+};
+
+} // namespace dsa
+
+#endif // __CWORKER_POOL_HPP__
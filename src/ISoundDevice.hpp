@@ -1,5 +1,6 @@
 #ifndef __DSA_ISOUND_DEVICE_HPP__
 #define __DSA_ISOUND_DEVICE_HPP__
+#include <cstddef>
 #include "DsaCommon.hpp"
 // dsa
 namespace dsa {
@@ -19,6 +20,9 @@ public:
   virtual const SoundDeviceInfo &GetDeviceInfo(void) const=0;
   virtual RESULT Reset(void)=0;
   virtual RESULT Render(INT32 buf[2])=0;
+  // Mix `frames` stereo frames into the interleaved buffer (L,R,L,R...).
+  // The output is added to the existing content of the buffer.
+  virtual RESULT RenderBlock(INT32 *buf, size_t frames)=0;
 
   virtual void SetProgram(UINT ch, UINT8 bank, UINT8 prog)=0;
   virtual void SetVelocity(UINT ch, UINT8 vel)=0;
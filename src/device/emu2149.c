@@ -112,6 +112,26 @@ PSG_setMask (PSG *psg, e_uint32 mask)
   return ret;
 }
 
+EMU2149_API int
+PSG_isSilent (PSG * psg)
+{
+  int i;
+
+  for (i = 0; i < 3; i++)
+  {
+    if (psg->mask & PSG_MASK_CH(i))
+      continue;
+    if (!(psg->volume[i] & 32) && psg->voltbl[psg->volume[i] & 31] == 0)
+      continue;
+    return 0;
+  }
+
+  if (psg->quality && psg->out)
+    return 0;
+
+  return 1;
+}
+
 EMU2149_API e_uint32
 PSG_toggleMask (PSG *psg, e_uint32 mask)
 {
@@ -17,6 +17,7 @@
 #define PSG_setVolumeMode  EDMIDI_PSG_setVolumeMode
 #define PSG_setMask     EDMIDI_PSG_setMask
 #define PSG_toggleMask  EDMIDI_PSG_toggleMask
+#define PSG_isSilent    EDMIDI_PSG_isSilent
 /* ------------------------------------------------------ */
 
 
@@ -102,6 +103,8 @@ extern "C"
   EMU2149_API void PSG_setVolumeMode (PSG * psg, int type);
   EMU2149_API e_uint32 PSG_setMask (PSG *, e_uint32 mask);
   EMU2149_API e_uint32 PSG_toggleMask (PSG *, e_uint32 mask);
+  /* 1 when the output stays at zero until the next register write */
+  EMU2149_API int PSG_isSilent (PSG *);
     
 #ifdef __cplusplus
 }
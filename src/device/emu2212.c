@@ -125,6 +125,28 @@ SCC_new (e_uint32 c, e_uint32 r)
   return scc;
 }
 
+EMU2212_API int
+SCC_isSilent (SCC * scc)
+{
+  int i;
+
+  for (i = 0; i < 5; i++)
+  {
+    if (scc->mask & SCC_MASK_CH(i))
+      continue;
+    if (scc->volume[i] == 0)
+      continue;
+    if (!((scc->ch_enable | scc->ch_enable_next) & (1 << i)))
+      continue;
+    return 0;
+  }
+
+  if (scc->quality && (scc->prev || scc->next))
+    return 0;
+
+  return 1;
+}
+
 EMU2212_API void
 SCC_reset (SCC * scc)
 {
@@ -142,15 +164,18 @@ SCC_reset (SCC * scc)
 
   for (i = 0; i < 5; i++)
   {
-    for (j = 0; j < 5; j++)
+    for (j = 0; j < 32; j++)
       scc->wave[i][j] = 0;
     scc->count[i] = 0;
+    scc->incr[i] = 0;
     scc->freq[i] = 0;
     scc->phase[i] = 0;
     scc->volume[i] = 0;
     scc->offset[i] = 0;
     scc->rotate[i] = 0;
     scc->ch_pan[i] = 3;
+    scc->ch_gain[i][0] = 256;
+    scc->ch_gain[i][1] = 256;
   }
 
   scc->mask = 0;
@@ -165,6 +190,7 @@ SCC_reset (SCC * scc)
   scc->out = 0;
   scc->prev = 0;
   scc->next = 0;
+  scc->scctime = 0;
 
   return;
 
@@ -512,12 +538,21 @@ SCC_set_type (SCC * scc, e_uint32 type)
   scc->type = type;
 }
 
+EMU2212_API void
+SCC_setPanGain (SCC * scc, e_uint32 ch, e_int32 l, e_int32 r)
+{
+  if (ch < 5)
+  {
+    scc->ch_gain[ch][0] = l;
+    scc->ch_gain[ch][1] = r;
+  }
+}
+
 EMU2212_API void
 SCC_calc_stereo (SCC * scc, e_int16 buf[2]) {
 
   int i;
-  e_int16 b;
-  buf[0] = buf[1] = 0;
+  e_int32 b, l = 0, r = 0;
 
   for (i = 0; i < 5; i++)
   {
@@ -537,17 +572,19 @@ SCC_calc_stereo (SCC * scc, e_int16 buf[2]) {
       if(!(scc->mask&SCC_MASK_CH(i))) {
         b = ((((e_int8) (scc->wave[i][scc->phase[i]]) * (e_int8) scc->volume[i]))) >> 4;
         if(scc->ch_pan[i]==1) 
-          buf[0]+=b;
+          l += b * scc->ch_gain[i][0];
         else if(scc->ch_pan[i]==2) 
-          buf[1]+=b;
+          r += b * scc->ch_gain[i][1];
         else {
-          buf[0]+=b; buf[1]+=b;
+          l += b * scc->ch_gain[i][0];
+          r += b * scc->ch_gain[i][1];
         }
       }
     }
   }
 
-  buf[0]<<=3;
-  buf[1]<<=3;
+  /* The gains are 8.8 fixed point */
+  buf[0] = (e_int16) (l >> 5);
+  buf[1] = (e_int16) (r >> 5);
 
 }
@@ -15,6 +15,8 @@
 #define SCC_read EDMIDI_SCC_read
 #define SCC_setMask EDMIDI_SCC_setMask
 #define SCC_toggleMask EDMIDI_SCC_toggleMask
+#define SCC_setPanGain EDMIDI_SCC_setPanGain
+#define SCC_isSilent EDMIDI_SCC_isSilent
 /* ------------------------------------------------------ */
 
 #ifdef EMU2212_DLL_EXPORTS
@@ -72,6 +74,7 @@ typedef struct __SCC {
   int rotate[5] ;
 
   int ch_pan[5];
+  e_int32 ch_gain[5][2];
 
 } SCC ;
 
@@ -89,6 +92,16 @@ EMU2212_API void SCC_writeReg(SCC *scc, e_uint32 adr, e_uint32 val) ;
 EMU2212_API e_uint32 SCC_read(SCC *scc, e_uint32 adr) ;
 EMU2212_API e_uint32 SCC_setMask(SCC *scc, e_uint32 adr) ;
 EMU2212_API e_uint32 SCC_toggleMask(SCC *scc, e_uint32 adr) ;
+/**
+ * Set the left and right output gains of a channel used by
+ * SCC_calc_stereo(). 256 is the unity gain.
+ */
+EMU2212_API void SCC_setPanGain(SCC *scc, e_uint32 ch, e_int32 l, e_int32 r) ;
+/**
+ * Return 1 when the output stays at zero until the next register write:
+ * every channel is muted, disabled or at zero volume.
+ */
+EMU2212_API int SCC_isSilent(SCC *scc) ;
 
 #ifdef __cplusplus
 }
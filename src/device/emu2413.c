@@ -254,83 +254,180 @@ static OPLL_PATCH default_patch[OPLL_TONE_NUM][(16 + 3) * 2];
 #define SINC_RESO 256
 #define SINC_AMP_BITS 12
 
+/* count of output samples which OPLL_calcStereoBlock() resamples at once */
+#define CONV_BLOCK 64
+
 /* fast conversion: 3-point average filter is used instead of sinc(x) table. rough and fast.*/
 #define USE_FAST_RATE_CONV 0
 
+/*
+ * SIMD kernels of the rate converter. Define EMU2413_NO_SIMD to build the
+ * scalar one only. All of them compute the same integer dot product, so
+ * the output doesn't depend on the kernel in use.
+ */
+#if !defined(EMU2413_NO_SIMD)
+#if defined(__AVX2__)
+#define CONV_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CONV_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define CONV_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
 /* double hamming(double x) { return 0.54 - 0.46 * cos(2 * PI * x); } */
 static double blackman(double x) { return 0.42 - 0.5 * cos(2 * _PI_ * x) + 0.08 * cos(4 * _PI_ * x); }
 static double sinc(double x) { return (x == 0.0 ? 1.0 : sin(_PI_ * x) / (_PI_ * x)); }
 static double windowed_sinc(double x) { return blackman(0.5 + 0.5 * x / (LW / 2)) * sinc(x); }
 
+static INLINE int16_t lookup_sinc_table(int16_t *table, double x) {
+  int16_t index = (int16_t)(x * SINC_RESO);
+  if (index < 0)
+    index = -index;
+  return table[min(SINC_RESO * LW / 2 - 1, index)];
+}
+
+/*
+ * The converter keeps the position of the output between two inputs as
+ * an exact fraction timer/f_out and takes the taps from a polyphase table
+ * of SINC_RESO phases. Each phase holds the taps which the sinc table
+ * gives for any position inside of it, so the output is the same as with
+ * a lookup of each tap at that position. Only the outputs which fall
+ * exactly onto a phase boundary (1 in f_out/gcd(f_out, SINC_RESO)) can
+ * take some taps from the neighbouring table entries. The older converter
+ * accumulated the position in double and rounded it off to either side of
+ * a boundary there. The difference between both stays below -55dB of the
+ * signal at 22050 to 96000Hz outputs.
+ */
+
 /* f_inp: input frequency. f_out: output frequencey, ch: number of channels */
 OPLL_RateConv *OPLL_RateConv_new(double f_inp, double f_out, int ch) {
   OPLL_RateConv *conv = (OPLL_RateConv *) malloc(sizeof(OPLL_RateConv));
-  int i;
+  const double f_ratio = f_inp / f_out;
+  int16_t *sinc_table;
+  int i, k;
 
   conv->ch = ch;
-  conv->f_ratio = f_inp / f_out;
+  conv->f_inp = (uint32_t)(f_inp + 0.5);
+  conv->f_out = (uint32_t)(f_out + 0.5);
+  conv->timer_step = conv->f_inp % conv->f_out;
+  conv->phase_mul = (uint32_t)(((uint64_t)SINC_RESO << 32) / conv->f_out) + 1;
+
+  /* enough room for all inputs of CONV_BLOCK outputs after the window */
+  conv->size = LW + CONV_BLOCK * (conv->f_inp / conv->f_out + 2);
   conv->buf = (int16_t **) malloc(sizeof(void *) * ch);
+  conv->len = (uint32_t *) malloc(sizeof(uint32_t) * ch);
   for (i = 0; i < ch; i++) {
-    conv->buf[i] = (int16_t *) malloc(sizeof(conv->buf[0][0]) * LW);
+    conv->buf[i] = (int16_t *) malloc(sizeof(conv->buf[0][0]) * conv->size);
   }
 
   /* create sinc_table for positive 0 <= x < LW/2 */
-  conv->sinc_table = (int16_t *) malloc(sizeof(conv->sinc_table[0]) * SINC_RESO * LW / 2);
+  sinc_table = (int16_t *) malloc(sizeof(sinc_table[0]) * SINC_RESO * LW / 2);
   for (i = 0; i < SINC_RESO * LW / 2; i++) {
     const double x = (double)i / SINC_RESO;
     if (f_out < f_inp) {
       /* for downsampling */
-      conv->sinc_table[i] = (int16_t)((1 << SINC_AMP_BITS) * windowed_sinc(x / conv->f_ratio) / conv->f_ratio);
+      sinc_table[i] = (int16_t)((1 << SINC_AMP_BITS) * windowed_sinc(x / f_ratio) / f_ratio);
     } else {
       /* for upsampling */
-      conv->sinc_table[i] = (int16_t)((1 << SINC_AMP_BITS) * windowed_sinc(x));
+      sinc_table[i] = (int16_t)((1 << SINC_AMP_BITS) * windowed_sinc(x));
     }
   }
 
-  return conv;
-}
+  /* spread it into the taps of each phase, looked up in the middle of the phase */
+  conv->poly_table = (int16_t *) malloc(sizeof(conv->poly_table[0]) * SINC_RESO * LW);
+  for (i = 0; i < SINC_RESO; i++) {
+    const double dn = (i + 0.5) / SINC_RESO;
+    for (k = 0; k < LW; k++) {
+      conv->poly_table[i * LW + k] = lookup_sinc_table(sinc_table, ((double)k - (LW / 2 - 1)) - dn);
+    }
+  }
+  free(sinc_table);
 
-static INLINE int16_t lookup_sinc_table(int16_t *table, double x) {
-  int16_t index = (int16_t)(x * SINC_RESO);
-  if (index < 0)
-    index = -index;
-  return table[min(SINC_RESO * LW / 2 - 1, index)];
+  return conv;
 }
 
 void OPLL_RateConv_reset(OPLL_RateConv *conv) {
   int i;
   conv->timer = 0;
+  conv->phase = 0;
   for (i = 0; i < conv->ch; i++) {
     memset(conv->buf[i], 0, sizeof(conv->buf[i][0]) * LW);
+    conv->len[i] = LW;
+  }
+}
+
+/* move the latest `keep` inputs to the head of the history buffers */
+static INLINE void compact_history(OPLL_RateConv *conv, int ch, uint32_t keep) {
+  if (conv->len[ch] > keep) {
+    memmove(conv->buf[ch], conv->buf[ch] + conv->len[ch] - keep, sizeof(conv->buf[0][0]) * keep);
+    conv->len[ch] = keep;
   }
 }
 
 /* put original data to this converter at f_inp. */
 void OPLL_RateConv_putData(OPLL_RateConv *conv, int ch, int16_t data) {
-  int16_t *buf = conv->buf[ch];
-  int i;
-  for (i = 0; i < LW - 1; i++) {
-    buf[i] = buf[i + 1];
+  if (conv->len[ch] == conv->size) {
+    compact_history(conv, ch, LW - 1);
   }
-  buf[LW - 1] = data;
+  conv->buf[ch][conv->len[ch]++] = data;
+}
+
+/* step the position of the output and return its phase */
+static INLINE uint32_t next_phase(OPLL_RateConv *conv) {
+  conv->timer += conv->timer_step;
+  if (conv->timer >= conv->f_out)
+    conv->timer -= conv->f_out;
+  return (uint32_t)(((uint64_t)conv->timer * conv->phase_mul) >> 32);
+}
+
+/* dot product of LW inputs and LW taps */
+static INLINE int32_t conv_dot(const int16_t *x, const int16_t *h) {
+#if defined(CONV_AVX2) && LW == 16
+  __m256i s = _mm256_madd_epi16(_mm256_loadu_si256((const __m256i *)x), _mm256_loadu_si256((const __m256i *)h));
+  __m128i t = _mm_add_epi32(_mm256_castsi256_si128(s), _mm256_extracti128_si256(s, 1));
+  t = _mm_add_epi32(t, _mm_shuffle_epi32(t, _MM_SHUFFLE(1, 0, 3, 2)));
+  t = _mm_add_epi32(t, _mm_shuffle_epi32(t, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtsi128_si32(t);
+#elif defined(CONV_SSE2) || defined(CONV_AVX2)
+  __m128i t = _mm_setzero_si128();
+  int k;
+  for (k = 0; k < LW; k += 8) {
+    t = _mm_add_epi32(t, _mm_madd_epi16(_mm_loadu_si128((const __m128i *)(x + k)), _mm_loadu_si128((const __m128i *)(h + k))));
+  }
+  t = _mm_add_epi32(t, _mm_shuffle_epi32(t, _MM_SHUFFLE(1, 0, 3, 2)));
+  t = _mm_add_epi32(t, _mm_shuffle_epi32(t, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtsi128_si32(t);
+#elif defined(CONV_NEON)
+  int32x4_t t = vdupq_n_s32(0);
+  int32x2_t u;
+  int k;
+  for (k = 0; k < LW; k += 4) {
+    t = vmlal_s16(t, vld1_s16(x + k), vld1_s16(h + k));
+  }
+  u = vadd_s32(vget_low_s32(t), vget_high_s32(t));
+  return vget_lane_s32(vpadd_s32(u, u), 0);
+#else
+  int32_t sum = 0;
+  int k;
+  for (k = 0; k < LW; k++) {
+    sum += x[k] * h[k];
+  }
+  return sum;
+#endif
 }
 
 /* get resampled data from this converter at f_out. */
 /* this function must be called f_out / f_inp times per one putData call. */
+/* the position of the output advances when channel 0 is read. */
 int16_t OPLL_RateConv_getData(OPLL_RateConv *conv, int ch) {
-  int16_t *buf = conv->buf[ch];
-  int32_t sum = 0;
-  int k;
-  double dn;
-  conv->timer += conv->f_ratio;
-  dn = conv->timer - floor(conv->timer);
-  conv->timer = dn;
-
-  for (k = 0; k < LW; k++) {
-    double x = ((double)k - (LW / 2 - 1)) - dn;
-    sum += buf[k] * lookup_sinc_table(conv->sinc_table, x);
+  if (ch == 0) {
+    conv->phase = next_phase(conv);
   }
-  return sum >> SINC_AMP_BITS;
+  return conv_dot(conv->buf[ch] + conv->len[ch] - LW, conv->poly_table + conv->phase * LW) >> SINC_AMP_BITS;
 }
 
 void OPLL_RateConv_delete(OPLL_RateConv *conv) {
@@ -339,7 +436,8 @@ void OPLL_RateConv_delete(OPLL_RateConv *conv) {
     free(conv->buf[i]);
   }
   free(conv->buf);
-  free(conv->sinc_table);
+  free(conv->len);
+  free(conv->poly_table);
   free(conv);
 }
 
@@ -563,7 +661,11 @@ static void reset_slot(OPLL_SLOT *slot, int number) {
   slot->output[0] = 0;
   slot->output[1] = 0;
   slot->eg_state = RELEASE;
+  slot->last_eg_state = RELEASE;
   slot->eg_shift = 0;
+  slot->eg_rate_h = 0;
+  slot->eg_rate_l = 0;
+  slot->update_requests = 0;
   slot->rks = 0;
   slot->tll = 0;
   slot->sus_flag = 0;
@@ -1098,9 +1200,9 @@ INLINE static void mix_output_stereo(OPLL *opll) {
   out[0] = out[1] = 0;
   for (i = 0; i < 15; i++) {
     if (opll->pan[i] & 1)
-      out[1] += opll->ch_out[i];
+      out[1] += (int16_t)(opll->ch_out[i] * opll->pan_fine[i][1]);
     if (opll->pan[i] & 2)
-      out[0] += opll->ch_out[i];
+      out[0] += (int16_t)(opll->ch_out[i] * opll->pan_fine[i][0]);
   }
   if (opll->conv) {
     OPLL_RateConv_putData(opll->conv, 0, out[0]);
@@ -1184,6 +1286,9 @@ void OPLL_reset(OPLL *opll) {
   opll->am_phase = 0;
 
   opll->noise_seed = 0xffff;
+  opll->noise = 0;
+  opll->short_noise = 0;
+  opll->lfo_am = 0;
   opll->mask = 0;
 
   opll->rhythm_mode = 0;
@@ -1199,17 +1304,25 @@ void OPLL_reset(OPLL *opll) {
     set_patch(opll, i, 0);
   }
 
+  /* start from the zeroed registers as a new chip does, so the key-on
+     bits left in them can't turn the slots on again */
+  memset(opll->reg, 0, sizeof(opll->reg));
   for (i = 0; i < 0x40; i++)
     OPLL_writeReg(opll, i, 0);
 
   opll->pm_dphase = PM_DP_WIDTH / (1024 * 8);
 
-  for (i = 0; i < 15; i++)
+  for (i = 0; i < 15; i++) {
     opll->pan[i] = 3;
+    opll->pan_fine[i][0] = 1.0f;
+    opll->pan_fine[i][1] = 1.0f;
+  }
 
   for (i = 0; i < 15; i++) {
     opll->ch_out[i] = 0;
   }
+  opll->mix_out[0] = 0;
+  opll->mix_out[1] = 0;
 }
 
 void OPLL_forceRefresh(OPLL *opll) {
@@ -1422,6 +1535,11 @@ void OPLL_writeIO(OPLL *opll, uint32_t adr, uint8_t val) {
 
 void OPLL_setPan(OPLL *opll, uint32_t ch, uint8_t pan) { opll->pan[ch & 15] = pan & 3; }
 
+void OPLL_setPanFine(OPLL *opll, uint32_t ch, float pan[2]) {
+  opll->pan_fine[ch & 15][0] = pan[0];
+  opll->pan_fine[ch & 15][1] = pan[1];
+}
+
 void OPLL_dumpToPatch(const uint8_t *dump, OPLL_PATCH *patch) {
   patch[0].AM = (dump[0] >> 7) & 1;
   patch[1].AM = (dump[1] >> 7) & 1;
@@ -1499,6 +1617,53 @@ int16_t OPLL_calc(OPLL *opll) {
   return opll->mix_out[0];
 }
 
+void OPLL_calcStereoBlock(OPLL *opll, int32_t *buf, uint32_t n) {
+  OPLL_RateConv *conv = opll->conv;
+  uint32_t end[CONV_BLOCK], phase[CONV_BLOCK];
+  uint32_t i, m;
+  int ch;
+
+  if (!conv) {
+    int32_t out[2];
+    for (i = 0; i < n; i++, buf += 2) {
+      OPLL_calcStereo(opll, out);
+      buf[0] += out[0];
+      buf[1] += out[1];
+    }
+    return;
+  }
+
+  while (n > 0) {
+    m = min(n, CONV_BLOCK);
+
+    /* synthesize all inputs of the block first */
+    compact_history(conv, 0, LW);
+    compact_history(conv, 1, LW);
+    for (i = 0; i < m; i++) {
+      while (opll->out_step > opll->out_time) {
+        opll->out_time += opll->inp_step;
+        update_output(opll);
+        mix_output_stereo(opll);
+      }
+      opll->out_time -= opll->out_step;
+      end[i] = conv->len[0] - LW;
+      phase[i] = next_phase(conv) * LW;
+    }
+
+    /* then resample them */
+    for (ch = 0; ch < 2; ch++) {
+      const int16_t *x = conv->buf[ch];
+      int32_t *out = buf + ch;
+      for (i = 0; i < m; i++, out += 2) {
+        *out += (int16_t)(conv_dot(x + end[i], conv->poly_table + phase[i]) >> SINC_AMP_BITS);
+      }
+    }
+
+    buf += m * 2;
+    n -= m;
+  }
+}
+
 void OPLL_calcStereo(OPLL *opll, int32_t out[2]) {
   while (opll->out_step > opll->out_time) {
     opll->out_time += opll->inp_step;
@@ -1515,6 +1680,35 @@ void OPLL_calcStereo(OPLL *opll, int32_t out[2]) {
   }
 }
 
+int OPLL_isSilent(OPLL *opll) {
+  int i, ch, k;
+
+  if (opll->test_flag)
+    return 0;
+
+  /* a slot stays silent once its envelope is decayed out, unless it is keyed on again */
+  for (i = 0; i < 18; i++) {
+    OPLL_SLOT *slot = &opll->slot[i];
+    if (slot->eg_out < EG_MAX || slot->eg_state == ATTACK || slot->eg_state == DAMP)
+      return 0;
+  }
+
+  /* and so does the output, once the latest samples are out of the rate converter */
+  if (opll->mix_out[0] || opll->mix_out[1])
+    return 0;
+  if (opll->conv) {
+    for (ch = 0; ch < opll->conv->ch; ch++) {
+      const int16_t *x = opll->conv->buf[ch] + opll->conv->len[ch] - LW;
+      for (k = 0; k < LW; k++) {
+        if (x[k])
+          return 0;
+      }
+    }
+  }
+
+  return 1;
+}
+
 uint32_t OPLL_setMask(OPLL *opll, uint32_t mask) {
   uint32_t ret;
 
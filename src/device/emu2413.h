@@ -17,6 +17,9 @@
 #define OPLL_setRate EDMIDI_OPLL_setRate
 #define OPLL_setQuality EDMIDI_OPLL_setQuality
 #define OPLL_setPan EDMIDI_OPLL_setPan
+#define OPLL_setPanFine EDMIDI_OPLL_setPanFine
+#define OPLL_calcStereoBlock EDMIDI_OPLL_calcStereoBlock
+#define OPLL_isSilent EDMIDI_OPLL_isSilent
 #define OPLL_setChipMode EDMIDI_OPLL_setChipMode
 #define OPLL_writeIO EDMIDI_OPLL_writeIO
 #define OPLL_writeReg EDMIDI_OPLL_writeReg
@@ -98,10 +101,15 @@ typedef struct __OPLL_SLOT {
 /* rate conveter */
 typedef struct __OPLL_RateConv {
   int ch;
-  double timer;
-  double f_ratio;
-  int16_t *sinc_table;
-  int16_t **buf;
+  uint32_t f_inp, f_out;
+  uint32_t timer;       /* position of the output between the inputs, in 1/f_out */
+  uint32_t timer_step;
+  uint32_t phase_mul;   /* maps the timer onto the phases of poly_table */
+  uint32_t phase;
+  int16_t *poly_table;  /* polyphase table of the sinc(x) taps */
+  int16_t **buf;        /* input history of each channel, the latest is at buf[ch][len[ch] - 1] */
+  uint32_t *len;
+  uint32_t size;
 } OPLL_RateConv;
 
 OPLL_RateConv *OPLL_RateConv_new(double f_inp, double f_out, int ch);
@@ -147,6 +155,7 @@ typedef struct __OPLL {
   int32_t patch_update[2]; /* flag for check patch update */
 
   uint8_t pan[16]; /* pan flag */
+  float pan_fine[16][2]; /* pan gains of the stereo output */
   uint32_t mask;
 
   /* output of each channels
@@ -189,6 +198,14 @@ void OPLL_setQuality(OPLL *opll, uint8_t q);
  */
 void OPLL_setPan(OPLL *opll, uint32_t ch, uint8_t pan);
 
+/**
+ * Set fine-grained panning (extra function - not YM2413 chip feature)
+ * @param ch 0..8: tone channels, 9..13: rhythm (BD, HH, SD, TOM, CYM)
+ * @param pan output gains of left (pan[0]) and right (pan[1]), from 0.0 to 1.0
+ * Gains apply to the output of `OPLL_calcStereo` only.
+ */
+void OPLL_setPanFine(OPLL *opll, uint32_t ch, float pan[2]);
+
 /**
  * Set chip mode
  * @param mode 0:YM2413, 1:VRC7
@@ -208,6 +225,19 @@ int16_t OPLL_calc(OPLL *opll);
  */
 void OPLL_calcStereo(OPLL *opll, int32_t out[2]);
 
+/**
+ * Calculate `n` stereo samples and add them to the interleaved buffer `buf`.
+ * The result is the same as of `n` calls to OPLL_calcStereo, but the rate
+ * converter processes the whole block at once.
+ */
+void OPLL_calcStereoBlock(OPLL *opll, int32_t *buf, uint32_t n);
+
+/**
+ * Check whether the chip outputs nothing but zeros until the next register write.
+ * @return 1 when every slot has decayed out and the output is at zero.
+ */
+int OPLL_isSilent(OPLL *opll);
+
 void OPLL_setPatch(OPLL *, const uint8_t *dump);
 void OPLL_copyPatch(OPLL *, int32_t, OPLL_PATCH *);
 
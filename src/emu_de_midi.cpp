@@ -22,6 +22,8 @@
 
 #include "../include/emu_de_midi.h"
 #include "CSMFPlay.hpp"
+#include "CThread.hpp"
+#include "CBatchRenderer.hpp"
 #include <string>
 #include <stdlib.h>
 #include <stdio.h>
@@ -170,6 +172,63 @@ EDMIDI_EXPORT int edmidi_openData(struct EDMIDIPlayer *device, const void *mem,
     return -1;
 }
 
+EDMIDI_EXPORT int edmidi_openDataNoCopy(struct EDMIDIPlayer *device, const void *mem, unsigned long size)
+{
+    if(device)
+    {
+        MidiPlayer *play = GET_MIDI_PLAYER(device);
+        assert(play);
+        if(!play->Load(mem, static_cast<int>(size), true))
+        {
+            std::string err = play->getErrorString();
+            if(err.empty())
+                play->setErrorString("Emu De MIDI: Can't load data from memory");
+            return -1;
+        }
+        else return 0;
+    }
+
+    sprintf(EDMIDI_ErrorString, "Can't load file: Emu De MIDI is not initialized");
+    return -1;
+}
+
+EDMIDI_EXPORT long edmidi_saveSongCache(struct EDMIDIPlayer *device, void *dst, unsigned long size)
+{
+    if(!device)
+        return -1;
+
+    MidiPlayer *play = GET_MIDI_PLAYER(device);
+    assert(play);
+    size_t ret = play->SaveCache(dst, static_cast<size_t>(size));
+    if(ret == 0)
+    {
+        play->setErrorString("Emu De MIDI: No song loaded");
+        return -1;
+    }
+
+    return static_cast<long>(ret);
+}
+
+EDMIDI_EXPORT int edmidi_openSongCache(struct EDMIDIPlayer *device, const void *mem, unsigned long size)
+{
+    if(device)
+    {
+        MidiPlayer *play = GET_MIDI_PLAYER(device);
+        assert(play);
+        if(!play->LoadCache(mem, static_cast<size_t>(size)))
+        {
+            std::string err = play->getErrorString();
+            if(err.empty())
+                play->setErrorString("Emu De MIDI: Can't load song cache");
+            return -1;
+        }
+        else return 0;
+    }
+
+    sprintf(EDMIDI_ErrorString, "Can't load file: Emu De MIDI is not initialized");
+    return -1;
+}
+
 EDMIDI_EXPORT void edmidi_selectSongNum(struct EDMIDIPlayer *device, int songNumber)
 {
     if(!device)
@@ -387,6 +446,8 @@ EDMIDI_EXPORT int edmidi_play(struct EDMIDIPlayer *device, int sampleCount, shor
         return -1;
     MidiPlayer *play = GET_MIDI_PLAYER(device);
     assert(play);
+    if(play->isAsyncRendering())
+        return -1; // The render thread plays
     return play->RenderS16(out, sampleCount >> 1);
 }
 
@@ -396,6 +457,8 @@ EDMIDI_EXPORT int edmidi_playF32(EDMIDIPlayer *device, int sampleCount, float *o
         return -1;
     MidiPlayer *play = GET_MIDI_PLAYER(device);
     assert(play);
+    if(play->isAsyncRendering())
+        return -1; // The render thread plays
     return play->RenderF32(out, sampleCount >> 1);
 }
 
@@ -407,9 +470,35 @@ EDMIDI_EXPORT int edmidi_playFormat(EDMIDIPlayer *device, int sampleCount,
         return -1;
     MidiPlayer *play = GET_MIDI_PLAYER(device);
     assert(play);
+    if(play->isAsyncRendering())
+        return -1; // The render thread plays
     return play->RenderFormat(sampleCount, left, right, format);
 }
 
+EDMIDI_EXPORT int edmidi_generate(struct EDMIDIPlayer *device, int sampleCount, short *out)
+{
+    if(!device)
+        return -1;
+    MidiPlayer *play = GET_MIDI_PLAYER(device);
+    assert(play);
+    if(play->isAsyncRendering())
+        return -1; // The render thread plays
+    return play->RenderS16(out, sampleCount >> 1, false);
+}
+
+EDMIDI_EXPORT int edmidi_generateFormat(EDMIDIPlayer *device, int sampleCount,
+                                     EDMIDI_UInt8 *left, EDMIDI_UInt8 *right,
+                                     const EDMIDI_AudioFormat *format)
+{
+    if(!device)
+        return -1;
+    MidiPlayer *play = GET_MIDI_PLAYER(device);
+    assert(play);
+    if(play->isAsyncRendering())
+        return -1; // The render thread plays
+    return play->RenderFormat(sampleCount, left, right, format, false);
+}
+
 EDMIDI_EXPORT void edmidi_setDebugMessageHook(struct EDMIDIPlayer *device, EDMIDI_DebugMessageHook debugMessageHook, void *userData)
 {
     if(!device)
@@ -474,3 +563,271 @@ EDMIDI_EXPORT void edmidi_setModeEMIDI(EDMIDIPlayer *device, int emidiEn)
     assert(play);
     play->SetModeEMIDI(emidiEn != 0);
 }
+
+EDMIDI_EXPORT void edmidi_setNativeRateMixing(EDMIDIPlayer *device, int nativeRate)
+{
+    if(!device)
+        return;
+    MidiPlayer *play = GET_MIDI_PLAYER(device);
+    assert(play);
+    if(!play->setNativeRateMixing(nativeRate != 0))
+        play->setErrorString("Emu De MIDI: Can't change the mixing mode while the render thread runs");
+}
+
+EDMIDI_EXPORT int edmidi_setRenderThreads(EDMIDIPlayer *device, int threads)
+{
+    if(!device)
+        return -1;
+    MidiPlayer *play = GET_MIDI_PLAYER(device);
+    assert(play);
+    if(play->isAsyncRendering())
+    {
+        play->setErrorString("Emu De MIDI: Can't change the threads while the render thread runs");
+        return -1;
+    }
+    if(!play->setRenderThreads(threads))
+    {
+        play->setErrorString("Emu De MIDI: Threads are not supported by this build");
+        return -1;
+    }
+    return 0;
+}
+
+EDMIDI_EXPORT int edmidi_setLoadThreads(EDMIDIPlayer *device, int threads)
+{
+    if(!device)
+        return -1;
+    MidiPlayer *play = GET_MIDI_PLAYER(device);
+    assert(play);
+    if(play->isAsyncRendering())
+    {
+        play->setErrorString("Emu De MIDI: Can't change the threads while the render thread runs");
+        return -1;
+    }
+    if(!play->setLoadThreads(threads))
+    {
+        play->setErrorString("Emu De MIDI: Threads are not supported by this build");
+        return -1;
+    }
+    return 0;
+}
+
+EDMIDI_EXPORT void edmidi_setAsyncControl(EDMIDIPlayer *device, int enabled)
+{
+    if(!device)
+        return;
+    MidiPlayer *play = GET_MIDI_PLAYER(device);
+    assert(play);
+    if(!play->setAsyncControl(enabled != 0))
+        play->setErrorString("Emu De MIDI: Can't change the control mode while the render thread runs");
+}
+
+EDMIDI_EXPORT int edmidi_startAsyncRender(EDMIDIPlayer *device, unsigned int bufferFrames)
+{
+    EDMIDI_AudioFormat format;
+    format.type = EDMIDI_SampleType_S16;
+    format.containerSize = sizeof(EDMIDI_SInt16);
+    format.sampleOffset = sizeof(EDMIDI_SInt16) * 2;
+    return edmidi_startAsyncRenderFormat(device, bufferFrames, &format);
+}
+
+EDMIDI_EXPORT int edmidi_startAsyncRenderFormat(EDMIDIPlayer *device, unsigned int bufferFrames,
+                                                const EDMIDI_AudioFormat *format)
+{
+    if(!device || !format)
+        return -1;
+    MidiPlayer *play = GET_MIDI_PLAYER(device);
+    assert(play);
+    if(play->isAsyncRendering())
+    {
+        play->setErrorString("Emu De MIDI: The render thread already runs");
+        return -1;
+    }
+    if(!dsa::CThread::IsSupported())
+    {
+        play->setErrorString("Emu De MIDI: Threads are not supported by this build");
+        return -1;
+    }
+    if(!play->startAsyncRender(bufferFrames, format))
+    {
+        play->setErrorString("Emu De MIDI: Can't start the render thread (invalid buffer size or format)");
+        return -1;
+    }
+    return 0;
+}
+
+EDMIDI_EXPORT void edmidi_stopAsyncRender(EDMIDIPlayer *device)
+{
+    if(!device)
+        return;
+    MidiPlayer *play = GET_MIDI_PLAYER(device);
+    assert(play);
+    play->stopAsyncRender();
+}
+
+EDMIDI_EXPORT int edmidi_readAsyncRender(EDMIDIPlayer *device, int sampleCount, EDMIDI_UInt8 *out)
+{
+    if(!device || sampleCount < 0)
+        return -1;
+    MidiPlayer *play = GET_MIDI_PLAYER(device);
+    assert(play);
+    // No error string here: this is called by the audio thread
+    if(!play->isAsyncRendering())
+        return -1;
+    return static_cast<int>(play->readAsyncRender(out, static_cast<size_t>(sampleCount >> 1)) * 2);
+}
+
+EDMIDI_EXPORT unsigned long edmidi_asyncRenderFill(EDMIDIPlayer *device)
+{
+    if(!device)
+        return 0;
+    MidiPlayer *play = GET_MIDI_PLAYER(device);
+    assert(play);
+    return static_cast<unsigned long>(play->getAsyncRenderFill());
+}
+
+EDMIDI_EXPORT unsigned long edmidi_asyncRenderUnderruns(EDMIDIPlayer *device)
+{
+    if(!device)
+        return 0;
+    MidiPlayer *play = GET_MIDI_PLAYER(device);
+    assert(play);
+    return static_cast<unsigned long>(play->getAsyncRenderUnderruns());
+}
+
+
+/* ======== Offline batch rendering ======== */
+
+EDMIDI_EXPORT int edmidi_renderBatch(const EDMIDI_BatchSettings *settings, EDMIDI_BatchJob *jobs, int count)
+{
+    memset(EDMIDI_ErrorString, 0, sizeof(EDMIDI_ErrorString));
+
+    if(!settings || settings->sampleRate <= 0 || (!jobs && count > 0) || count < 0)
+    {
+        sprintf(EDMIDI_ErrorString, "Emu De MIDI: Invalid batch arguments!");
+        return -1;
+    }
+
+    int modules = settings->modules ? settings->modules : 8;
+    if(modules < 2 || (modules & 1))
+    {
+        sprintf(EDMIDI_ErrorString, "Emu De MIDI: modules number must be an even number, 2 or more!");
+        return -1;
+    }
+
+    EDMIDI_AudioFormat format;
+    format.type = EDMIDI_SampleType_S16;
+    format.containerSize = sizeof(EDMIDI_SInt16);
+    format.sampleOffset = sizeof(EDMIDI_SInt16) * 2;
+    if(settings->format)
+        format = *settings->format;
+    if(format.sampleOffset != format.containerSize * 2 || !MidiPlayer::IsFormatSupported(&format))
+    {
+        sprintf(EDMIDI_ErrorString, "Emu De MIDI: Unsupported batch output format, must be an interleaved one!");
+        return -1;
+    }
+
+    for(int i = 0; i < count; i++)
+    {
+        if(!jobs[i].sink || (!jobs[i].filePath && !jobs[i].data))
+        {
+            sprintf(EDMIDI_ErrorString, "Emu De MIDI: Batch job %d has no input or no sink!", i);
+            return -1;
+        }
+    }
+
+    dsa::CBatchRenderer batch(static_cast<unsigned long>(settings->sampleRate), modules,
+                              settings->threads, format, settings->maxSeconds);
+    return batch.Run(jobs, count);
+}
+
+EDMIDI_EXPORT long edmidi_renderOffline(EDMIDIPlayer *device, int threads, const EDMIDI_AudioFormat *format,
+                                        EDMIDI_BatchSink sink, void *userData, double maxSeconds)
+{
+    if(!device || !sink)
+        return -1;
+    MidiPlayer *play = GET_MIDI_PLAYER(device);
+    assert(play);
+
+    EDMIDI_AudioFormat s16;
+    s16.type = EDMIDI_SampleType_S16;
+    s16.containerSize = sizeof(EDMIDI_SInt16);
+    s16.sampleOffset = sizeof(EDMIDI_SInt16) * 2;
+    if(!format)
+        format = &s16;
+    if(format->sampleOffset != format->containerSize * 2 || !MidiPlayer::IsFormatSupported(format))
+    {
+        play->setErrorString("Emu De MIDI: Unsupported offline output format, must be an interleaved one!");
+        return -1;
+    }
+    if(play->isAsyncRendering())
+    {
+        play->setErrorString("Emu De MIDI: Can't render offline while the render thread runs");
+        return -1;
+    }
+
+    long ret = play->RenderOffline(threads, format, sink, userData, maxSeconds);
+    if(ret == -1)
+        play->setErrorString("Emu De MIDI: Can't render offline with the asynchronous control enabled");
+    return ret;
+}
+
+
+/* ======== Real-Time MIDI ======== */
+
+static int rtPushEvent(EDMIDIPlayer *device, EDMIDI_UInt8 status, EDMIDI_UInt8 channel,
+                       EDMIDI_UInt8 data1, EDMIDI_UInt8 data2, unsigned int frameOffset)
+{
+    if(!device || channel > 15)
+        return -1;
+    MidiPlayer *play = GET_MIDI_PLAYER(device);
+    assert(play);
+    // No error string here: this may be called by other thread than the other calls
+    if(!play->rtEvent(status, channel, data1 & 0x7F, data2 & 0x7F, frameOffset))
+        return -1;
+    return 0;
+}
+
+EDMIDI_EXPORT int edmidi_rt_noteOn(EDMIDIPlayer *device, EDMIDI_UInt8 channel, EDMIDI_UInt8 note,
+                                   EDMIDI_UInt8 velocity, unsigned int frameOffset)
+{
+    return rtPushEvent(device, 0x90, channel, note, velocity, frameOffset);
+}
+
+EDMIDI_EXPORT int edmidi_rt_noteOff(EDMIDIPlayer *device, EDMIDI_UInt8 channel, EDMIDI_UInt8 note,
+                                    unsigned int frameOffset)
+{
+    return rtPushEvent(device, 0x80, channel, note, 0, frameOffset);
+}
+
+EDMIDI_EXPORT int edmidi_rt_channelAfterTouch(EDMIDIPlayer *device, EDMIDI_UInt8 channel,
+                                              EDMIDI_UInt8 atVal, unsigned int frameOffset)
+{
+    return rtPushEvent(device, 0xD0, channel, atVal, 0, frameOffset);
+}
+
+EDMIDI_EXPORT int edmidi_rt_controllerChange(EDMIDIPlayer *device, EDMIDI_UInt8 channel, EDMIDI_UInt8 type,
+                                             EDMIDI_UInt8 value, unsigned int frameOffset)
+{
+    return rtPushEvent(device, 0xB0, channel, type, value, frameOffset);
+}
+
+EDMIDI_EXPORT int edmidi_rt_patchChange(EDMIDIPlayer *device, EDMIDI_UInt8 channel, EDMIDI_UInt8 patch,
+                                        unsigned int frameOffset)
+{
+    return rtPushEvent(device, 0xC0, channel, patch, 0, frameOffset);
+}
+
+EDMIDI_EXPORT int edmidi_rt_pitchBend(EDMIDIPlayer *device, EDMIDI_UInt8 channel, EDMIDI_UInt16 pitch,
+                                      unsigned int frameOffset)
+{
+    return rtPushEvent(device, 0xE0, channel,
+                       static_cast<EDMIDI_UInt8>((pitch >> 7) & 0x7F),
+                       static_cast<EDMIDI_UInt8>(pitch & 0x7F), frameOffset);
+}
+
+EDMIDI_EXPORT int edmidi_rt_pitchBendML(EDMIDIPlayer *device, EDMIDI_UInt8 channel, EDMIDI_UInt8 msb,
+                                        EDMIDI_UInt8 lsb, unsigned int frameOffset)
+{
+    return rtPushEvent(device, 0xE0, channel, msb, lsb, frameOffset);
+}
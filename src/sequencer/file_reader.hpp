@@ -37,6 +37,21 @@
 #include <windows.h>    // MultiByteToWideChar
 #endif
 
+/*
+ * On POSIX systems files get mapped into the memory and parsed from the pages directly.
+ * Define FILE_AND_MEM_READER_NO_MMAP to always read them through the stdio instead.
+ */
+#if !defined(FILE_AND_MEM_READER_NO_MMAP) && (defined(__unix__) || defined(__APPLE__)) && \
+    !defined(_WIN32) && !defined(__DJGPP__) && !defined(__EMSCRIPTEN__) && !defined(VITA) && \
+    !defined(__3DS__) && !defined(__WII__) && !defined(__WIIU__) && !defined(__SWITCH__)
+#   define FILE_AND_MEM_READER_MMAP
+#   include <sys/types.h>  // off_t
+#   include <sys/stat.h>   // fstat
+#   include <sys/mman.h>   // mmap, munmap
+#   include <fcntl.h>      // open
+#   include <unistd.h>     // close
+#endif
+
 #if !defined(__SIZEOF_POINTER__) // Workaround for MSVC
 #   if defined(_WIN32)
 #       if defined(_WIN64)
@@ -72,6 +87,47 @@ class FileAndMemReader
     //! Dumped file content
     void        *m_dump;
 
+    //! Memory-mapped file content
+    void        *m_map;
+    //! Size of the mapped file
+    size_t      m_map_size;
+
+#if defined(FILE_AND_MEM_READER_MMAP)
+    /**
+     * @brief Map the regular file into the memory and use it as a memory block
+     * @param path Path to the file
+     * @return true if file was mapped, false if it should be read through the stdio
+     */
+    bool mapFile(const char *path)
+    {
+        struct stat st;
+        void *map;
+        int fd = ::open(path, O_RDONLY);
+
+        if(fd < 0)
+            return false;
+
+        if(::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0)
+        {
+            ::close(fd);
+            return false; /* Empty files and devices can't be mapped */
+        }
+
+        map = ::mmap(NULL, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd); /* The mapping stays valid */
+
+        if(map == MAP_FAILED)
+            return false;
+
+        m_map = map;
+        m_map_size = static_cast<size_t>(st.st_size);
+        m_mp = m_map;
+        m_mp_size = m_map_size;
+        m_mp_tell = 0;
+        return true;
+    }
+#endif
+
 public:
     /**
      * @brief Relation direction
@@ -94,7 +150,9 @@ public:
         m_mp(NULL),
         m_mp_size(0),
         m_mp_tell(0),
-        m_dump(NULL)
+        m_dump(NULL),
+        m_map(NULL),
+        m_map_size(0)
     {}
 
     /**
@@ -111,9 +169,16 @@ public:
      */
     void openFile(const char *path)
     {
-        if(m_fp)
+        if(m_fp || m_map)
             this->close();//Close previously opened file first!
 
+        m_file_name = path;
+
+#if defined(FILE_AND_MEM_READER_MMAP)
+        if(mapFile(path))
+            return;
+#endif
+
 #if !defined(_WIN32) || defined(__WATCOMC__)
         m_fp = std::fopen(path, "rb");
 #else
@@ -123,7 +188,6 @@ public:
         m_fp = _wfopen(widePath, L"rb");
 #endif
 
-        m_file_name = path;
         m_mp = NULL;
         m_mp_size = 0;
         m_mp_tell = 0;
@@ -136,7 +200,7 @@ public:
      */
     void openData(const void *mem, size_t length)
     {
-        if(m_fp)
+        if(m_fp || m_map)
             this->close(); /* Close previously opened file first! */
 
         m_fp = NULL;
@@ -147,6 +211,8 @@ public:
 
     /**
      * @brief If file loaded from the disk, it dumps content of entire file into memory and releases descriptor
+     *
+     * Mapped files are already in the memory, nothing to do for them.
      */
     void dumpFile()
     {
@@ -322,7 +388,14 @@ public:
         if(m_dump)
             std::free(m_dump);
 
+#if defined(FILE_AND_MEM_READER_MMAP)
+        if(m_map)
+            ::munmap(m_map, m_map_size);
+#endif
+
         m_dump = NULL;
+        m_map = NULL;
+        m_map_size = 0;
         m_fp = NULL;
         m_mp = NULL;
         m_mp_size = 0;
@@ -353,6 +426,15 @@ public:
             return m_mp_tell >= m_mp_size;
     }
 
+    /**
+     * @brief Get the memory block which is read now
+     * @return Pointer to the memory block, or NULL if a file is read through the stdio
+     */
+    const void *memData() const
+    {
+        return m_mp;
+    }
+
     /**
      * @brief Get a current file name
      * @return File name of currently loaded file
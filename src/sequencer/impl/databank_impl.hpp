@@ -30,55 +30,64 @@
 
 void BW_MidiSequencer::insertDataToBank(BW_MidiSequencer::MidiEvent &evt, U8List &bank, const uint8_t *data, size_t length)
 {
-    evt.data_block.offset = bank.size;
+    evt.data_block.offset = static_cast<uint32_t>(bank.size);
     bank.push_back_list(data, length);
-    evt.data_block.size = bank.size - evt.data_block.offset;
+    evt.data_block.size = static_cast<uint32_t>(bank.size - evt.data_block.offset);
 }
 
 void BW_MidiSequencer::insertDataToBank(BW_MidiSequencer::MidiEvent &evt, U8List &bank, FileAndMemReader &fr, size_t length)
 {
-    evt.data_block.offset = bank.size;
+    if(m_borrowedData && fr.memData() == m_borrowedData && fr.tell() + length <= m_borrowedSize)
+    {
+        // Refer the block right in the borrowed memory
+        evt.data_block.offset = DATA_BLOCK_BORROWED | static_cast<uint32_t>(fr.tell());
+        evt.data_block.size = static_cast<uint32_t>(length);
+        fr.seeku(length, FileAndMemReader::CUR);
+        return;
+    }
+
+    evt.data_block.offset = static_cast<uint32_t>(bank.size);
     bank.resize(bank.size + length);
     fr.read(bank.data + evt.data_block.offset, 1, length);
-    evt.data_block.size = bank.size - evt.data_block.offset;
+    evt.data_block.size = static_cast<uint32_t>(bank.size - evt.data_block.offset);
 }
 
 void BW_MidiSequencer::insertDataToBankWithByte(BW_MidiSequencer::MidiEvent &evt, U8List &bank, uint8_t begin_byte, const uint8_t *data, size_t length)
 {
-    evt.data_block.offset = bank.size;
+    evt.data_block.offset = static_cast<uint32_t>(bank.size);
     bank.push_back(begin_byte);
     bank.push_back_list(data, length);
-    evt.data_block.size = bank.size - evt.data_block.offset;
+    evt.data_block.size = static_cast<uint32_t>(bank.size - evt.data_block.offset);
 }
 
 void BW_MidiSequencer::insertDataToBankWithByte(BW_MidiSequencer::MidiEvent &evt, U8List &bank, uint8_t begin_byte, FileAndMemReader &fr, size_t length)
 {
-    evt.data_block.offset = bank.size;
+    evt.data_block.offset = static_cast<uint32_t>(bank.size);
     bank.push_back(begin_byte);
     bank.resize(bank.size + length);
     fr.read(bank.data + evt.data_block.offset + 1, 1, length);
-    evt.data_block.size = bank.size - evt.data_block.offset;
+    evt.data_block.size = static_cast<uint32_t>(bank.size - evt.data_block.offset);
 }
 
 void BW_MidiSequencer::insertDataToBankWithTerm(BW_MidiSequencer::MidiEvent &evt, U8List &bank, const uint8_t *data, size_t length)
 {
     const uint8_t null[] = {0, 0};
-    evt.data_block.offset = bank.size;
+    evt.data_block.offset = static_cast<uint32_t>(bank.size);
     bank.push_back_list(data, length);
     bank.push_back_list(null, 2); /* Second terminator is an ending fix for UTF16 strings */
-    evt.data_block.size = bank.size - evt.data_block.offset;
+    evt.data_block.size = static_cast<uint32_t>(bank.size - evt.data_block.offset);
 }
 
 void BW_MidiSequencer::insertDataToBankWithTerm(BW_MidiSequencer::MidiEvent &evt, U8List &bank, FileAndMemReader &fr, size_t length)
 {
     size_t tail = bank.size + length;
-    evt.data_block.offset = bank.size;
+    evt.data_block.offset = static_cast<uint32_t>(bank.size);
     bank.resize(bank.size + length + 2);
     fr.read(bank.data + evt.data_block.offset, 1, length);
     /* Second terminator is an ending fix for UTF16 strings */
     bank.data[tail] = 0;
     bank.data[tail + 1] = 0;
-    evt.data_block.size = bank.size - evt.data_block.offset;
+    evt.data_block.size = static_cast<uint32_t>(bank.size - evt.data_block.offset);
 }
 
 void BW_MidiSequencer::addEventToBank(BW_MidiSequencer::MidiTrackRow &row, const MidiEvent &evt)
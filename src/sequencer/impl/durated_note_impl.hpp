@@ -29,15 +29,59 @@
 #include <cstring>
 
 #include "../midi_sequencer.hpp"
+#include "common.hpp"
 
-bool BW_MidiSequencer::duratedNoteAlloc(size_t track, DuratedNote **note)
+BW_MidiSequencer::DuratedNotesCache::DuratedNotesCache() :
+    serial(0)
+{}
+
+BW_MidiSequencer::DuratedNotesCache::DuratedNotesCache(const DuratedNotesCache &o) :
+    serial(0)
+{
+    *this = o;
+}
+
+BW_MidiSequencer::DuratedNotesCache &BW_MidiSequencer::DuratedNotesCache::operator=(const DuratedNotesCache &o)
+{
+    if(this == &o)
+        return *this;
+
+    notes.size = 0;
+    notes.reserve(o.notes.capacity);
+    if(o.notes.size > 0)
+        std::memcpy(notes.data, o.notes.data, sizeof(DuratedNote) * o.notes.size);
+    notes.size = o.notes.size;
+    serial = o.serial;
+
+    return *this;
+}
+
+bool BW_MidiSequencer::duratedNoteLess(const DuratedNote &a, const DuratedNote &b)
+{
+    if(a.expire != b.expire)
+        return a.expire < b.expire;
+    return static_cast<int32_t>(a.serial - b.serial) < 0;
+}
+
+bool BW_MidiSequencer::duratedNoteAdd(size_t track, const MidiEvent &evt)
 {
     DuratedNotesCache &cache = m_trackState[track].duratedNotes;
+    DuratedNotesList &heap = cache.notes;
+    DuratedNote n;
 
-    if(cache.notes_count >= 128)
-        return false; // Can't insert delayed note off!
+    if(heap.size >= heap.capacity)
+    {
+        heap.reserve(heap.capacity > 0 ? heap.capacity * 2 : 16);
+        if(heap.size >= heap.capacity)
+            return false; // Can't insert delayed note off!
+    }
 
-    *note = cache.notes + cache.notes_count++;
+    n.expire = m_duratedNotesClock + readBEint(evt.data_loc + 2, 3);
+    n.serial = cache.serial++;
+    n.channel = evt.channel;
+    n.note = evt.data_loc[0];
+    n.velocity = evt.data_loc[1];
+    duratedNoteHeapPush(heap, n);
 
     return true;
 }
@@ -45,26 +89,87 @@ bool BW_MidiSequencer::duratedNoteAlloc(size_t track, DuratedNote **note)
 void BW_MidiSequencer::duratedNoteClear()
 {
     for(MidiTrackState *it = m_trackState.begin(); it != m_trackState.end(); ++it)
-        it->duratedNotes.notes_count = 0;
+        it->duratedNotes.notes.size = 0;
 }
 
-void BW_MidiSequencer::duratedNoteTick(size_t track, int64_t ticks)
+void BW_MidiSequencer::duratedNotePop(size_t track)
 {
-    DuratedNotesCache &cache = m_trackState[track].duratedNotes;
+    duratedNoteHeapPop(m_trackState[track].duratedNotes.notes);
+}
+
+void BW_MidiSequencer::duratedNoteHeapPush(DuratedNotesList &heap, const DuratedNote &n)
+{
+    DuratedNote tmp;
+    size_t i;
 
-    for(size_t i = 0; i < cache.notes_count; ++i)
-        cache.notes[i].ttl -= ticks;
+    // Sift up
+    i = heap.size++;
+    heap.data[i] = n;
+
+    for(; i > 0 && duratedNoteLess(heap.data[i], heap.data[(i - 1) / 2]); i = (i - 1) / 2)
+    {
+        tmp = heap.data[i];
+        heap.data[i] = heap.data[(i - 1) / 2];
+        heap.data[(i - 1) / 2] = tmp;
+    }
 }
 
-void BW_MidiSequencer::duratedNotePop(size_t track, size_t i)
+void BW_MidiSequencer::duratedNoteHeapPop(DuratedNotesList &heap)
 {
-    DuratedNotesCache &cache = m_trackState[track].duratedNotes;
+    DuratedNote tmp;
+    size_t i, c;
+
+    if(heap.size == 0)
+        return;
+
+    heap.data[0] = heap.data[--heap.size];
+
+    // Sift down
+    for(i = 0; ; i = c)
+    {
+        c = i * 2 + 1;
+        if(c >= heap.size)
+            break;
+        if(c + 1 < heap.size && duratedNoteLess(heap.data[c + 1], heap.data[c]))
+            ++c;
+        if(!duratedNoteLess(heap.data[c], heap.data[i]))
+            break;
+        tmp = heap.data[i];
+        heap.data[i] = heap.data[c];
+        heap.data[c] = tmp;
+    }
+}
 
-    if(i < cache.notes_count)
+uint64_t BW_MidiSequencer::duratedNoteNext(size_t track)
+{
+    const DuratedNote &n = m_trackState[track].duratedNotes.notes.data[0];
+    return n.expire > m_duratedNotesClock ? n.expire - m_duratedNotesClock : 0;
+}
+
+void BW_MidiSequencer::duratedNoteReserve()
+{
+    size_t tk, i, count;
+
+    m_duratedNotesClock = 0;
+
+    // Notes of one track can't overlap more than it has, unless the loop repeats them earlier
+    for(tk = 0; tk < m_tracksCount; ++tk)
     {
-        if(cache.notes_count > 1)
-            std::memcpy(cache.notes + i, cache.notes + cache.notes_count - 1, sizeof(DuratedNote));
-        --cache.notes_count;
+        count = 0;
+
+        for(MidiTrackQueue::Leaf_t *it = m_trackData[tk].m_begin; it != NULL; it = it->next)
+        {
+            for(i = it->data.events_begin; i < it->data.events_end; ++i)
+            {
+                if(m_eventBank[i].type == MidiEvent::T_NOTEON_DURATED)
+                    ++count;
+            }
+        }
+
+        DuratedNotesCache &cache = m_trackState[tk].duratedNotes;
+        cache.notes.clear();
+        cache.notes.reserve(count);
+        cache.serial = 0;
     }
 }
 
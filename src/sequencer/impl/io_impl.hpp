@@ -67,6 +67,12 @@ double BW_MidiSequencer::Tick(double s, double granularity)
 int BW_MidiSequencer::playStream(uint8_t *stream, size_t length)
 {
     int count = 0;
+
+    // The frame size follows the output format which the caller may switch
+    // between the calls
+    if(m_interface->pcmFrameSize != 0)
+        m_time.frameSize = m_interface->pcmFrameSize;
+
     size_t samples = static_cast<size_t>(length / static_cast<size_t>(m_time.frameSize));
     size_t left = samples;
     size_t periodSize = 0;
@@ -118,6 +124,9 @@ double BW_MidiSequencer::seek(double seconds, const double granularity)
         return 0.0;
     }
 
+    if(!m_seekIndexReady)
+        seekIndexBuild();
+
     bool loopFlagState = m_loopEnabled;
     // Turn loop pooints off because it causes wrong position rememberin on a quick seek
     m_loopEnabled = false;
@@ -125,7 +134,8 @@ double BW_MidiSequencer::seek(double seconds, const double granularity)
     /*
      * Seeking search is similar to regular ticking, except of next things:
      * - We don't processsing arpeggio and vibrato
-     * - To keep correctness of the state after seek, begin every search from begin
+     * - To keep correctness of the state after seek, begin every search from begin,
+     *   or from the nearest checkpoint of the seek index which replays the state
      * - All sustaining notes must be killed
      * - Ignore Note-On events
      */
@@ -141,6 +151,10 @@ double BW_MidiSequencer::seek(double seconds, const double granularity)
 
     m_loop.temporaryBroken = (seconds >= m_loopEndTime);
 
+    // Skip the events which the nearest checkpoint of the seek index covers. The time
+    // steps below stay the same, so the seek lands on the same position as before.
+    seekRestoreCheckpoint(seconds);
+
     while((m_currentPosition.absTimePosition < seconds) &&
           (m_currentPosition.absTimePosition < m_fullSongTimeLength))
     {
@@ -184,6 +198,12 @@ double BW_MidiSequencer::seek(double seconds, const double granularity)
     return m_currentPosition.wait;
 }
 
+void BW_MidiSequencer::buildSeekIndex()
+{
+    if(!m_seekIndexReady)
+        seekIndexBuild();
+}
+
 double BW_MidiSequencer::tell()
 {
     return m_currentPosition.absTimePosition;
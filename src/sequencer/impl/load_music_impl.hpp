@@ -120,6 +120,7 @@ bool BW_MidiSequencer::loadMIDI(const std::string &filename)
 {
     FileAndMemReader file;
     file.openFile(filename.c_str());
+    m_borrowedData = NULL;
 
     if(!loadMIDI(file))
         return false;
@@ -131,9 +132,34 @@ bool BW_MidiSequencer::loadMIDI(const void *data, size_t size)
 {
     FileAndMemReader file;
     file.openData(data, size);
+    m_borrowedData = NULL;
     return loadMIDI(file);
 }
 
+bool BW_MidiSequencer::loadMIDINoCopy(const void *data, size_t size)
+{
+    FileAndMemReader file;
+    file.openData(data, size);
+
+    // Offsets of borrowed blocks must fit the data block references
+    if(size < DATA_BLOCK_BORROWED)
+    {
+        m_borrowedData = reinterpret_cast<const uint8_t *>(data);
+        m_borrowedSize = size;
+    }
+
+    return loadMIDI(file);
+}
+
+void BW_MidiSequencer::ownBorrowedData()
+{
+    if(!m_borrowedData || m_borrowedData == m_borrowedCopy.data)
+        return;
+    m_borrowedCopy.clear();
+    m_borrowedCopy.push_back_list(m_borrowedData, m_borrowedSize);
+    m_borrowedData = m_borrowedCopy.data;
+}
+
 
 
 // template<class T>
@@ -166,6 +192,14 @@ bool BW_MidiSequencer::loadMIDI(FileAndMemReader &fr)
 
     assert(m_interface); // MIDI output interface must be defined!
 
+    if(fr.memData() != m_borrowedData)
+    {
+        // Data blocks of the new song are in the data bank only
+        m_borrowedData = NULL;
+        m_borrowedSize = 0;
+    }
+    m_borrowedCopy.clear();
+
     if(!fr.isValid())
     {
         m_errorString.set("Invalid data stream!\n");
@@ -177,6 +177,7 @@ void BW_MidiSequencer::installLoop(BW_MidiSequencer::LoopPointParseState &loopSt
         for(size_t tk = 0; tk < m_tracksCount; ++tk)
         {
             Position::TrackInfo &track = scanPosition.track[tk];
+            TrackStateSaved &trackSaved = scanPosition.state[tk];
             MidiTrackRow *ti = NULL;
             // MidiTrackQueue::Leaf_t *end = m_trackData[tk].m_end;
 
@@ -217,27 +218,27 @@ void BW_MidiSequencer::installLoop(BW_MidiSequencer::LoopPointParseState &loopSt
                     }
                     else
                     {
-                        if(track.state.track_channel != evt.channel)
-                            track.state.track_channel = evt.channel;
+                        if(trackSaved.track_channel != evt.channel)
+                            trackSaved.track_channel = evt.channel;
 
                         switch(evt.type)
                         {
                         case MidiEvent::T_CTRLCHANGE:
                             if(evt.data_loc[0] < 102)
-                                track.state.cc_values[evt.data_loc[0]] = evt.data_loc[1];
+                                trackSaved.cc_values[evt.data_loc[0]] = evt.data_loc[1];
                             break;
                         case MidiEvent::T_PATCHCHANGE:
-                            track.state.reserve_patch = evt.data_loc[0];
+                            trackSaved.reserve_patch = evt.data_loc[0];
                             break;
                         case MidiEvent::T_WHEEL:
-                            track.state.reserve_wheel[0] = evt.data_loc[0];
-                            track.state.reserve_wheel[1] = evt.data_loc[1];
+                            trackSaved.reserve_wheel[0] = evt.data_loc[0];
+                            trackSaved.reserve_wheel[1] = evt.data_loc[1];
                             break;
                         case MidiEvent::T_CHANAFTTOUCH:
-                            track.state.reserve_channel_att = evt.data_loc[0];
+                            trackSaved.reserve_channel_att = evt.data_loc[0];
                             break;
                         case MidiEvent::T_NOTETOUCH:
-                            track.state.reserve_note_att[evt.data_loc[0] & 0x7F] = evt.data_loc[1];
+                            trackSaved.reserve_note_att[evt.data_loc[0] & 0x7F] = evt.data_loc[1];
                             break;
                         }
                     }
@@ -73,6 +73,11 @@ void BW_MidiSequencer::buildSmfSetupReset(size_t trackCount)
 
     m_trackData.clear();
     m_trackState.clear();
+    m_timeline.clear();
+    m_timelineDue.clear();
+    m_rowBegin.tracks.clear();
+    m_rowBegin.position.clear();
+    seekIndexClear();
 
     m_loop.reset();
     m_loop.invalidLoop = false;
@@ -101,7 +106,7 @@ void BW_MidiSequencer::initTracksBegin(size_t track)
         // Some events doesn't begin at zero!
         m_trackBeginPosition.track[track].delay = pos->data.absPos;
         m_trackBeginPosition.track[track].lastHandledEvent = 0;
-        std::memcpy(&m_trackBeginPosition.track[track].state, &m_trackState[track].state, sizeof(TrackStateSaved));
+        std::memcpy(&m_trackBeginPosition.state[track], &m_trackState[track].state, sizeof(TrackStateSaved));
     }
     else
     {
@@ -349,6 +354,8 @@ void BW_MidiSequencer::buildTimeLine(const TemposList &tempos,
             for(tk = 0; tk < m_tracksCount; ++tk)
                 rowPosition.track[tk].delay -= shortestDelay;
 
+            rowPosition.absTickPosition += shortestDelay;
+
             if(caughLoopStart > 0)
             {
                 m_loopBeginPosition = rowBeginPosition;
@@ -360,6 +367,150 @@ void BW_MidiSequencer::buildTimeLine(const TemposList &tempos,
                 break;
         }
     }
+
+    duratedNoteReserve();
+    buildFlatTimeline();
+    songCacheKeepLoaded();
+}
+
+bool BW_MidiSequencer::timelineLess(const TimelineEntry &a, const TimelineEntry &b)
+{
+    if(a.tick != b.tick)
+        return a.tick < b.tick;
+    if(a.subRow != b.subRow)
+        return a.subRow < b.subRow;
+    return a.track < b.track;
+}
+
+void BW_MidiSequencer::buildFlatTimeline()
+{
+    miditrack_arr<TimelineEntry> heads;
+    TimelineEntry e, tmp;
+    size_t tk, i, c, heapSize = 0, count = 1;
+
+    m_timeline.clear();
+
+    for(i = 0; i < m_eventBank.size; ++i)
+    {
+        const MidiEvent &evt = m_eventBank[i];
+
+        if(evt.type == MidiEvent::T_NOTEON_DURATED)
+            return;
+
+        if(evt.type != MidiEvent::T_SPECIAL)
+            continue;
+
+        switch(evt.subtype)
+        {
+        case MidiEvent::ST_TRACK_LOOPSTACK_BEGIN:
+        case MidiEvent::ST_TRACK_LOOPSTACK_BEGIN_ID:
+        case MidiEvent::ST_TRACK_LOOPSTACK_END:
+        case MidiEvent::ST_TRACK_LOOPSTACK_END_ID:
+        case MidiEvent::ST_TRACK_LOOPSTACK_BREAK:
+        case MidiEvent::ST_TRACK_BRANCH_LOCATION:
+        case MidiEvent::ST_TRACK_BRANCH_TO:
+            return; // Tracks don't move together
+        default:
+            break;
+        }
+    }
+
+    /*
+     * Rows are merged in the order the track by track processing handles them: by tick,
+     * then the rows of the same track at the same tick go to the next steps, then by track.
+     * Every track gets the end entry at the tick where the track by track processing
+     * would find its end.
+     */
+    heads.reserve(m_tracksCount + 1);
+
+    for(tk = 0; tk < m_tracksCount; ++tk)
+    {
+        MidiTrackQueue &track = m_trackData[tk];
+
+        if(track.empty())
+            continue;
+
+        count += track.size() + 1;
+
+        e.row = track.m_begin;
+        e.tick = track.m_begin->data.absPos;
+        e.subRow = 0;
+        e.track = static_cast<uint32_t>(tk);
+
+        // Sift up
+        heads.push_back(e);
+        for(i = heapSize++; i > 0 && timelineLess(heads[i], heads[(i - 1) / 2]); i = (i - 1) / 2)
+        {
+            tmp = heads[i];
+            heads[i] = heads[(i - 1) / 2];
+            heads[(i - 1) / 2] = tmp;
+        }
+    }
+
+    m_timeline.reserve(count + 1);
+    m_timelineDue.reserve(m_tracksCount + 1);
+
+    // Begin of the song, makes the first step happen at the zero tick
+    e.row = NULL;
+    e.tick = 0;
+    e.subRow = 0;
+    e.track = TIMELINE_NO_TRACK;
+    m_timeline.push_back(e);
+
+    while(heapSize > 0)
+    {
+        TimelineEntry &top = heads[0];
+        m_timeline.push_back(top);
+
+        if(top.row)
+        {
+            const uint64_t delay = top.row->data.delay;
+            top.row = top.row->next;
+            top.tick += delay;
+            top.subRow = delay > 0 ? 0 : top.subRow + 1;
+        }
+        else // The track has ended
+            heads[0] = heads[--heapSize];
+
+        // Sift down
+        for(i = 0; ; i = c)
+        {
+            c = i * 2 + 1;
+            if(c >= heapSize)
+                break;
+            if(c + 1 < heapSize && timelineLess(heads[c + 1], heads[c]))
+                ++c;
+            if(!timelineLess(heads[c], heads[i]))
+                break;
+            tmp = heads[i];
+            heads[i] = heads[c];
+            heads[c] = tmp;
+        }
+    }
+
+    // Place the remembered positions onto the timeline
+    m_trackBeginPosition.timelineCursor = 0;
+    m_currentPosition.timelineCursor = 0;
+    m_loopBeginPosition.timelineCursor = timelineFind(m_loopBeginPosition.absTickPosition);
+
+    for(BranchEntry *it = m_branches.begin(); it != m_branches.end(); ++it)
+        it->offset.timelineCursor = timelineFind(it->offset.absTickPosition);
+}
+
+size_t BW_MidiSequencer::timelineFind(uint64_t tick) const
+{
+    size_t lo = 0, hi = m_timeline.size, mid;
+
+    while(lo < hi)
+    {
+        mid = lo + (hi - lo) / 2;
+        if(m_timeline[mid].tick < tick)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
 }
 
 #endif /* BW_MIDISEQ_READ_SMF_IMPL_HPP */
@@ -45,21 +45,28 @@ void BW_MidiSequencer::Position::tracks_resize(size_t size)
         }
 
         size_t rawSize = size * sizeof(TrackInfo);
+        size_t rawStateSize = size * sizeof(TrackStateSaved);
         if(track)
         {
 #if defined(__DJGPP__)
             dpmi_allocator_impl::dpmi_unlock_memory(track, rawSize);
+            dpmi_allocator_impl::dpmi_unlock_memory(state, rawStateSize);
 #endif
             track = (TrackInfo*)std::realloc(track, rawSize);
+            state = (TrackStateSaved*)std::realloc(state, rawStateSize);
         }
         else
+        {
             track = (TrackInfo*)std::malloc(rawSize);
+            state = (TrackStateSaved*)std::malloc(rawStateSize);
+        }
 
 #if defined(__DJGPP__)
         dpmi_allocator_impl::dpmi_lock_memory(track, rawSize);
+        dpmi_allocator_impl::dpmi_lock_memory(state, rawStateSize);
 #endif
         for(size_t i = track_size; i < size; ++i)
-            tracks_init_one(track[i]);
+            tracks_init_one(track[i], state[i]);
 
         track_size = size;
     }
@@ -68,20 +75,20 @@ void BW_MidiSequencer::Position::tracks_resize(size_t size)
 void BW_MidiSequencer::Position::tracks_reset()
 {
     for(size_t i = 0; i < track_size; ++i)
-        tracks_init_one(track[i]);
+        tracks_init_one(track[i], state[i]);
 }
 
-void BW_MidiSequencer::Position::tracks_init_one(TrackInfo &t)
+void BW_MidiSequencer::Position::tracks_init_one(TrackInfo &t, TrackStateSaved &st)
 {
     t.delay = 0;
     t.lastHandledEvent = 0;
-    std::memset(&t.state, 0, sizeof(t.state));
-    std::memset(t.state.cc_values, 0xFF, sizeof(t.state.cc_values));
-    std::memset(t.state.reserve_note_att, 0xFF, sizeof(t.state.reserve_note_att));
-    t.state.reserve_patch = 0xFF;
-    t.state.reserve_wheel[0] = 0xFF;
-    t.state.reserve_wheel[1] = 0xFF;
-    t.state.reserve_channel_att = 0xFF;
+    std::memset(&st, 0, sizeof(st));
+    std::memset(st.cc_values, 0xFF, sizeof(st.cc_values));
+    std::memset(st.reserve_note_att, 0xFF, sizeof(st.reserve_note_att));
+    st.reserve_patch = 0xFF;
+    st.reserve_wheel[0] = 0xFF;
+    st.reserve_wheel[1] = 0xFF;
+    st.reserve_channel_att = 0xFF;
 }
 
 BW_MidiSequencer::Position::Position():
@@ -90,7 +97,9 @@ BW_MidiSequencer::Position::Position():
     absTickPosition(0),
     began(false),
     track(NULL),
-    track_size(0)
+    state(NULL),
+    track_size(0),
+    timelineCursor(0)
 {}
 
 BW_MidiSequencer::Position::~Position()
@@ -104,12 +113,17 @@ BW_MidiSequencer::Position::Position(const Position &o):
     absTickPosition(o.absTickPosition),
     began(o.began),
     track(NULL),
-    track_size(0)
+    state(NULL),
+    track_size(0),
+    timelineCursor(o.timelineCursor)
 {
     tracks_resize(o.track_size);
 
     if(track && o.track)
+    {
         std::memcpy(track, o.track, o.track_size * sizeof(TrackInfo));
+        std::memcpy(state, o.state, o.track_size * sizeof(TrackStateSaved));
+    }
 }
 
 BW_MidiSequencer::Position &BW_MidiSequencer::Position::operator=(const Position &o)
@@ -118,10 +132,14 @@ BW_MidiSequencer::Position &BW_MidiSequencer::Position::operator=(const Position
     absTimePosition = o.absTimePosition;
     absTickPosition = o.absTickPosition;
     began = o.began;
+    timelineCursor = o.timelineCursor;
 
     tracks_resize(o.track_size);
     if(track && o.track)
+    {
         std::memcpy(track, o.track, o.track_size * sizeof(TrackInfo));
+        std::memcpy(state, o.state, o.track_size * sizeof(TrackStateSaved));
+    }
 
     return *this;
 }
@@ -132,14 +150,18 @@ void BW_MidiSequencer::Position::clear()
     began = false;
     absTimePosition = 0.0;
     absTickPosition = 0;
+    timelineCursor = 0;
 
     if(track)
     {
 #if defined(__DJGPP__)
         dpmi_allocator_impl::dpmi_unlock_memory(track, track_size * sizeof(TrackInfo));
+        dpmi_allocator_impl::dpmi_unlock_memory(state, track_size * sizeof(TrackStateSaved));
 #endif
         std::free(track);
+        std::free(state);
         track = NULL;
+        state = NULL;
     }
 
     track_size = 0;
@@ -153,6 +175,7 @@ void BW_MidiSequencer::Position::assignOneTrack(const Position *o, size_t tk)
     absTickPosition = o->absTickPosition;
     tracks_resize(1);
     std::memcpy(&track[0], &o->track[tk], sizeof(TrackInfo));
+    std::memcpy(&state[0], &o->state[tk], sizeof(TrackStateSaved));
 }
 
 /**********************************************************************************
@@ -362,7 +385,8 @@ void BW_MidiSequencer::sortEvents(MidiTrackRow &row, MidiEventsList &eventsBank,
 BW_MidiSequencer::MidiTrackState::MidiTrackState() :
     deviceMask(BW_MidiSequencer::Device_ANY),
     disabled(false),
-    stateRestoreSetup(TRACK_RESTORE_DEFAULT)
+    stateRestoreSetup(TRACK_RESTORE_DEFAULT),
+    rowBeginSaved(false)
 {
     loop.reset();
     loop.invalidLoop = false;
@@ -374,8 +398,6 @@ BW_MidiSequencer::MidiTrackState::MidiTrackState() :
     state.reserve_wheel[0] = 0xFF;
     state.reserve_wheel[1] = 0xFF;
     state.reserve_channel_att = 0xFF;
-
-    std::memset(&duratedNotes, 0, sizeof(DuratedNotesCache));
 }
 
 #endif /* BW_MIDISEQ_READ_SMF_IMPL_HPP */
@@ -39,7 +39,6 @@ void BW_MidiSequencer::handleEvent(size_t track, const BW_MidiSequencer::MidiEve
     const uint8_t *datau;
     const char *data;
     int loopsNum;
-    DuratedNote *note;
     LoopStackEntry *loopEntryP;
     LoopState *loop = NULL;
     bool loopHasId;
@@ -341,14 +340,8 @@ void BW_MidiSequencer::handleEvent(size_t track, const BW_MidiSequencer::MidiEve
         return;
 
     case MidiEvent::T_NOTEON_DURATED: // Note on with duration
-        if(duratedNoteAlloc(track, &note)) // Do call true Note ON only when note OFF is successfully added into the list!
-        {
-            note->channel = evt.channel;
-            note->note = evt.data_loc[0];
-            note->velocity = evt.data_loc[1];
-            note->ttl = readBEint(evt.data_loc + 2, 3);
+        if(duratedNoteAdd(track, evt)) // Do call true Note ON only when note OFF is successfully added into the list!
             m_interface->rt_noteOn(m_interface->rtUserData, static_cast<uint8_t>(midCh), evt.data_loc[0], evt.data_loc[1]);
-        }
         return;
 
     case MidiEvent::T_NOTETOUCH: // Note touch
@@ -385,29 +378,22 @@ void BW_MidiSequencer::handleEvent(size_t track, const BW_MidiSequencer::MidiEve
 
 void BW_MidiSequencer::processDuratedNotes(size_t track, int32_t &status)
 {
-    DuratedNotesCache &cache = m_trackState[track].duratedNotes;
+    DuratedNotesList &heap = m_trackState[track].duratedNotes.notes;
 
-    if(cache.notes_count == 0)
-        return; // Nothing to do!
-
-    for(size_t i = 0; i < cache.notes_count; )
+    // Expired notes are at the top of the heap
+    while(heap.size > 0 && heap.data[0].expire <= m_duratedNotesClock)
     {
-        if(cache.notes[i].ttl <= 0)
-        {
-            DuratedNote *n = &cache.notes[i];
+        const DuratedNote n = heap.data[0];
 
-            if(m_interface->rt_noteOff)
-                m_interface->rt_noteOff(m_interface->rtUserData, n->channel, n->note);
+        if(m_interface->rt_noteOff)
+            m_interface->rt_noteOff(m_interface->rtUserData, n.channel, n.note);
 
-            if(m_interface->rt_noteOffVel)
-                m_interface->rt_noteOffVel(m_interface->rtUserData, n->channel, n->note, n->velocity);
+        if(m_interface->rt_noteOffVel)
+            m_interface->rt_noteOffVel(m_interface->rtUserData, n.channel, n.note, n.velocity);
 
-            status = MidiEvent::T_NOTEOFF;
+        status = MidiEvent::T_NOTEOFF;
 
-            duratedNotePop(track, i);
-        }
-        else
-            ++i;
+        duratedNotePop(track);
     }
 }
 
@@ -461,10 +447,12 @@ bool BW_MidiSequencer::handleLoopEnd(LoopRuntimeState &state, LoopState &loop, P
     return false;
 }
 
-bool BW_MidiSequencer::processLoopPoints(LoopRuntimeState &state, LoopState &loop, bool glob, size_t tk, const Position &pos)
+bool BW_MidiSequencer::processLoopPoints(LoopRuntimeState &state, LoopState &loop, bool glob, size_t tk)
 {
     if(state.numStackLoopStarts > 0)
     {
+        const Position &pos = rowBeginPosition();
+
         while(state.numStackLoopStarts > 0)
         {
             loop.stackUp();
@@ -558,11 +546,73 @@ bool BW_MidiSequencer::processLoopPoints(LoopRuntimeState &state, LoopState &loo
     return false;
 }
 
+void BW_MidiSequencer::rowBeginStart()
+{
+    RowBeginState &rb = m_rowBegin;
+
+    for(size_t i = 0; i < rb.tracks.size; ++i)
+        m_trackState[rb.tracks[i].track].rowBeginSaved = false;
+
+    rb.tracks.size = 0;
+    rb.wait = m_currentPosition.wait;
+    rb.absTimePosition = m_currentPosition.absTimePosition;
+    rb.absTickPosition = m_currentPosition.absTickPosition;
+    rb.began = m_currentPosition.began;
+    rb.timelineCursor = m_currentPosition.timelineCursor;
+    rb.delayShift = 0;
+    rb.positionReady = false;
+}
+
+void BW_MidiSequencer::rowBeginSaveTrack(size_t track)
+{
+    RowBeginTrack t;
+    MidiTrackState &ts = m_trackState[track];
+
+    if(ts.rowBeginSaved)
+        return; // Already saved by this step
+
+    ts.rowBeginSaved = true;
+    t.track = track;
+    t.info = m_currentPosition.track[track];
+    m_rowBegin.tracks.push_back(t);
+}
+
+const BW_MidiSequencer::Position &BW_MidiSequencer::rowBeginPosition()
+{
+    RowBeginState &rb = m_rowBegin;
+    Position &pos = rb.position;
+
+    if(rb.positionReady)
+        return pos;
+
+    // States of tracks are not changed by the step, and cursors of unchanged tracks
+    // differ by the delay taken at the end of the step only.
+    pos = m_currentPosition;
+    pos.wait = rb.wait;
+    pos.absTimePosition = rb.absTimePosition;
+    pos.absTickPosition = rb.absTickPosition;
+    pos.began = rb.began;
+    pos.timelineCursor = rb.timelineCursor;
+
+    if(rb.delayShift > 0)
+    {
+        for(size_t tk = 0; tk < pos.track_size; ++tk)
+            pos.track[tk].delay += rb.delayShift;
+    }
+
+    for(size_t i = 0; i < rb.tracks.size; ++i)
+        pos.track[rb.tracks[i].track] = rb.tracks[i].info;
+
+    rb.positionReady = true;
+
+    return pos;
+}
+
 void BW_MidiSequencer::restoreSongState()
 {
     for(size_t track = 0; track < m_tracksCount; track++)
     {
-        std::memcpy(&m_trackState[track].state, &m_currentPosition.track[track].state, sizeof(TrackStateSaved));
+        std::memcpy(&m_trackState[track].state, &m_currentPosition.state[track], sizeof(TrackStateSaved));
         restoreTrackState(track);
     }
 }
@@ -582,7 +632,7 @@ void BW_MidiSequencer::restoreTrackState(size_t track)
         else if(chan != 0xFF)
             m_interface->rt_controllerChange(m_interface->rtUserData, chan, 123, 0);
 
-        state.duratedNotes.notes_count = 0;
+        state.duratedNotes.notes.size = 0;
     }
 
     if((m_stateRestoreSetup & TRACK_RESTORE_ALL_CC) != 0)
@@ -630,11 +680,15 @@ void BW_MidiSequencer::jumpToPosition(size_t track, const Position *pos)
     }
     else
     {
+        // The step may still need the begin of this track
+        rowBeginPosition();
+
         m_currentPosition.track[track] = pos->track[0];
+        m_currentPosition.state[track] = pos->state[0];
         // Reset the time (lesser evil than time going to infinite!)
         m_currentPosition.absTickPosition = pos->absTickPosition;
         m_currentPosition.absTimePosition = pos->absTimePosition;
-        std::memcpy(&m_trackState[track].state, &m_currentPosition.track[track].state, sizeof(TrackStateSaved));
+        std::memcpy(&m_trackState[track].state, &m_currentPosition.state[track], sizeof(TrackStateSaved));
         restoreTrackState(track);
     }
 }
@@ -657,22 +711,10 @@ bool BW_MidiSequencer::jumpToBranch(uint32_t dstTrack, uint16_t dstBranch)
     return false;
 }
 
-bool BW_MidiSequencer::processEvents(bool isSeek)
+void BW_MidiSequencer::processTracksRow(bool isSeek, LoopRuntimeState &loopState, uint64_t &shortestDelay, bool &shortestDelayNotFound)
 {
-    if(m_currentPosition.track_size == 0)
-        m_atEnd = true; // No MIDI track data to play
-
-    if(m_atEnd)
-        return false;   // No more events in the queue
-
-    m_loop.caughtEnd = false;
     const size_t        trackCount = m_currentPosition.track_size;
-    LoopRuntimeState    loopState, loopStateLoc;
-    Tempo_t t;
-
-    m_currentPositionBegin = m_currentPosition;
-
-    std::memset(&loopState, 0, sizeof(loopState));
+    LoopRuntimeState    loopStateLoc;
 
 #ifdef DEBUG_TIME_CALCULATION
     double maxTime = 0.0;
@@ -688,10 +730,16 @@ bool BW_MidiSequencer::processEvents(bool isSeek)
         std::memset(&loopStateLoc, 0, sizeof(loopStateLoc));
 
         // Process note-OFFs
-        processDuratedNotes(tk, track.lastHandledEvent);
+        if(trackState.duratedNotes.notes.size > 0)
+        {
+            rowBeginSaveTrack(tk);
+            processDuratedNotes(tk, track.lastHandledEvent);
+        }
 
         if((track.lastHandledEvent >= 0) && (track.delay <= 0))
         {
+            rowBeginSaveTrack(tk);
+
             // Check is an end of track has been reached
             if(track.pos == NULL)
             {
@@ -747,10 +795,10 @@ bool BW_MidiSequencer::processEvents(bool isSeek)
 
             // Register global loop start position
             if(loopState.numGlobLoopStarts > 0 && m_loopBeginPosition.absTimePosition <= 0.0)
-                m_loopBeginPosition = m_currentPositionBegin;
+                m_loopBeginPosition = rowBeginPosition();
 
             // Process local loop
-            if(processLoopPoints(loopStateLoc, trackLoop, false, tk, m_currentPositionBegin))
+            if(processLoopPoints(loopStateLoc, trackLoop, false, tk))
                 continue; // Done with this track for now
 
             if(loopState.doLoopJump)
@@ -765,13 +813,9 @@ bool BW_MidiSequencer::processEvents(bool isSeek)
 #endif
 
     // Find a shortest delay from all track
-    uint64_t shortestDelay = 0;
-    bool     shortestDelayNotFound = true;
-
     for(size_t tk = 0; tk < trackCount; ++tk)
     {
         Position::TrackInfo &track = m_currentPosition.track[tk];
-        DuratedNotesCache &timedNotes = m_trackState[tk].duratedNotes;
 
         // Normal events
         if((track.lastHandledEvent >= 0) && (shortestDelayNotFound || track.delay < shortestDelay))
@@ -780,18 +824,13 @@ bool BW_MidiSequencer::processEvents(bool isSeek)
             shortestDelayNotFound = false;
         }
 
-        // Note events with duration
-        for(size_t i = 0; i < timedNotes.notes_count; ++i)
+        // Note events with duration, the nearest one only
+        if(m_trackState[tk].duratedNotes.notes.size > 0)
         {
-            DuratedNote &n = timedNotes.notes[i];
-            if(n.ttl <= 0)
+            const uint64_t noteDelay = duratedNoteNext(tk);
+            if(shortestDelayNotFound || noteDelay < shortestDelay)
             {
-                shortestDelay = 0; // Just zero!
-                shortestDelayNotFound = false;
-            }
-            else if(shortestDelayNotFound || static_cast<uint64_t>(n.ttl) < shortestDelay)
-            {
-                shortestDelay = n.ttl; // Extra tick
+                shortestDelay = noteDelay;
                 shortestDelayNotFound = false;
             }
         }
@@ -799,11 +838,143 @@ bool BW_MidiSequencer::processEvents(bool isSeek)
 
     // Schedule the next playevent to be processed after that delay
     for(size_t tk = 0; tk < trackCount; ++tk)
-    {
         m_currentPosition.track[tk].delay -= shortestDelay;
-        duratedNoteTick(tk, shortestDelay);
+
+    m_duratedNotesClock += shortestDelay;
+
+    m_rowBegin.delayShift = shortestDelay;
+}
+
+bool BW_MidiSequencer::timelineIsDue(const TimelineEntry &e) const
+{
+    if(e.track == TIMELINE_NO_TRACK)
+        return false;
+
+    const Position::TrackInfo &track = m_currentPosition.track[e.track];
+    return track.lastHandledEvent >= 0 && track.pos == e.row;
+}
+
+void BW_MidiSequencer::processTimelineRow(bool isSeek, LoopRuntimeState &loopState, uint64_t &shortestDelay, bool &shortestDelayNotFound)
+{
+    const TimelineEntry    *timeline = m_timeline.data;
+    const size_t            timelineSize = m_timeline.size;
+    size_t                 &cur = m_currentPosition.timelineCursor;
+    size_t                 *due = m_timelineDue.data;
+    size_t                  dueCount = 0, i, j, tmp;
+
+    while(cur < timelineSize && !timelineIsDue(timeline[cur]))
+        ++cur;
+
+    if(cur >= timelineSize)
+        return; // Nothing left
+
+    const uint64_t rowTick = timeline[cur].tick;
+
+    /*
+     * Every track which has a row at this tick handles its next row, in the order of
+     * tracks. Normally these are the entries of one group of the same tick and sub-row,
+     * but when the previous step has been interrupted, some tracks are a row ahead.
+     */
+    for(i = cur; i < timelineSize && timeline[i].tick == rowTick; ++i)
+    {
+        if(!timelineIsDue(timeline[i]))
+            continue;
+
+        for(j = dueCount++; j > 0 && timeline[due[j - 1]].track > timeline[i].track; --j)
+            due[j] = due[j - 1];
+        due[j] = i;
     }
 
+    for(i = 0; i < dueCount; ++i)
+    {
+        const TimelineEntry &e = timeline[due[i]];
+        Position::TrackInfo &track = m_currentPosition.track[e.track];
+
+        rowBeginSaveTrack(e.track);
+
+        // Check is an end of track has been reached
+        if(e.row == NULL)
+        {
+            track.lastHandledEvent = -1;
+            break;
+        }
+
+        // Handle event
+        for(tmp = track.pos->data.events_begin; tmp < track.pos->data.events_end; ++tmp)
+        {
+            const MidiEvent &evt = m_eventBank[tmp];
+#ifdef ENABLE_BEGIN_SILENCE_SKIPPING
+            if(!m_currentPosition.began && (evt.type == MidiEvent::T_NOTEON))
+                m_currentPosition.began = true;
+#endif
+            if(isSeek && evt.type == MidiEvent::T_NOTEON)
+                continue;
+
+            handleEvent(e.track, evt, track.lastHandledEvent);
+
+            // Global non-stacked loop start
+            if(m_loop.caughtStart)
+            {
+                if(m_interface->onloopStart) // Loop Start hook
+                    m_interface->onloopStart(m_interface->onloopStart_userData);
+
+                ++loopState.numGlobLoopStarts;
+                m_loop.caughtStart = false;
+            }
+
+            // Global stacked loop start
+            handleLoopStart(loopState, m_loop, track, true);
+
+            if(handleLoopEnd(loopState, m_loop, track, true))
+                break;
+        }
+
+        // Read next event time (unless the track just ended)
+        if(track.lastHandledEvent >= 0)
+            track.pos = track.pos->next;
+
+        // Register global loop start position
+        if(loopState.numGlobLoopStarts > 0 && m_loopBeginPosition.absTimePosition <= 0.0)
+            m_loopBeginPosition = rowBeginPosition();
+
+        if(loopState.doLoopJump)
+            break;
+    }
+
+    // Skip the handled rows and the rows of ended tracks
+    while(cur < timelineSize && !timelineIsDue(timeline[cur]))
+        ++cur;
+
+    if(cur < timelineSize)
+    {
+        shortestDelay = timeline[cur].tick - rowTick;
+        shortestDelayNotFound = false;
+    }
+}
+
+bool BW_MidiSequencer::processEvents(bool isSeek)
+{
+    if(m_currentPosition.track_size == 0)
+        m_atEnd = true; // No MIDI track data to play
+
+    if(m_atEnd)
+        return false;   // No more events in the queue
+
+    m_loop.caughtEnd = false;
+    LoopRuntimeState    loopState;
+    uint64_t            shortestDelay = 0;
+    bool                shortestDelayNotFound = true;
+    Tempo_t t;
+
+    rowBeginStart();
+
+    std::memset(&loopState, 0, sizeof(loopState));
+
+    if(!m_timeline.empty())
+        processTimelineRow(isSeek, loopState, shortestDelay, shortestDelayNotFound);
+    else
+        processTracksRow(isSeek, loopState, shortestDelay, shortestDelayNotFound);
+
     tempo_mul(&t, &m_tempo, shortestDelay);
 
 #ifdef ENABLE_BEGIN_SILENCE_SKIPPING
@@ -815,9 +986,9 @@ bool BW_MidiSequencer::processEvents(bool isSeek)
     }
 
     if(loopState.numGlobLoopStarts > 0 && m_loopBeginPosition.absTimePosition <= 0.0)
-        m_loopBeginPosition = m_currentPositionBegin;
+        m_loopBeginPosition = rowBeginPosition();
 
-    if(processLoopPoints(loopState, m_loop, true, 0, m_currentPositionBegin))
+    if(processLoopPoints(loopState, m_loop, true, 0))
         return true; // When loop jump happen, quit the function
 
     if(shortestDelayNotFound || m_loop.caughtEnd)
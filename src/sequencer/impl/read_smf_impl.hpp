@@ -60,30 +60,38 @@ bool BW_MidiSequencer::smf_buildTracks(FileAndMemReader &fr, const size_t tracks
 
     buildSmfSetupReset(tracks_count);
 
-    // Attempt to rougly reserve the events bank
-    m_eventBank.reserve((fr.fileSize() / sizeof(MidiEvent)));
-    m_dataBank.reserve(10000);
-
-    offset_next = tracks_offset;
-
-    for(size_t tk = 0; tk < tracks_count; ++tk)
+    if(m_interface->runParallelJobs && tracks_count > 1 && fr.memData())
     {
-        // Read current track from here
-        fr.seek(offset_next, FileAndMemReader::SET);
+        if(!smf_buildTracksParallel(fr, tracks_offset, tracks_count, temposList, loopState))
+            return false; // Error already written!
+    }
+    else
+    {
+        // Attempt to rougly reserve the events bank
+        m_eventBank.reserve((fr.fileSize() / sizeof(MidiEvent)));
+        m_dataBank.reserve(10000);
+
+        offset_next = tracks_offset;
 
-        fsize = fr.read(headBuf, 1, 8);
-        if((fsize < 8) || (std::memcmp(headBuf, "MTrk", 4) != 0))
+        for(size_t tk = 0; tk < tracks_count; ++tk)
         {
-            m_parsingErrorsString.set(fr.fileName().c_str());
-            m_parsingErrorsString.append(": Invalid format, MTrk signature is not found!\n");
-            return false;
-        }
+            // Read current track from here
+            fr.seek(offset_next, FileAndMemReader::SET);
+
+            fsize = fr.read(headBuf, 1, 8);
+            if((fsize < 8) || (std::memcmp(headBuf, "MTrk", 4) != 0))
+            {
+                m_parsingErrorsString.set(fr.fileName().c_str());
+                m_parsingErrorsString.append(": Invalid format, MTrk signature is not found!\n");
+                return false;
+            }
 
-        trackLength = (size_t)readBEint(headBuf + 4, 4);
-        offset_next += trackLength + 8; // Track length plus header size
+            trackLength = (size_t)readBEint(headBuf + 4, 4);
+            offset_next += trackLength + 8; // Track length plus header size
 
-        if(!smf_buildOneTrack(fr, tk, trackLength, temposList, loopState))
-            return false; // Failed to parse track (error already written!)
+            if(!smf_buildOneTrack(fr, tk, trackLength, temposList, loopState))
+                return false; // Failed to parse track (error already written!)
+        }
     }
 
     if(m_modeEMIDI)
@@ -95,35 +103,114 @@ bool BW_MidiSequencer::smf_buildTracks(FileAndMemReader &fr, const size_t tracks
     return true;
 }
 
+bool BW_MidiSequencer::smf_buildTracksParallel(FileAndMemReader &fr,
+                                               const size_t tracks_offset,
+                                               const size_t tracks_count,
+                                               TemposList &temposList,
+                                               LoopPointParseState &loopState)
+{
+    uint8_t headBuf[8];
+    size_t offset_next = tracks_offset;
+    size_t tracks_found, events_total = 0, data_total = 0;
+    SmfTracksList tracks;
+    SmfDecodeJobs jobs;
+
+    tracks.resize_clean(tracks_count);
+
+    // Find all tracks first, then decode them at once
+    for(tracks_found = 0; tracks_found < tracks_count; ++tracks_found)
+    {
+        SmfTrack &track = tracks[tracks_found];
+
+        fr.seek(offset_next, FileAndMemReader::SET);
+        if((fr.read(headBuf, 1, 8) < 8) || (std::memcmp(headBuf, "MTrk", 4) != 0))
+            break; // Report after building of the found tracks, like the serial parse does
+
+        track.offset = offset_next + 8;
+        track.size = (size_t)readBEint(headBuf + 4, 4);
+        offset_next += track.size + 8; // Track length plus header size
+    }
+
+    jobs.self = this;
+    jobs.mem = fr.memData();
+    jobs.memSize = fr.fileSize();
+    jobs.tracks = &tracks;
+    m_interface->runParallelJobs(m_interface->runParallelJobs_userData, smf_decodeTrackJob, &jobs, static_cast<int>(tracks_found));
+
+    for(size_t tk = 0; tk < tracks_found; ++tk)
+    {
+        events_total += tracks[tk].events.size;
+        data_total += tracks[tk].dataBank.size;
+    }
+
+    // Sizes are known exactly now, plus the song begin hook event
+    m_eventBank.reserve(events_total + 1);
+    m_dataBank.reserve(data_total + 1);
+
+    // Everything song-wide goes in the order of tracks, so the result is the same as of the serial parse
+    for(size_t tk = 0; tk < tracks_found; ++tk)
+    {
+        SmfTrack &track = tracks[tk];
+        uint32_t bankBase = static_cast<uint32_t>(m_dataBank.size);
+
+        if(!track.ok)
+        {
+            m_parsingErrorsString.append(track.errors.c_str());
+            return false;
+        }
+
+        if(track.dataBank.size > 0)
+            m_dataBank.push_back_list(track.dataBank.data, track.dataBank.size);
+
+        smf_buildTrackRows(tk, track, bankBase, temposList, loopState);
+
+        track.events.clear();
+        track.dataBank.clear();
+    }
+
+    if(tracks_found < tracks_count)
+    {
+        m_parsingErrorsString.set(fr.fileName().c_str());
+        m_parsingErrorsString.append(": Invalid format, MTrk signature is not found!\n");
+        return false;
+    }
+
+    return true;
+}
+
+void BW_MidiSequencer::smf_decodeTrackJob(void *ctx, int index)
+{
+    SmfDecodeJobs *jobs = reinterpret_cast<SmfDecodeJobs *>(ctx);
+    SmfTrack &track = (*jobs->tracks)[index];
+    FileAndMemReader fr;
+
+    // Every job reads through its own cursor
+    fr.openData(jobs->mem, jobs->memSize);
+    fr.seek(track.offset, FileAndMemReader::SET);
+
+    track.ok = jobs->self->smf_decodeTrack(fr, index, track.size, track);
+}
+
 bool BW_MidiSequencer::smf_buildOneTrack(FileAndMemReader &fr,
                                      const size_t track_idx,
                                      const size_t track_size,
                                      TemposList &temposList,
                                      LoopPointParseState &loopState)
 {
-    MidiTrackRow evtPos;
+    SmfRowsState rs;
     MidiEvent event;
-    uint64_t abs_position = 0;
+    uint64_t delay = 0;
     TrackParseStatus status;
-    MidiTrackState &trackState = m_trackState[track_idx];
     const size_t end = fr.tell() + track_size;
-    bool ok = false, trackChannelNeeded = false, trackChannelHas = false;
-
-    //! Caches note on/off states.
-    bool noteStates[0x7FF]; // [ccc|cnnnnnnn] - c = channel, n = note
-    /* This is required to carefully detect zero-length notes           *
-     * and avoid a move of "note-off" event over "note-on" while sort.  *
-     * Otherwise, after sort those notes will play infinite sound       */
+    bool ok = false, dataEnd;
 
-    std::memset(&evtPos, 0, sizeof(MidiTrackRow));
     std::memset(&status, 0, sizeof(TrackParseStatus));
-    std::memset(noteStates, 0, sizeof(noteStates));
 
     // Time delay that follows the first event in the track
     if(m_format == Format_RSXX)
         ok = true;
     else
-        evtPos.delay = readVarLenEx(fr, end, ok);
+        delay = readVarLenEx(fr, end, ok);
 
     if(!ok)
     {
@@ -131,29 +218,11 @@ bool BW_MidiSequencer::smf_buildOneTrack(FileAndMemReader &fr,
         return false;
     }
 
-    // HACK: Begin every track with "Reset all controllers" event to avoid controllers state break came from end of song
-    if(track_idx == 0)
-    {
-        MidiEvent resetEvent;
-        std::memset(&resetEvent, 0, sizeof(resetEvent));
-        resetEvent.isValid = 1;
-        resetEvent.type = MidiEvent::T_SPECIAL;
-        resetEvent.subtype = MidiEvent::ST_SONG_BEGIN_HOOK;
-        addEventToBank(evtPos, resetEvent);
-    }
-
-    evtPos.absPos = abs_position;
-    abs_position += evtPos.delay;
-    m_trackData[track_idx].push_back(evtPos);
-    memset(&evtPos, 0, sizeof(MidiTrackRow));
+    smf_beginTrackRows(rs, track_idx, delay);
 
-    trackState.state.track_channel = 0xFF;
     status.devMask = Device_ANY;
     status.devMaskExclude = 0;
 
-    if((m_format == Format_MIDI && m_smfFormat == 1 && track_idx > 0) || m_format == Format_HMI)
-        trackChannelNeeded = true;
-
     do
     {
         event = smf_parseEvent(fr, end, status);
@@ -163,58 +232,208 @@ bool BW_MidiSequencer::smf_buildOneTrack(FileAndMemReader &fr,
             return false;
         }
 
-        addEventToBank(evtPos, event);
+        delay = 0;
+        dataEnd = false;
 
-        if(trackChannelNeeded && !trackChannelHas && event.type > 0x00 && event.type < 0xF0)
+        // Don't try to read delta after EndOfTrack event!
+        if(event.type != MidiEvent::T_SPECIAL || event.subtype != MidiEvent::ST_ENDTRACK)
         {
-            trackState.state.track_channel = event.channel;
-            trackChannelHas = true;
+            delay = readVarLenEx(fr, end, ok);
+            dataEnd = !ok;
         }
 
-        if(event.type == MidiEvent::T_SPECIAL)
+        smf_addTrackEvent(rs, event, delay, dataEnd, temposList, loopState);
+    }
+    while((fr.tell() <= end) && !dataEnd && (event.subtype != MidiEvent::ST_ENDTRACK));
+
+    smf_endTrackRows(rs, status, loopState);
+
+    return true;
+}
+
+bool BW_MidiSequencer::smf_decodeTrack(FileAndMemReader &fr,
+                                       const size_t track_idx,
+                                       const size_t track_size,
+                                       SmfTrack &track)
+{
+    SmfTrackEvent rec;
+    const size_t end = fr.tell() + track_size;
+    bool ok = false;
+
+    std::memset(&rec, 0, sizeof(rec));
+    std::memset(&track.status, 0, sizeof(TrackParseStatus));
+    track.status.devMask = Device_ANY;
+    track.status.devMaskExclude = 0;
+    track.firstDelay = 0;
+
+    // Rougly reserve the events list, most of events take 3 bytes or more
+    track.events.reserve(track_size / 3 + 1);
+
+    // Time delay that follows the first event in the track
+    if(m_format == Format_RSXX)
+        ok = true;
+    else
+        track.firstDelay = readVarLenEx(fr, end, ok);
+
+    if(!ok)
+    {
+        track.errors.appendFmt("buildTrackData: Can't read variable-length value at begin of track %lu.\n", (unsigned long)track_idx);
+        return false;
+    }
+
+    do
+    {
+        rec.event = smf_readEvent(fr, end, track.status, track.dataBank, track.errors);
+        if(!rec.event.isValid)
         {
-            if(event.subtype == MidiEvent::ST_TEMPOCHANGE)
-            {
-                TempoEvent t = {readBEint(event.data_loc, event.data_loc_size), abs_position};
-                temposList.push_back(t);
-            }
-            else
-                analyseLoopEvent(loopState, event, abs_position, &m_trackState[track_idx].loop);
+            track.errors.appendFmt("buildTrackData: Fail to parse event in the track %lu.\n", (unsigned long)track_idx);
+            return false;
         }
 
+        rec.dataBlock = track.status.gotDataBlock;
+        rec.delay = 0;
+        rec.dataEnd = false;
+
         // Don't try to read delta after EndOfTrack event!
-        if(event.type != MidiEvent::T_SPECIAL || event.subtype != MidiEvent::ST_ENDTRACK)
+        if(rec.event.type != MidiEvent::T_SPECIAL || rec.event.subtype != MidiEvent::ST_ENDTRACK)
         {
-            evtPos.delay = readVarLenEx(fr, end, ok);
-            if(!ok)
-            {
-                /* End of track has been reached! However, there is no EOT event presented */
-                event.type = MidiEvent::T_SPECIAL;
-                event.subtype = MidiEvent::ST_ENDTRACK;
-                event.isValid = 1;
-            }
+            rec.delay = readVarLenEx(fr, end, ok);
+            rec.dataEnd = !ok;
         }
 
-#ifdef ENABLE_END_SILENCE_SKIPPING
-        //Have track end on its own row? Clear any delay on the row before
-        if(event.type == MidiEvent::T_SPECIAL && event.subtype == MidiEvent::ST_ENDTRACK && (evtPos.events_end - evtPos.events_begin) == 1)
+        if(track.events.size + 1 >= track.events.capacity)
+            track.events.reserve(track.events.capacity * 2);
+
+        track.events.push_back(rec);
+    }
+    while((fr.tell() <= end) && !rec.dataEnd && (rec.event.subtype != MidiEvent::ST_ENDTRACK));
+
+    return true;
+}
+
+void BW_MidiSequencer::smf_buildTrackRows(const size_t track_idx,
+                                          const SmfTrack &track,
+                                          uint32_t bankBase,
+                                          TemposList &temposList,
+                                          LoopPointParseState &loopState)
+{
+    SmfRowsState rs;
+    MidiEvent event;
+
+    smf_beginTrackRows(rs, track_idx, track.firstDelay);
+
+    for(size_t i = 0; i < track.events.size; ++i)
+    {
+        const SmfTrackEvent &rec = track.events[i];
+
+        event = rec.event;
+        if(rec.dataBlock)
+            event.data_block.offset += bankBase;
+
+        smf_applyEvent(event);
+        smf_addTrackEvent(rs, event, rec.delay, rec.dataEnd, temposList, loopState);
+    }
+
+    smf_endTrackRows(rs, track.status, loopState);
+}
+
+void BW_MidiSequencer::smf_beginTrackRows(SmfRowsState &rs, const size_t track_idx, uint64_t delay)
+{
+    MidiTrackState &trackState = m_trackState[track_idx];
+
+    std::memset(&rs.evtPos, 0, sizeof(MidiTrackRow));
+    std::memset(rs.noteStates, 0, sizeof(rs.noteStates));
+    rs.abs_position = 0;
+    rs.track_idx = track_idx;
+    rs.trackChannelNeeded = false;
+    rs.trackChannelHas = false;
+
+    // Time delay that follows the first event in the track
+    rs.evtPos.delay = delay;
+
+    // HACK: Begin every track with "Reset all controllers" event to avoid controllers state break came from end of song
+    if(track_idx == 0)
+    {
+        MidiEvent resetEvent;
+        std::memset(&resetEvent, 0, sizeof(resetEvent));
+        resetEvent.isValid = 1;
+        resetEvent.type = MidiEvent::T_SPECIAL;
+        resetEvent.subtype = MidiEvent::ST_SONG_BEGIN_HOOK;
+        addEventToBank(rs.evtPos, resetEvent);
+    }
+
+    rs.evtPos.absPos = rs.abs_position;
+    rs.abs_position += rs.evtPos.delay;
+    m_trackData[track_idx].push_back(rs.evtPos);
+    memset(&rs.evtPos, 0, sizeof(MidiTrackRow));
+
+    trackState.state.track_channel = 0xFF;
+
+    if((m_format == Format_MIDI && m_smfFormat == 1 && track_idx > 0) || m_format == Format_HMI)
+        rs.trackChannelNeeded = true;
+}
+
+void BW_MidiSequencer::smf_addTrackEvent(SmfRowsState &rs, MidiEvent event, uint64_t delay, bool dataEnd,
+                                         TemposList &temposList, LoopPointParseState &loopState)
+{
+    const size_t track_idx = rs.track_idx;
+
+    addEventToBank(rs.evtPos, event);
+
+    if(rs.trackChannelNeeded && !rs.trackChannelHas && event.type > 0x00 && event.type < 0xF0)
+    {
+        m_trackState[track_idx].state.track_channel = event.channel;
+        rs.trackChannelHas = true;
+    }
+
+    if(event.type == MidiEvent::T_SPECIAL)
+    {
+        if(event.subtype == MidiEvent::ST_TEMPOCHANGE)
         {
-            if (!m_trackData[track_idx].empty())
-            {
-                MidiTrackRow &previous = m_trackData[track_idx].m_last->data;
-                previous.delay = 0;
-                previous.timeDelay = 0;
-            }
+            TempoEvent t = {readBEint(event.data_loc, event.data_loc_size), rs.abs_position};
+            temposList.push_back(t);
         }
-#endif
+        else
+            analyseLoopEvent(loopState, event, rs.abs_position, &m_trackState[track_idx].loop);
+    }
+
+    // There is no delta after EndOfTrack event
+    if(event.type != MidiEvent::T_SPECIAL || event.subtype != MidiEvent::ST_ENDTRACK)
+    {
+        rs.evtPos.delay = delay;
+        if(dataEnd)
+        {
+            /* End of track has been reached! However, there is no EOT event presented */
+            event.type = MidiEvent::T_SPECIAL;
+            event.subtype = MidiEvent::ST_ENDTRACK;
+            event.isValid = 1;
+        }
+    }
 
-        if((evtPos.delay > 0) || loopState.gotLoopEventsInThisRow > 0 || (event.subtype == MidiEvent::ST_ENDTRACK))
+#ifdef ENABLE_END_SILENCE_SKIPPING
+    //Have track end on its own row? Clear any delay on the row before
+    if(event.type == MidiEvent::T_SPECIAL && event.subtype == MidiEvent::ST_ENDTRACK && (rs.evtPos.events_end - rs.evtPos.events_begin) == 1)
+    {
+        if (!m_trackData[track_idx].empty())
         {
-            sortEvents(evtPos, m_eventBank, noteStates);
-            smf_flushRow(evtPos, abs_position, track_idx, loopState);
+            MidiTrackRow &previous = m_trackData[track_idx].m_last->data;
+            previous.delay = 0;
+            previous.timeDelay = 0;
         }
     }
-    while((fr.tell() <= end) && (event.subtype != MidiEvent::ST_ENDTRACK));
+#endif
+
+    if((rs.evtPos.delay > 0) || loopState.gotLoopEventsInThisRow > 0 || (event.subtype == MidiEvent::ST_ENDTRACK))
+    {
+        sortEvents(rs.evtPos, m_eventBank, rs.noteStates);
+        smf_flushRow(rs.evtPos, rs.abs_position, track_idx, loopState);
+    }
+}
+
+void BW_MidiSequencer::smf_endTrackRows(SmfRowsState &rs, const TrackParseStatus &status, LoopPointParseState &loopState)
+{
+    const size_t track_idx = rs.track_idx;
+    MidiTrackState &trackState = m_trackState[track_idx];
 
     // When EMIDI is active
     if(m_modeEMIDI)
@@ -237,17 +456,26 @@ bool BW_MidiSequencer::smf_buildOneTrack(FileAndMemReader &fr,
         }
     }
 
-    if(loopState.ticksSongLength < abs_position)
-        loopState.ticksSongLength = abs_position;
+    if(loopState.ticksSongLength < rs.abs_position)
+        loopState.ticksSongLength = rs.abs_position;
 
     // Set the chain of events begin
     initTracksBegin(track_idx);
-
-    return true;
 }
 
 
 BW_MidiSequencer::MidiEvent BW_MidiSequencer::smf_parseEvent(FileAndMemReader &fr, const size_t end, TrackParseStatus &status)
+{
+    BW_MidiSequencer::MidiEvent evt = smf_readEvent(fr, end, status, m_dataBank, m_parsingErrorsString);
+
+    if(evt.isValid)
+        smf_applyEvent(evt);
+
+    return evt;
+}
+
+BW_MidiSequencer::MidiEvent BW_MidiSequencer::smf_readEvent(FileAndMemReader &fr, const size_t end, TrackParseStatus &status,
+                                                          U8List &bank, ErrString &errors)
 {
     uint8_t byte, midCh, evType;
     size_t locSize;
@@ -256,6 +484,7 @@ BW_MidiSequencer::MidiEvent BW_MidiSequencer::smf_parseEvent(FileAndMemReader &f
 
     std::memset(&evt, 0, sizeof(evt));
     evt.isValid = 1;
+    status.gotDataBlock = false;
 
     if(fr.tell() + 1 > end)
     {
@@ -268,7 +497,7 @@ BW_MidiSequencer::MidiEvent BW_MidiSequencer::smf_parseEvent(FileAndMemReader &f
 
     if(fr.read(&byte, 1, 1) != 1)
     {
-        m_parsingErrorsString.append("parseEvent: Failed to read first byte of the event\n");
+        errors.append("parseEvent: Failed to read first byte of the event\n");
         evt.isValid = 0;
         return evt;
     }
@@ -278,13 +507,14 @@ BW_MidiSequencer::MidiEvent BW_MidiSequencer::smf_parseEvent(FileAndMemReader &f
         uint64_t length = readVarLenEx(fr, end, ok);
         if(!ok || (fr.tell() + length > end))
         {
-            m_parsingErrorsString.append("parseEvent: Can't read SysEx event - Unexpected end of track data.\n");
+            errors.append("parseEvent: Can't read SysEx event - Unexpected end of track data.\n");
             evt.isValid = 0;
             return evt;
         }
 
         evt.type = MidiEvent::T_SYSEX;
-        insertDataToBankWithByte(evt, m_dataBank, byte, fr, length);
+        insertDataToBankWithByte(evt, bank, byte, fr, length);
+        status.gotDataBlock = true;
         return evt;
     }
 
@@ -297,7 +527,7 @@ BW_MidiSequencer::MidiEvent BW_MidiSequencer::smf_parseEvent(FileAndMemReader &f
 
         if(fr.read(&evtype, 1, 1) != 1)
         {
-            m_parsingErrorsString.append("parseEvent: Failed to read event type!\n");
+            errors.append("parseEvent: Failed to read event type!\n");
             evt.isValid = 0;
             return evt;
         }
@@ -306,7 +536,7 @@ BW_MidiSequencer::MidiEvent BW_MidiSequencer::smf_parseEvent(FileAndMemReader &f
 
         if(!ok || (fr.tell() + length > end))
         {
-            m_parsingErrorsString.append("parseEvent: Can't read Special event - Unexpected end of track data.\n");
+            errors.append("parseEvent: Can't read Special event - Unexpected end of track data.\n");
             evt.isValid = 0;
             return evt;
         }
@@ -324,7 +554,7 @@ BW_MidiSequencer::MidiEvent BW_MidiSequencer::smf_parseEvent(FileAndMemReader &f
         case MidiEvent::ST_KEYSIGNATURE:
             if(length > 5)
             {
-                m_parsingErrorsString.append("parseEvent: Can't read one of special events - Too long event data (more than 5!).\n");
+                errors.append("parseEvent: Can't read one of special events - Too long event data (more than 5!).\n");
                 evt.isValid = 0;
                 return evt;
             }
@@ -332,7 +562,7 @@ BW_MidiSequencer::MidiEvent BW_MidiSequencer::smf_parseEvent(FileAndMemReader &f
             evt.data_loc_size = length;
             if(fr.read(evt.data_loc, 1, length) != length)
             {
-                m_parsingErrorsString.append("parseEvent: Failed to read event's data (1).\n");
+                errors.append("parseEvent: Failed to read event's data (1).\n");
                 evt.isValid = 0;
                 return evt;
             }
@@ -343,50 +573,17 @@ BW_MidiSequencer::MidiEvent BW_MidiSequencer::smf_parseEvent(FileAndMemReader &f
 #endif
             break;
         case MidiEvent::ST_COPYRIGHT:
-            insertDataToBankWithTerm(evt, m_dataBank, fr, length);
-            entry = reinterpret_cast<const char*>(getData(evt.data_block));
-
-            if(m_musCopyright.size == 0)
-            {
-                m_musCopyright = evt.data_block;
-
-                if(m_interface->onDebugMessage)
-                    m_interface->onDebugMessage(m_interface->onDebugMessage_userData, "Music copyright: %s", entry);
-            }
-            else if(m_interface->onDebugMessage)
-                m_interface->onDebugMessage(m_interface->onDebugMessage_userData, "Extra copyright event: %s", entry);
-            break;
-
         case MidiEvent::ST_SQTRKTITLE:
-            insertDataToBankWithTerm(evt, m_dataBank, fr, length);
-            entry = reinterpret_cast<const char*>(getData(evt.data_block));
-
-            if(m_musTitle.size == 0)
-            {
-                m_musTitle = evt.data_block;
-                if(m_interface->onDebugMessage)
-                    m_interface->onDebugMessage(m_interface->onDebugMessage_userData, "Music title: %s", entry);
-            }
-            else
-            {
-                m_musTrackTitles.push_back(evt.data_block);
-
-                if(m_interface->onDebugMessage)
-                    m_interface->onDebugMessage(m_interface->onDebugMessage_userData, "Track title: %s", entry);
-            }
-            break;
-
         case MidiEvent::ST_INSTRTITLE:
-            insertDataToBankWithTerm(evt, m_dataBank, fr, length);
-            entry = reinterpret_cast<const char*>(getData(evt.data_block));
-
-            if(m_interface->onDebugMessage)
-                m_interface->onDebugMessage(m_interface->onDebugMessage_userData, "Instrument: %s", entry);
+            // Song titles get registered by smf_applyEvent()
+            insertDataToBankWithTerm(evt, bank, fr, length);
+            status.gotDataBlock = true;
             break;
 
         case MidiEvent::ST_MARKER:
-            insertDataToBankWithTerm(evt, m_dataBank, fr, length);
-            entry = reinterpret_cast<const char*>(getData(evt.data_block));
+            insertDataToBankWithTerm(evt, bank, fr, length);
+            status.gotDataBlock = true;
+            entry = reinterpret_cast<const char*>(getData(evt.data_block, bank));
 
             if(strEqual(entry, length, "loopstart"))
             {
@@ -410,18 +607,6 @@ BW_MidiSequencer::MidiEvent BW_MidiSequencer::smf_parseEvent(FileAndMemReader &f
                 evt.subtype = MidiEvent::ST_LOOPSTACK_BEGIN;
                 evt.data_loc_size = 1;
                 evt.data_loc[0] = static_cast<uint8_t>(std::atoi(loop_key));
-
-                if(m_interface->onDebugMessage)
-                {
-                    m_interface->onDebugMessage(
-                        m_interface->onDebugMessage_userData,
-                        "Stack Marker Loop Start at %d to %d level with %d loops",
-                        m_loop.stackLevel,
-                        m_loop.stackLevel + 1,
-                        evt.data_loc[0]
-                    );
-                }
-
                 return evt;
             }
             else if(length > 8 && strEqual(entry, 8, "loopend="))
@@ -429,17 +614,6 @@ BW_MidiSequencer::MidiEvent BW_MidiSequencer::smf_parseEvent(FileAndMemReader &f
                 evt.type = MidiEvent::T_SPECIAL;
                 evt.subtype = MidiEvent::ST_LOOPSTACK_END;
                 evt.data_loc_size = 0;
-
-                if(m_interface->onDebugMessage)
-                {
-                    m_interface->onDebugMessage(
-                        m_interface->onDebugMessage_userData,
-                        "Stack Marker Loop %s at %d to %d level",
-                        (evt.subtype == MidiEvent::ST_LOOPSTACK_END ? "End" : "Break"),
-                        m_loop.stackLevel,
-                        m_loop.stackLevel - 1
-                    );
-                }
                 return evt;
             }
             break;
@@ -449,7 +623,8 @@ BW_MidiSequencer::MidiEvent BW_MidiSequencer::smf_parseEvent(FileAndMemReader &f
             break;
 
         default: // Unknown special event
-            insertDataToBank(evt, m_dataBank, fr, length);
+            insertDataToBank(evt, bank, fr, length);
+            status.gotDataBlock = (evt.data_block.offset & DATA_BLOCK_BORROWED) == 0;
             break;
         }
 
@@ -471,7 +646,7 @@ BW_MidiSequencer::MidiEvent BW_MidiSequencer::smf_parseEvent(FileAndMemReader &f
     {
         if(fr.tell() + 1 > end)
         {
-            m_parsingErrorsString.appendFmt("parseEvent: Can't read RSXX specific event of type 0x%02X- Unexpected end of track data.\n", byte);
+            errors.appendFmt("parseEvent: Can't read RSXX specific event of type 0x%02X- Unexpected end of track data.\n", byte);
             evt.isValid = 0;
             return evt;
         }
@@ -500,7 +675,7 @@ BW_MidiSequencer::MidiEvent BW_MidiSequencer::smf_parseEvent(FileAndMemReader &f
 
         if(fr.tell() + locSize > end)
         {
-            m_parsingErrorsString.appendFmt("parseEvent: Can't read event of type 0x%02X- Unexpected end of track data.\n", byte);
+            errors.appendFmt("parseEvent: Can't read event of type 0x%02X- Unexpected end of track data.\n", byte);
             evt.isValid = 0;
             return evt;
         }
@@ -521,7 +696,7 @@ BW_MidiSequencer::MidiEvent BW_MidiSequencer::smf_parseEvent(FileAndMemReader &f
 
     if(fr.tell() + locSize > end)
     {
-        m_parsingErrorsString.appendFmt("parseEvent: Can't read regular %u-byte event - Unexpected end of track data.\n", (unsigned)locSize);
+        errors.appendFmt("parseEvent: Can't read regular %u-byte event - Unexpected end of track data.\n", (unsigned)locSize);
         evt.isValid = 0;
         return evt;
     }
@@ -616,18 +791,7 @@ BW_MidiSequencer::MidiEvent BW_MidiSequencer::smf_parseEvent(FileAndMemReader &f
                         break;
                     }
                 }
-                else if(m_loopFormat == Loop_Default) // RPG Maker format loop start
-                {
-                    // Change event type to custom Loop Start event and clear data
-                    evt.type = MidiEvent::T_SPECIAL;
-                    evt.subtype = MidiEvent::ST_LOOPSTART;
-                    m_loopFormat = Loop_HMI;
-                }
-                else if(m_loopFormat == Loop_HMI) // Invalid HMI loop point
-                {
-                    // Repeating of 110'th point is BAD practice, treat as default
-                    m_loopFormat = Loop_Default;
-                }
+                // Otherwise, it's RPG Maker loop point handled by smf_applyEvent()
                 break;
 
             case 111:
@@ -687,18 +851,7 @@ BW_MidiSequencer::MidiEvent BW_MidiSequencer::smf_parseEvent(FileAndMemReader &f
                         break;
                     }
                 }
-                else if(m_loopFormat == Loop_HMI)
-                {
-                    // Change event type to custom Loop End event and clear data
-                    evt.type = MidiEvent::T_SPECIAL;
-                    evt.subtype = MidiEvent::ST_LOOPEND;
-                }
-                else if(m_loopFormat == Loop_Default)
-                {
-                    // Change event type to custom Loop Start event and clear data
-                    evt.type = MidiEvent::T_SPECIAL;
-                    evt.subtype = MidiEvent::ST_LOOPSTART;
-                }
+                // Otherwise, it's RPG Maker loop point handled by smf_applyEvent()
                 break;
 
             case 112:
@@ -727,17 +880,6 @@ BW_MidiSequencer::MidiEvent BW_MidiSequencer::smf_parseEvent(FileAndMemReader &f
                     evt.subtype = MidiEvent::ST_TRACK_LOOPSTACK_BEGIN;
                     evt.data_loc[0] = evt.data_loc[1];
                     evt.data_loc_size = 1;
-
-                    if(m_interface->onDebugMessage)
-                    {
-                        m_interface->onDebugMessage(
-                            m_interface->onDebugMessage_userData,
-                            "Stack EMIDI Loop Start at %d to %d level with %d loops",
-                            m_loop.stackLevel,
-                            m_loop.stackLevel + 1,
-                            evt.data_loc[0]
-                        );
-                    }
                 }
                 break;
 
@@ -747,70 +889,11 @@ BW_MidiSequencer::MidiEvent BW_MidiSequencer::smf_parseEvent(FileAndMemReader &f
                     evt.type = MidiEvent::T_SPECIAL;
                     evt.subtype = MidiEvent::ST_TRACK_LOOPSTACK_END;
                     evt.data_loc_size = 0;
-
-                    if(m_interface->onDebugMessage)
-                    {
-                        m_interface->onDebugMessage(
-                            m_interface->onDebugMessage_userData,
-                            "Stack EMIDI Loop End at %d to %d level",
-                            m_loop.stackLevel,
-                            m_loop.stackLevel - 1
-                        );
-                    }
                 }
                 break;
             }
             break;
 
-        case Format_XMIDI:
-            switch(evt.data_loc[0])
-            {
-            case 116:  // For Loop Controller
-                evt.type = MidiEvent::T_SPECIAL;
-                evt.subtype = MidiEvent::ST_LOOPSTACK_BEGIN;
-                evt.data_loc[0] = evt.data_loc[1];
-                evt.data_loc_size = 1;
-
-                if(m_interface->onDebugMessage)
-                {
-                    m_interface->onDebugMessage(
-                        m_interface->onDebugMessage_userData,
-                        "Stack XMI Loop Start at %d to %d level with %d loops",
-                        m_loop.stackLevel,
-                        m_loop.stackLevel + 1,
-                        evt.data_loc[0]
-                    );
-                }
-                break;
-
-            case 117:  // Next/Break Loop Controller
-                evt.type = MidiEvent::T_SPECIAL;
-                evt.subtype = evt.data_loc[1] < 64 ?
-                            MidiEvent::ST_LOOPSTACK_BREAK :
-                            MidiEvent::ST_LOOPSTACK_END;
-                evt.data_loc_size = 0;
-
-                if(m_interface->onDebugMessage)
-                {
-                    m_interface->onDebugMessage(
-                        m_interface->onDebugMessage_userData,
-                        "Stack XMI Loop %s at %d to %d level",
-                        (evt.subtype == MidiEvent::ST_LOOPSTACK_END ? "End" : "Break"),
-                        m_loop.stackLevel,
-                        m_loop.stackLevel - 1
-                    );
-                }
-                break;
-
-            case 119:  // Callback Trigger
-                evt.type = MidiEvent::T_SPECIAL;
-                evt.subtype = MidiEvent::ST_CALLBACK_TRIGGER;
-                evt.data_loc[0] = evt.data_loc[1];
-                evt.data_loc_size = 1;
-                break;
-            }
-            break;
-
         case Format_CMF:
             switch(evt.data_loc[0])
             {
@@ -856,6 +939,147 @@ BW_MidiSequencer::MidiEvent BW_MidiSequencer::smf_parseEvent(FileAndMemReader &f
     return evt;
 }
 
+void BW_MidiSequencer::smf_applyEvent(MidiEvent &evt)
+{
+    const char *entry;
+
+    if(evt.type == MidiEvent::T_CTRLCHANGE)
+    {
+        if(m_format != Format_MIDI || m_modeEMIDI)
+            return; // EMIDI controllers are already handled while reading
+
+        switch(evt.data_loc[0])
+        {
+        case 110:
+            if(m_loopFormat == Loop_Default) // RPG Maker format loop start
+            {
+                // Change event type to custom Loop Start event and clear data
+                evt.type = MidiEvent::T_SPECIAL;
+                evt.subtype = MidiEvent::ST_LOOPSTART;
+                m_loopFormat = Loop_HMI;
+            }
+            else if(m_loopFormat == Loop_HMI) // Invalid HMI loop point
+            {
+                // Repeating of 110'th point is BAD practice, treat as default
+                m_loopFormat = Loop_Default;
+            }
+            break;
+
+        case 111:
+            if(m_loopFormat == Loop_HMI)
+            {
+                // Change event type to custom Loop End event and clear data
+                evt.type = MidiEvent::T_SPECIAL;
+                evt.subtype = MidiEvent::ST_LOOPEND;
+            }
+            else if(m_loopFormat == Loop_Default)
+            {
+                // Change event type to custom Loop Start event and clear data
+                evt.type = MidiEvent::T_SPECIAL;
+                evt.subtype = MidiEvent::ST_LOOPSTART;
+            }
+            break;
+        }
+
+        return;
+    }
+
+    if(evt.type != MidiEvent::T_SPECIAL)
+        return;
+
+    switch(evt.subtype)
+    {
+    case MidiEvent::ST_COPYRIGHT:
+        entry = reinterpret_cast<const char*>(getData(evt.data_block));
+
+        if(m_musCopyright.size == 0)
+        {
+            m_musCopyright = evt.data_block;
+
+            if(m_interface->onDebugMessage)
+                m_interface->onDebugMessage(m_interface->onDebugMessage_userData, "Music copyright: %s", entry);
+        }
+        else if(m_interface->onDebugMessage)
+            m_interface->onDebugMessage(m_interface->onDebugMessage_userData, "Extra copyright event: %s", entry);
+        break;
+
+    case MidiEvent::ST_SQTRKTITLE:
+        entry = reinterpret_cast<const char*>(getData(evt.data_block));
+
+        if(m_musTitle.size == 0)
+        {
+            m_musTitle = evt.data_block;
+            if(m_interface->onDebugMessage)
+                m_interface->onDebugMessage(m_interface->onDebugMessage_userData, "Music title: %s", entry);
+        }
+        else
+        {
+            m_musTrackTitles.push_back(evt.data_block);
+
+            if(m_interface->onDebugMessage)
+                m_interface->onDebugMessage(m_interface->onDebugMessage_userData, "Track title: %s", entry);
+        }
+        break;
+
+    case MidiEvent::ST_INSTRTITLE:
+        entry = reinterpret_cast<const char*>(getData(evt.data_block));
+
+        if(m_interface->onDebugMessage)
+            m_interface->onDebugMessage(m_interface->onDebugMessage_userData, "Instrument: %s", entry);
+        break;
+
+    case MidiEvent::ST_LOOPSTACK_BEGIN:
+        if(m_interface->onDebugMessage)
+        {
+            m_interface->onDebugMessage(
+                m_interface->onDebugMessage_userData,
+                "Stack Marker Loop Start at %d to %d level with %d loops",
+                m_loop.stackLevel,
+                m_loop.stackLevel + 1,
+                evt.data_loc[0]
+            );
+        }
+        break;
+
+    case MidiEvent::ST_LOOPSTACK_END:
+        if(m_interface->onDebugMessage)
+        {
+            m_interface->onDebugMessage(
+                m_interface->onDebugMessage_userData,
+                "Stack Marker Loop End at %d to %d level",
+                m_loop.stackLevel,
+                m_loop.stackLevel - 1
+            );
+        }
+        break;
+
+    case MidiEvent::ST_TRACK_LOOPSTACK_BEGIN:
+        if(m_interface->onDebugMessage)
+        {
+            m_interface->onDebugMessage(
+                m_interface->onDebugMessage_userData,
+                "Stack EMIDI Loop Start at %d to %d level with %d loops",
+                m_loop.stackLevel,
+                m_loop.stackLevel + 1,
+                evt.data_loc[0]
+            );
+        }
+        break;
+
+    case MidiEvent::ST_TRACK_LOOPSTACK_END:
+        if(m_interface->onDebugMessage)
+        {
+            m_interface->onDebugMessage(
+                m_interface->onDebugMessage_userData,
+                "Stack EMIDI Loop End at %d to %d level",
+                m_loop.stackLevel,
+                m_loop.stackLevel - 1
+            );
+        }
+        break;
+    }
+}
+
 void BW_MidiSequencer::smf_flushRow(MidiTrackRow &evtPos, uint64_t &abs_position, size_t track_num, LoopPointParseState &loopState, bool finish)
 {
     evtPos.absPos = abs_position;
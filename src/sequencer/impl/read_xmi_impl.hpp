@@ -31,19 +31,33 @@
 #include "../midi_sequencer.hpp"
 
 #ifndef BWMIDI_DISABLE_XMI_SUPPORT
-#include "cvt_xmi2mid.hpp"
+
+/*
+ * XMI events are stored the same as SMF ones, except of these differences:
+ * - Delays are sums of bytes less than 0x80 instead of variable-length values
+ * - Note-On has the variable-length duration after the velocity, no Note-Off events
+ * - No running status
+ * - The tick is 1/120 of second, the tempo events don't change it
+ *
+ * Ticks are multiplied by 3, the division is computed from the first tempo event and
+ * other tempo events are dropped, so the timing is equal to the SMF produced by the
+ * conventional XMI to MIDI converter.
+ */
+#define BWMIDI_XMI_TICK_MULT 3
+
+static const uint8_t s_xmi_evtSize[16] =
+{
+//  0  1  2  3  4  5  6  7  8  9  A  B  C  D  E  F
+    0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2, 2, 1, 1, 2, 0
+};
 
 
 bool BW_MidiSequencer::parseXMI(FileAndMemReader &fr)
 {
     const size_t headerSize = 14;
     char headerBuf[headerSize] = "";
-    size_t fsize = 0;
-//    BufferGuard<uint8_t> cvt_buf;
-    RawSongsList song_buf;
-    bool ret;
-
-    // (void)Convert_xmi2midi; /* Shut up the warning */
+    uint8_t chunkBuf[12];
+    size_t fsize = 0, file_size, pos, end, len, songsCount = 0, songsGot = 0;
 
     fsize = fr.read(headerBuf, 1, headerSize);
     if(fsize < headerSize)
@@ -66,62 +80,474 @@ bool BW_MidiSequencer::parseXMI(FileAndMemReader &fr)
         return false;
     }
 
-    size_t mus_len = fr.fileSize();
-    fr.seek(0, FileAndMemReader::SET);
+    file_size = fr.fileSize();
+
+    // Find the number of songs at the INFO chunk of the XDIR form
+    len = static_cast<size_t>(readBEint(headerBuf + 4, 4));
+    end = (len < file_size - 8) ? 8 + len : file_size;
+    pos = 12;
 
-    uint8_t *mus = (uint8_t*)std::malloc(mus_len + 20);
-    if(!mus)
+    while(pos + 8 <= end)
     {
-        m_errorString.set("Out of memory!");
+        fr.seek(pos, FileAndMemReader::SET);
+        if(fr.read(chunkBuf, 1, 8) != 8)
+            break;
+
+        len = static_cast<size_t>(readBEint(chunkBuf + 4, 4));
+
+        if(std::memcmp(chunkBuf, "INFO", 4) == 0)
+        {
+            if(len >= 2)
+                readUInt16LE(songsCount, fr);
+            break;
+        }
+
+        pos += 8 + ((len + 1) & ~static_cast<size_t>(1));
+    }
+
+    if(songsCount == 0)
+    {
+        m_errorString.set(fr.fileName().c_str());
+        m_errorString.append(": Invalid format, no songs in the XDIR!\n");
         return false;
     }
 
-    std::memset(mus, 0, mus_len + 20);
+    // Songs are the FORM XMID chunks of the CAT chunk
+    len = static_cast<size_t>(readBEint(headerBuf + 4, 4));
+    pos = 8 + ((len + 1) & ~static_cast<size_t>(1));
 
-    fsize = fr.read(mus, 1, mus_len);
-    if(fsize < mus_len)
+    fr.seek(pos, FileAndMemReader::SET);
+    if(fr.read(chunkBuf, 1, 12) != 12 ||
+       std::memcmp(chunkBuf, "CAT ", 4) != 0 || std::memcmp(chunkBuf + 8, "XMID", 4) != 0)
     {
-        m_errorString.set("Failed to read XMI file data!\n");
+        m_errorString.set(fr.fileName().c_str());
+        m_errorString.append(": Invalid format, CAT XMID signature is not found!\n");
         return false;
     }
 
-    // Close source stream
-    fr.close();
+    pos += 12;
+    m_rawSongsData.resize(songsCount);
+
+    while(songsGot < songsCount && pos + 12 <= file_size)
+    {
+        fr.seek(pos, FileAndMemReader::SET);
+        if(fr.read(chunkBuf, 1, 12) != 12)
+            break;
+
+        len = static_cast<size_t>(readBEint(chunkBuf + 4, 4));
+        if(len > file_size - pos - 8)
+            len = file_size - pos - 8;
 
-//    uint8_t *mid = NULL;
-//    uint32_t mid_len = 0;
-    int m2mret = Convert_xmi2midi_multi(mus, static_cast<uint32_t>(mus_len + 20),
-                                        song_buf, XMIDI_CONVERT_NOCONVERSION);
-    if(mus)
-        free(mus);
+        if(std::memcmp(chunkBuf, "FORM", 4) == 0 && std::memcmp(chunkBuf + 8, "XMID", 4) == 0)
+        {
+            // Keep the raw song to load it directly on the song switch
+            RawSongEntry &song = m_rawSongsData[songsGot++];
+            song.resize(len - 4);
+            if(fr.read(song.data, 1, song.size) != song.size)
+            {
+                m_rawSongsData.clear();
+                m_errorString.set("Failed to read XMI file data!\n");
+                return false;
+            }
+        }
+
+        pos += 8 + ((len + 1) & ~static_cast<size_t>(1));
+    }
 
-    if(m2mret < 0)
+    if(songsGot == 0)
     {
-        song_buf.clear();
-        m_errorString.set("Invalid XMI data format!");
+        m_rawSongsData.clear();
+        m_errorString.set(fr.fileName().c_str());
+        m_errorString.append(": Invalid format, no XMID forms found!\n");
         return false;
     }
 
-    if(m_loadTrackNumber >= (int)song_buf.size)
-        m_loadTrackNumber = song_buf.size - 1;
+    m_rawSongsData.resize(songsGot);
 
-    m_rawSongsData.resize(song_buf.size);
+    // Close source stream
+    fr.close();
 
-    for(size_t i = 0; i < song_buf.size; ++i)
-        song_buf[i].move_to(m_rawSongsData[i]);
+    if(m_loadTrackNumber >= (int)m_rawSongsData.size)
+        m_loadTrackNumber = m_rawSongsData.size - 1;
 
-    song_buf.clear();
+    // Set format as XMIDI
+    m_format = Format_XMIDI;
 
-    // cvt_buf.set(mid);
-    // Open converted MIDI file
     fr.openData(m_rawSongsData[m_loadTrackNumber].data,
                 m_rawSongsData[m_loadTrackNumber].size);
-    // Set format as XMIDI
-    m_format = Format_XMIDI;
 
-    ret = parseSMF(fr);
+    return xmi_parseSong(fr, 0, m_rawSongsData[m_loadTrackNumber].size);
+}
+
+bool BW_MidiSequencer::xmi_parseSong(FileAndMemReader &fr, size_t begin, size_t end)
+{
+    uint8_t chunkBuf[8];
+    size_t pos, len = 0, evnt_begin = 0, evnt_end = 0, branch_count, i, j;
+    uint32_t branch[128];
+    uint8_t branch_order[128];
+    size_t branches = 0, branch_next = 0;
+    uint16_t branch_id;
+    uint32_t branch_offset;
+    uint64_t time = 0, duration;
+    uint32_t tempo = 0;
+    size_t division = 60; // When song has no tempo events
+    int byte;
+    bool gotEnd = false;
+    MidiEvent event;
+    DuratedNote noteOff;
+    XMIParseState ps;
+
+    for(i = 0; i < 128; ++i)
+        branch[i] = ~0u;
+
+    // Find the events and the branch points
+    for(pos = begin; pos + 8 <= end; pos += 8 + ((len + 1) & ~static_cast<size_t>(1)))
+    {
+        fr.seek(pos, FileAndMemReader::SET);
+        if(fr.read(chunkBuf, 1, 8) != 8)
+            break;
+
+        len = static_cast<size_t>(readBEint(chunkBuf + 4, 4));
+        if(len > end - pos - 8)
+            len = end - pos - 8;
+
+        if(std::memcmp(chunkBuf, "RBRN", 4) == 0)
+        {
+            if(len < 2 || !readUInt16LE(branch_count, fr) || len - 2 < 6 * branch_count)
+                continue; // Insufficient data
+
+            for(i = 0; i < branch_count; ++i)
+            {
+                if(!readUInt16LE(branch_id, fr) || !readUInt32LE(branch_offset, fr))
+                    break;
+                if(branch_id < 128)
+                    branch[branch_id] = branch_offset;
+            }
+        }
+        else if(std::memcmp(chunkBuf, "EVNT", 4) == 0)
+        {
+            evnt_begin = pos + 8;
+            evnt_end = evnt_begin + len;
+            break;
+        }
+    }
+
+    if(evnt_begin == evnt_end)
+    {
+        m_errorString.set("XMI: Empty track data");
+        return false;
+    }
+
+    // Order branch points by their offsets to meet them while reading
+    for(i = 0; i < 128; ++i)
+    {
+        if(branch[i] == ~0u)
+            continue;
+
+        for(j = branches++; j > 0 && branch[branch_order[j - 1]] > branch[i]; --j)
+            branch_order[j] = branch_order[j - 1];
+
+        branch_order[j] = static_cast<uint8_t>(i);
+    }
+
+    buildSmfSetupReset(1);
+
+    // Note-On takes at least four bytes and gives two events
+    m_eventBank.reserve((evnt_end - evnt_begin) / 2);
+    m_dataBank.reserve(1000);
+
+    // Every song is the separated single-track sequence
+    m_smfFormat = m_rawSongsData.size > 1 ? 2 : 0;
+
+    std::memset(&ps.evtPos, 0, sizeof(MidiTrackRow));
+    std::memset(&ps.status, 0, sizeof(TrackParseStatus));
+    std::memset(&ps.loopState, 0, sizeof(LoopPointParseState));
+    std::memset(ps.noteStates, 0, sizeof(ps.noteStates));
+    ps.abs_position = 0;
+    ps.rowFlush = true; // The song begin hook always has own row
+    ps.noteOffs.reserve(64);
+    ps.noteOffsSerial = 0;
+
+    m_trackState[0].state.track_channel = 0xFF;
+
+    // HACK: Begin every track with "Reset all controllers" event to avoid controllers state break came from end of song
+    std::memset(&event, 0, sizeof(event));
+    event.isValid = 1;
+    event.type = MidiEvent::T_SPECIAL;
+    event.subtype = MidiEvent::ST_SONG_BEGIN_HOOK;
+    addEventToBank(ps.evtPos, event);
+
+    fr.seek(evnt_begin, FileAndMemReader::SET);
+
+    while(!gotEnd && fr.tell() < evnt_end)
+    {
+        // Branch points are marked by their byte offsets
+        branch_offset = static_cast<uint32_t>(fr.tell() - evnt_begin);
+        while(branch_next < branches && branch[branch_order[branch_next]] < branch_offset)
+            ++branch_next; // Points to the middle of events are never met
+
+        for(; branch_next < branches && branch[branch_order[branch_next]] == branch_offset; ++branch_next)
+        {
+            i = branch_order[branch_next];
+            const char hex[] = "0123456789ABCDEF";
+            char marker[8] = {':', 'X', 'B', 'R', 'N', ':', hex[i >> 4], hex[i & 15]};
+
+            std::memset(&event, 0, sizeof(event));
+            event.isValid = 1;
+            event.type = MidiEvent::T_SPECIAL;
+            event.subtype = MidiEvent::ST_MARKER;
+            insertDataToBankWithTerm(event, m_dataBank, reinterpret_cast<const uint8_t*>(marker), sizeof(marker));
+            xmi_flushNoteOffs(ps, time);
+            xmi_addEvent(ps, time, event);
+        }
 
-    return ret;
+        // Delay is a sum of bytes until the status byte
+        for(byte = fr.getc(); byte >= 0 && byte < 0x80 && fr.tell() <= evnt_end; byte = fr.getc())
+            time += static_cast<uint64_t>(byte) * BWMIDI_XMI_TICK_MULT;
+
+        if(byte < 0 || fr.tell() > evnt_end)
+            break; // No more events
+
+        if(!xmi_parseEvent(fr, evnt_end, static_cast<uint8_t>(byte), ps, event, duration))
+            return false; // Error value already written
+
+        if(event.type == MidiEvent::T_SPECIAL && event.subtype == MidiEvent::ST_TEMPOCHANGE)
+        {
+            if(tempo > 0)
+                continue; // The tick length is fixed, ignore any other tempo changes
+
+            tempo = static_cast<uint32_t>(readBEint(event.data_loc, event.data_loc_size));
+            division = static_cast<size_t>(tempo) * 9 / 25000;
+            if(division == 0)
+            {
+                m_errorString.set("XMI: Invalid tempo value!\n");
+                return false;
+            }
+        }
+
+        xmi_flushNoteOffs(ps, time);
+        xmi_addEvent(ps, time, event);
+
+        if(event.type == MidiEvent::T_SPECIAL && event.subtype == MidiEvent::ST_ENDTRACK)
+        {
+            gotEnd = true;
+#ifdef ENABLE_END_SILENCE_SKIPPING
+            //Have track end on its own row? Clear any delay on the row before
+            if((ps.evtPos.events_end - ps.evtPos.events_begin) == 1 && !m_trackData[0].empty())
+            {
+                MidiTrackRow &previous = m_trackData[0].m_last->data;
+                previous.delay = 0;
+                previous.timeDelay = 0;
+            }
+#endif
+        }
+        else if((byte & 0xF0) == 0x90)
+        {
+            // Note-On gets released once its duration passes
+            if(ps.noteOffs.size >= ps.noteOffs.capacity)
+                ps.noteOffs.reserve(ps.noteOffs.capacity * 2);
+
+            noteOff.expire = time + duration * BWMIDI_XMI_TICK_MULT;
+            noteOff.serial = ps.noteOffsSerial++;
+            noteOff.channel = event.channel;
+            noteOff.note = event.data_loc[0];
+            noteOff.velocity = 0;
+            duratedNoteHeapPush(ps.noteOffs, noteOff);
+        }
+    }
+
+    // Notes still playing after the End of Track are never released by the song
+    if(!gotEnd)
+        xmi_flushNoteOffs(ps, ~static_cast<uint64_t>(0));
+
+    ps.evtPos.delay = 0;
+    sortEvents(ps.evtPos, m_eventBank, ps.noteStates);
+    smf_flushRow(ps.evtPos, ps.abs_position, 0, ps.loopState, true);
+
+    if(ps.loopState.ticksSongLength < ps.abs_position)
+        ps.loopState.ticksSongLength = ps.abs_position;
+
+    // Set the chain of events begin
+    initTracksBegin(0);
+
+    m_invDeltaTicks.nom = 1;
+    m_invDeltaTicks.denom = 1000000l * division;
+    m_tempo.nom = 1;
+    m_tempo.denom = division * 2;
+
+    installLoop(ps.loopState);
+    buildTimeLine(ps.temposList, ps.loopState.loopStartTicks, ps.loopState.loopEndTicks);
+
+    m_loop.stackLevel   = -1;
+
+    return true;
+}
+
+bool BW_MidiSequencer::xmi_parseEvent(FileAndMemReader &fr, const size_t end, uint8_t byte, XMIParseState &ps, MidiEvent &event, uint64_t &duration)
+{
+    size_t locSize;
+    bool ok = false;
+
+    duration = 0;
+
+    if(byte >= 0xF0)
+    {
+        // Meta and SysEx events are the same as SMF ones
+        fr.seek(-1, FileAndMemReader::CUR);
+        event = smf_parseEvent(fr, end, ps.status);
+        if(!event.isValid)
+        {
+            m_errorString.set("XMI: Failed to parse the event!\n");
+            m_errorString.append(m_parsingErrorsString.c_str());
+            return false;
+        }
+
+        return true;
+    }
+
+    std::memset(&event, 0, sizeof(event));
+    event.isValid = 1;
+    event.type = (byte >> 4) & 0x0F;
+    event.channel = byte & 0x0F;
+    locSize = s_xmi_evtSize[event.type];
+
+    if(fr.tell() + locSize > end || fr.read(event.data_loc, 1, locSize) != locSize)
+    {
+        m_errorString.setFmt("XMI: Can't read regular %u-byte event - Unexpected end of track data.\n", (unsigned)locSize);
+        return false;
+    }
+
+    event.data_loc_size = static_cast<uint8_t>(locSize);
+    // Keep damaged data bytes in range
+    event.data_loc[0] &= 0x7F;
+    event.data_loc[1] &= 0x7F;
+
+    switch(event.type)
+    {
+    case MidiEvent::T_NOTEON:
+        duration = readVarLenEx(fr, end, ok);
+        if(!ok)
+        {
+            m_errorString.set("XMI: Can't read the note duration - Unexpected end of track data.\n");
+            return false;
+        }
+
+        if(event.data_loc[1] == 0)
+            event.type = MidiEvent::T_NOTEOFF; // Note ON with zero velocity is Note OFF!
+        break;
+
+    case MidiEvent::T_CTRLCHANGE:
+        switch(event.data_loc[0])
+        {
+        case 0:  // Bank select, 127 is the default bank of MT-32
+            if(event.data_loc[1] == 127)
+                event.data_loc[1] = 0;
+            break;
+
+        case 114: // XMI's bank select
+            if(event.channel != 9)
+                event.data_loc[0] = 32;
+            break;
+
+        case 116:  // For Loop Controller
+            event.type = MidiEvent::T_SPECIAL;
+            event.subtype = MidiEvent::ST_LOOPSTACK_BEGIN;
+            event.data_loc[0] = event.data_loc[1];
+            event.data_loc_size = 1;
+
+            if(m_interface->onDebugMessage)
+            {
+                m_interface->onDebugMessage(
+                    m_interface->onDebugMessage_userData,
+                    "Stack XMI Loop Start at %d to %d level with %d loops",
+                    m_loop.stackLevel,
+                    m_loop.stackLevel + 1,
+                    event.data_loc[0]
+                );
+            }
+            break;
+
+        case 117:  // Next/Break Loop Controller
+            event.type = MidiEvent::T_SPECIAL;
+            event.subtype = event.data_loc[1] < 64 ?
+                        MidiEvent::ST_LOOPSTACK_BREAK :
+                        MidiEvent::ST_LOOPSTACK_END;
+            event.data_loc_size = 0;
+
+            if(m_interface->onDebugMessage)
+            {
+                m_interface->onDebugMessage(
+                    m_interface->onDebugMessage_userData,
+                    "Stack XMI Loop %s at %d to %d level",
+                    (event.subtype == MidiEvent::ST_LOOPSTACK_END ? "End" : "Break"),
+                    m_loop.stackLevel,
+                    m_loop.stackLevel - 1
+                );
+            }
+            break;
+
+        case 119:  // Callback Trigger
+            event.type = MidiEvent::T_SPECIAL;
+            event.subtype = MidiEvent::ST_CALLBACK_TRIGGER;
+            event.data_loc[0] = event.data_loc[1];
+            event.data_loc_size = 1;
+            break;
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    return true;
+}
+
+void BW_MidiSequencer::xmi_addEvent(XMIParseState &ps, uint64_t time, const MidiEvent &event)
+{
+    if(ps.rowFlush || time > ps.abs_position)
+    {
+        ps.evtPos.delay = time - ps.abs_position;
+        sortEvents(ps.evtPos, m_eventBank, ps.noteStates);
+        smf_flushRow(ps.evtPos, ps.abs_position, 0, ps.loopState);
+        ps.rowFlush = false;
+    }
+
+    addEventToBank(ps.evtPos, event);
+
+    if(event.type == MidiEvent::T_SPECIAL)
+    {
+        if(event.subtype == MidiEvent::ST_TEMPOCHANGE)
+        {
+            TempoEvent t = {readBEint(event.data_loc, event.data_loc_size), ps.abs_position};
+            ps.temposList.push_back(t);
+        }
+        else
+            analyseLoopEvent(ps.loopState, event, ps.abs_position, &m_trackState[0].loop);
+    }
+
+    // Loop points must finish the row
+    if(ps.loopState.gotLoopEventsInThisRow > 0)
+        ps.rowFlush = true;
+}
+
+void BW_MidiSequencer::xmi_flushNoteOffs(XMIParseState &ps, uint64_t time)
+{
+    MidiEvent event;
+
+    std::memset(&event, 0, sizeof(event));
+    event.isValid = 1;
+    event.type = MidiEvent::T_NOTEOFF;
+    event.data_loc_size = 2;
+
+    while(ps.noteOffs.size > 0 && ps.noteOffs.data[0].expire <= time)
+    {
+        const DuratedNote &n = ps.noteOffs.data[0];
+        uint64_t expire = n.expire;
+        event.channel = n.channel;
+        event.data_loc[0] = n.note;
+        duratedNoteHeapPop(ps.noteOffs);
+        xmi_addEvent(ps, expire, event);
+    }
 }
 #endif /* BWMIDI_DISABLE_XMI_SUPPORT */
 
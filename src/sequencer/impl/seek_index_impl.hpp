@@ -0,0 +1,447 @@
+
+/*
+ * BW_Midi_Sequencer - MIDI Sequencer for C++
+ *
+ * Copyright (c) 2015-2026 Vitaly Novichkov <admin@wohlnet.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+#ifndef BW_MIDISEQ_SEEK_INDEX_IMPL_HPP
+#define BW_MIDISEQ_SEEK_INDEX_IMPL_HPP
+
+#include <cstring>
+#include <cstdlib>
+
+#include "../midi_sequencer.hpp"
+
+/*
+ * The seek index keeps checkpoints of the seek process: the track positions and
+ * the compacted list of the state messages (controllers, patches, pitch bends, etc.)
+ * sent since the begin of the song. A message is dropped from the list once a later
+ * one of the same kind overrides it, the rest keep their order.
+ */
+
+//! Don't keep checkpoints closer than this, in seconds
+#define BWMIDI_SEEK_INDEX_MIN_STEP  5.0
+//! Maximum count of checkpoints per song
+#define BWMIDI_SEEK_INDEX_MAX_POINTS 256
+
+// Layout of the supersedable message keys
+#define BWMIDI_SEEK_KEY_CC          0
+#define BWMIDI_SEEK_KEY_NOTETOUCH   128
+#define BWMIDI_SEEK_KEY_PATCH       256
+#define BWMIDI_SEEK_KEY_WHEEL       257
+#define BWMIDI_SEEK_KEY_CHANATT     258
+#define BWMIDI_SEEK_KEYS_PER_CHAN   259
+#define BWMIDI_SEEK_KEY_RAWOPL      (16 * BWMIDI_SEEK_KEYS_PER_CHAN)
+#define BWMIDI_SEEK_KEYS_TOTAL      (BWMIDI_SEEK_KEY_RAWOPL + 256)
+
+void BW_MidiSequencer::seekIndexClear()
+{
+    m_seekIndexReady = false;
+    m_seekCheckpoints.clear();
+    m_seekTrackPoints.clear();
+    m_seekEvents.clear();
+    m_seekLog.clear();
+}
+
+size_t BW_MidiSequencer::seekEventKey(const SeekStateEvent &e)
+{
+    const size_t none = ~static_cast<size_t>(0);
+    const size_t base = static_cast<size_t>(e.channel) * BWMIDI_SEEK_KEYS_PER_CHAN;
+
+    if(e.type == SEEK_EVT_RAWOPL)
+        return BWMIDI_SEEK_KEY_RAWOPL + e.data[0];
+
+    if(e.channel >= 16)
+        return none;
+
+    switch(e.type)
+    {
+    case SEEK_EVT_CTRLCHANGE:
+        switch(e.data[0])
+        {
+        // Bank select and (N)RPN messages depend on the order
+        case 0: case 32:
+        case 6: case 38:
+        case 96: case 97: case 98: case 99: case 100: case 101:
+            return none;
+        default:
+            // Channel mode messages too
+            if(e.data[0] >= 120)
+                return none;
+            return base + BWMIDI_SEEK_KEY_CC + e.data[0];
+        }
+
+    case SEEK_EVT_NOTETOUCH:
+        return base + BWMIDI_SEEK_KEY_NOTETOUCH + (e.data[0] & 0x7F);
+
+    case SEEK_EVT_PATCHCHANGE:
+        return base + BWMIDI_SEEK_KEY_PATCH;
+
+    case SEEK_EVT_WHEEL:
+        return base + BWMIDI_SEEK_KEY_WHEEL;
+
+    case SEEK_EVT_CHANAFTTOUCH:
+        return base + BWMIDI_SEEK_KEY_CHANATT;
+
+    default:
+        return none;
+    }
+}
+
+void BW_MidiSequencer::seekLogPush(const SeekStateEvent &e, size_t key)
+{
+    if(key < BWMIDI_SEEK_KEYS_TOTAL)
+    {
+        size_t &last = m_seekLogKeys[key];
+        if(last != 0)
+            m_seekLog[last - 1].type = SEEK_EVT_NONE;
+        m_seekLog.push_back(e);
+        last = m_seekLog.size;
+    }
+    else
+        m_seekLog.push_back(e);
+}
+
+
+/**********************************************************************************
+ *                        Recorder of the state messages                          *
+ **********************************************************************************/
+
+void BW_MidiSequencer::seekEventInit(SeekStateEvent &e, uint8_t type, uint8_t channel,
+                                     uint8_t data0, uint8_t data1)
+{
+    e.type = type;
+    e.channel = channel;
+    e.data[0] = data0;
+    e.data[1] = data1;
+    e.block = NULL;
+    e.size = 0;
+    e.track = 0;
+}
+
+void BW_MidiSequencer::seekRecNoteOn(void *, uint8_t, uint8_t, uint8_t)
+{}
+
+void BW_MidiSequencer::seekRecNoteOff(void *, uint8_t, uint8_t)
+{}
+
+void BW_MidiSequencer::seekRecNoteAfterTouch(void *userdata, uint8_t channel, uint8_t note, uint8_t atVal)
+{
+    BW_MidiSequencer *self = reinterpret_cast<BW_MidiSequencer *>(userdata);
+    SeekStateEvent e;
+    seekEventInit(e, SEEK_EVT_NOTETOUCH, channel, note, atVal);
+    self->seekLogPush(e, seekEventKey(e));
+}
+
+void BW_MidiSequencer::seekRecChannelAfterTouch(void *userdata, uint8_t channel, uint8_t atVal)
+{
+    BW_MidiSequencer *self = reinterpret_cast<BW_MidiSequencer *>(userdata);
+    SeekStateEvent e;
+    seekEventInit(e, SEEK_EVT_CHANAFTTOUCH, channel, atVal, 0);
+    self->seekLogPush(e, seekEventKey(e));
+}
+
+void BW_MidiSequencer::seekRecControllerChange(void *userdata, uint8_t channel, uint8_t type, uint8_t value)
+{
+    BW_MidiSequencer *self = reinterpret_cast<BW_MidiSequencer *>(userdata);
+    SeekStateEvent e;
+
+    // All-sounds-off and all-notes-off leave nothing behind: the rewind stops the notes anyway
+    if(type == 120 || type == 123)
+        return;
+
+    seekEventInit(e, SEEK_EVT_CTRLCHANGE, channel, type, value);
+    self->seekLogPush(e, seekEventKey(e));
+}
+
+void BW_MidiSequencer::seekRecPatchChange(void *userdata, uint8_t channel, uint8_t patch)
+{
+    BW_MidiSequencer *self = reinterpret_cast<BW_MidiSequencer *>(userdata);
+    SeekStateEvent e;
+    seekEventInit(e, SEEK_EVT_PATCHCHANGE, channel, patch, 0);
+    self->seekLogPush(e, seekEventKey(e));
+}
+
+void BW_MidiSequencer::seekRecPitchBend(void *userdata, uint8_t channel, uint8_t msb, uint8_t lsb)
+{
+    BW_MidiSequencer *self = reinterpret_cast<BW_MidiSequencer *>(userdata);
+    SeekStateEvent e;
+    seekEventInit(e, SEEK_EVT_WHEEL, channel, msb, lsb);
+    self->seekLogPush(e, seekEventKey(e));
+}
+
+void BW_MidiSequencer::seekRecSysEx(void *userdata, const uint8_t *msg, size_t size)
+{
+    BW_MidiSequencer *self = reinterpret_cast<BW_MidiSequencer *>(userdata);
+    SeekStateEvent e;
+    seekEventInit(e, SEEK_EVT_SYSEX, 0, 0, 0);
+    e.block = msg;
+    e.size = size;
+    self->seekLogPush(e, seekEventKey(e));
+}
+
+void BW_MidiSequencer::seekRecDeviceSwitch(void *userdata, size_t track, const char *data, size_t length)
+{
+    BW_MidiSequencer *self = reinterpret_cast<BW_MidiSequencer *>(userdata);
+    const BW_MidiRtInterface *u = self->m_seekUserInterface;
+    SeekStateEvent e;
+
+    // The device of the track decides the channels of next events, so let the user know
+    u->rt_deviceSwitch(u->rtUserData, track, data, length);
+
+    seekEventInit(e, SEEK_EVT_DEVICESWITCH, 0, 0, 0);
+    e.block = reinterpret_cast<const uint8_t *>(data);
+    e.size = length;
+    e.track = track;
+    self->seekLogPush(e, seekEventKey(e));
+}
+
+size_t BW_MidiSequencer::seekRecCurrentDevice(void *userdata, size_t track)
+{
+    BW_MidiSequencer *self = reinterpret_cast<BW_MidiSequencer *>(userdata);
+    const BW_MidiRtInterface *u = self->m_seekUserInterface;
+    return u->rt_currentDevice(u->rtUserData, track);
+}
+
+void BW_MidiSequencer::seekRecRawOPL(void *userdata, uint8_t reg, uint8_t value)
+{
+    BW_MidiSequencer *self = reinterpret_cast<BW_MidiSequencer *>(userdata);
+    SeekStateEvent e;
+    seekEventInit(e, SEEK_EVT_RAWOPL, 0, reg, value);
+    self->seekLogPush(e, seekEventKey(e));
+}
+
+
+/**********************************************************************************
+ *                          Building and using the index                          *
+ **********************************************************************************/
+
+void BW_MidiSequencer::seekIndexAddCheckpoint()
+{
+    SeekCheckpoint cp;
+    SeekTrackPoint tp;
+    size_t count = 0;
+
+    cp.wait = m_currentPosition.wait;
+    cp.absTickPosition = m_currentPosition.absTickPosition;
+    cp.began = m_currentPosition.began;
+    cp.tempo = m_tempo;
+    cp.stateRestoreSetup = m_stateRestoreSetup;
+    cp.timelineCursor = m_currentPosition.timelineCursor;
+
+    cp.tracksBegin = m_seekTrackPoints.size;
+    for(size_t tk = 0; tk < m_currentPosition.track_size; ++tk)
+    {
+        const Position::TrackInfo &t = m_currentPosition.track[tk];
+        tp.pos = t.pos;
+        tp.delay = t.delay;
+        tp.lastHandledEvent = t.lastHandledEvent;
+        m_seekTrackPoints.push_back(tp);
+    }
+
+    // Compact the log, so the next checkpoints will copy only the alive messages
+    for(size_t i = 0; i < m_seekLog.size; ++i)
+    {
+        if(m_seekLog[i].type == SEEK_EVT_NONE)
+            continue;
+
+        m_seekLog[count] = m_seekLog[i];
+
+        size_t key = seekEventKey(m_seekLog[count]);
+        if(key < BWMIDI_SEEK_KEYS_TOTAL)
+            m_seekLogKeys[key] = count + 1;
+
+        ++count;
+    }
+    m_seekLog.size = count;
+
+    cp.eventsBegin = m_seekEvents.size;
+    cp.eventsCount = count;
+    if(count > 0)
+        m_seekEvents.push_back_list(m_seekLog.data, count);
+
+    m_seekCheckpoints.push_back(cp);
+}
+
+void BW_MidiSequencer::seekIndexBuild()
+{
+    seekIndexClear();
+
+    if(m_currentPosition.track_size == 0 || m_fullSongTimeLength <= 0.0)
+    {
+        m_seekIndexReady = true;
+        return;
+    }
+
+    m_seekLogKeys = reinterpret_cast<size_t *>(std::calloc(BWMIDI_SEEK_KEYS_TOTAL, sizeof(size_t)));
+    if(!m_seekLogKeys)
+        return; // Seek without the index
+
+    // Catch the messages instead of the user, and mute all other hooks
+    m_seekRecorder = *m_interface;
+    m_seekRecorder.rtUserData = this;
+    m_seekRecorder.onEvent = NULL;
+    m_seekRecorder.onDebugMessage = NULL;
+    m_seekRecorder.onloopStart = NULL;
+    m_seekRecorder.onloopEnd = NULL;
+    m_seekRecorder.onSongStart = NULL;
+    m_seekRecorder.rt_noteOn = seekRecNoteOn;
+    m_seekRecorder.rt_noteOff = seekRecNoteOff;
+    m_seekRecorder.rt_noteOffVel = NULL;
+    m_seekRecorder.rt_noteAfterTouch = seekRecNoteAfterTouch;
+    m_seekRecorder.rt_channelAfterTouch = seekRecChannelAfterTouch;
+    m_seekRecorder.rt_controllerChange = seekRecControllerChange;
+    m_seekRecorder.rt_patchChange = seekRecPatchChange;
+    m_seekRecorder.rt_pitchBend = seekRecPitchBend;
+    m_seekRecorder.rt_systemExclusive = seekRecSysEx;
+    m_seekRecorder.rt_metaEvent = NULL;
+    m_seekRecorder.rt_deviceSwitch = m_interface->rt_deviceSwitch ? seekRecDeviceSwitch : NULL;
+    m_seekRecorder.rt_currentDevice = m_interface->rt_currentDevice ? seekRecCurrentDevice : NULL;
+    m_seekRecorder.rt_rawOPL = seekRecRawOPL;
+
+    m_seekUserInterface = m_interface;
+    m_interface = &m_seekRecorder;
+
+    TriggerHandler triggerHandler = m_triggerHandler;
+    const bool loopFlagState = m_loopEnabled;
+    const Tempo_t tempo = m_tempo;
+    const uint32_t stateRestoreSetup = m_stateRestoreSetup;
+
+    m_triggerHandler = NULL;
+    m_loopEnabled = false;
+
+    this->rewind();
+    m_loop.caughtStart = false;
+    // Forget the messages of the rewind itself, every seek sends them again
+    m_seekLog.clear();
+
+    double step = m_fullSongTimeLength / BWMIDI_SEEK_INDEX_MAX_POINTS;
+    if(step < BWMIDI_SEEK_INDEX_MIN_STEP)
+        step = BWMIDI_SEEK_INDEX_MIN_STEP;
+    double nextPoint = step;
+
+    while(!m_atEnd)
+    {
+        if(m_currentPosition.wait >= nextPoint)
+        {
+            seekIndexAddCheckpoint();
+            while(nextPoint <= m_currentPosition.wait)
+                nextPoint += step;
+        }
+
+        if(!processEvents(true))
+            break;
+    }
+
+    // Leave the song at the begin, the recorder catches the messages of it
+    this->rewind();
+
+    m_interface = m_seekUserInterface;
+    m_seekUserInterface = NULL;
+    m_triggerHandler = triggerHandler;
+    m_loopEnabled = loopFlagState;
+    m_tempo = tempo;
+    m_stateRestoreSetup = stateRestoreSetup;
+
+    std::free(m_seekLogKeys);
+    m_seekLogKeys = NULL;
+    m_seekLog.clear();
+
+    m_seekIndexReady = true;
+}
+
+void BW_MidiSequencer::seekRestoreCheckpoint(double seconds)
+{
+    size_t lo = 0, hi = m_seekCheckpoints.size;
+
+    // The latest checkpoint the seek would pass
+    while(lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if(m_seekCheckpoints[mid].wait <= seconds)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if(lo == 0)
+        return;
+
+    const SeekCheckpoint &cp = m_seekCheckpoints[lo - 1];
+    const SeekTrackPoint *tp = m_seekTrackPoints.data + cp.tracksBegin;
+    const SeekStateEvent *e = m_seekEvents.data + cp.eventsBegin;
+
+    for(size_t tk = 0; tk < m_currentPosition.track_size; ++tk)
+    {
+        Position::TrackInfo &t = m_currentPosition.track[tk];
+        t.pos = tp[tk].pos;
+        t.delay = tp[tk].delay;
+        t.lastHandledEvent = tp[tk].lastHandledEvent;
+    }
+
+    m_currentPosition.wait = cp.wait;
+    m_currentPosition.absTickPosition = cp.absTickPosition;
+    m_currentPosition.began = cp.began;
+    m_tempo = cp.tempo;
+    m_stateRestoreSetup = cp.stateRestoreSetup;
+    m_currentPosition.timelineCursor = cp.timelineCursor;
+
+    for(size_t i = 0; i < cp.eventsCount; ++i, ++e)
+    {
+        switch(e->type)
+        {
+        case SEEK_EVT_CTRLCHANGE:
+            m_interface->rt_controllerChange(m_interface->rtUserData, e->channel, e->data[0], e->data[1]);
+            break;
+        case SEEK_EVT_PATCHCHANGE:
+            m_interface->rt_patchChange(m_interface->rtUserData, e->channel, e->data[0]);
+            break;
+        case SEEK_EVT_WHEEL:
+            m_interface->rt_pitchBend(m_interface->rtUserData, e->channel, e->data[0], e->data[1]);
+            break;
+        case SEEK_EVT_CHANAFTTOUCH:
+            m_interface->rt_channelAfterTouch(m_interface->rtUserData, e->channel, e->data[0]);
+            break;
+        case SEEK_EVT_NOTETOUCH:
+            m_interface->rt_noteAfterTouch(m_interface->rtUserData, e->channel, e->data[0], e->data[1]);
+            break;
+        case SEEK_EVT_SYSEX:
+            if(m_interface->rt_systemExclusive)
+                m_interface->rt_systemExclusive(m_interface->rtUserData, e->block, e->size);
+            break;
+        case SEEK_EVT_RAWOPL:
+            if(m_interface->rt_rawOPL)
+                m_interface->rt_rawOPL(m_interface->rtUserData, e->data[0], e->data[1]);
+            break;
+        case SEEK_EVT_DEVICESWITCH:
+            if(m_interface->rt_deviceSwitch)
+                m_interface->rt_deviceSwitch(m_interface->rtUserData, e->track,
+                                             reinterpret_cast<const char *>(e->block), e->size);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+#endif /* BW_MIDISEQ_SEEK_INDEX_IMPL_HPP */
@@ -0,0 +1,676 @@
+/*
+ * BW_Midi_Sequencer - MIDI Sequencer for C++
+ *
+ * Copyright (c) 2015-2026 Vitaly Novichkov <admin@wohlnet.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+#ifndef BW_MIDISEQ_SONG_CACHE_IMPL_HPP
+#define BW_MIDISEQ_SONG_CACHE_IMPL_HPP
+
+#include <cstring>
+#include <assert.h>
+
+#include "../midi_sequencer.hpp"
+
+/*
+ * The song cache is the dump of everything the parse and the timeline build make:
+ * data and event banks, rows of all tracks, loop points, branches, markers, etc.
+ * Numbers are stored in the native layout, so the blob can be loaded back only by
+ * the build of the same version and platform: the header refuses anything else.
+ * Row pointers of remembered positions are stored as indices of rows in their tracks.
+ * What the playback changes (tempo, loop states, states of tracks) is stored as the
+ * load has left it, so the blob is the same whenever it's made.
+ */
+
+//! Signature of the song cache blob
+#define BWMIDI_SONG_CACHE_MAGIC     "BWMIDISC"
+//! Version of the song cache layout, increase on any change of the stored data
+#define BWMIDI_SONG_CACHE_VERSION   3
+//! Index of the row for the NULL row pointer
+#define BWMIDI_SONG_CACHE_NO_ROW    (~(uint64_t)0)
+//! Count of the MIDI channels which the events may target
+#define BWMIDI_SONG_CACHE_CHANNELS  16
+
+void BW_MidiSequencer::songCacheLayout(SongCacheLayout &l)
+{
+    std::memset(&l, 0, sizeof(l));
+    l.endianMark = 0x01020304;
+    l.sizeofSizeT = static_cast<uint8_t>(sizeof(size_t));
+    l.sizeofDouble = static_cast<uint8_t>(sizeof(double));
+    l.sizeofEvent = static_cast<uint8_t>(sizeof(MidiEvent));
+    l.sizeofRow = static_cast<uint8_t>(sizeof(MidiTrackRow));
+    l.sizeofTrackState = static_cast<uint32_t>(sizeof(TrackStateSaved));
+}
+
+
+void BW_MidiSequencer::SongCacheWriter::put(const void *data, size_t len)
+{
+    if(dst && len > 0 && pos + len <= size)
+        std::memcpy(dst + pos, data, len);
+    pos += len;
+}
+
+void BW_MidiSequencer::SongCacheWriter::putSize(uint64_t value)
+{
+    put(&value, sizeof(value));
+}
+
+bool BW_MidiSequencer::SongCacheReader::get(void *data, size_t len)
+{
+    if(len > size - pos)
+        return false;
+    if(len > 0)
+        std::memcpy(data, src + pos, len);
+    pos += len;
+    return true;
+}
+
+bool BW_MidiSequencer::SongCacheReader::getSize(size_t &value, size_t elementSize)
+{
+    uint64_t v;
+
+    if(!get(&v, sizeof(v)))
+        return false;
+
+    // Don't trust counts which can't fit the rest of the blob
+    if(elementSize > 0 && v > (size - pos) / elementSize)
+        return false;
+
+    value = static_cast<size_t>(v);
+    return true;
+}
+
+
+void BW_MidiSequencer::songCacheWriteLoop(SongCacheWriter &w, const LoopState &loop)
+{
+    w.put(&loop.caughtStart, sizeof(loop.caughtStart));
+    w.put(&loop.caughtEnd, sizeof(loop.caughtEnd));
+    w.put(&loop.caughtStackStart, sizeof(loop.caughtStackStart));
+    w.put(&loop.caughtStackEnd, sizeof(loop.caughtStackEnd));
+    w.put(&loop.caughtStackBreak, sizeof(loop.caughtStackBreak));
+    w.put(&loop.skipStackStart, sizeof(loop.skipStackStart));
+    w.put(&loop.dstLoopStackId, sizeof(loop.dstLoopStackId));
+    w.put(&loop.invalidLoop, sizeof(loop.invalidLoop));
+    w.put(&loop.temporaryBroken, sizeof(loop.temporaryBroken));
+    w.put(&loop.caughtBranchJump, sizeof(loop.caughtBranchJump));
+    w.put(&loop.dstBranchId, sizeof(loop.dstBranchId));
+    w.put(&loop.stackLevel, sizeof(loop.stackLevel));
+    w.putSize(loop.stackDepth);
+
+    // Start positions are captured during the playback only
+    for(size_t i = 0; i < loop.stackDepth; ++i)
+    {
+        const LoopStackEntry &e = loop.stack[i];
+        w.put(&e.infinity, sizeof(e.infinity));
+        w.put(&e.loops, sizeof(e.loops));
+        w.put(&e.start, sizeof(e.start));
+        w.put(&e.end, sizeof(e.end));
+        w.put(&e.id, sizeof(e.id));
+    }
+}
+
+bool BW_MidiSequencer::songCacheReadLoop(SongCacheReader &r, LoopState &loop)
+{
+    size_t depth;
+    bool ret = true;
+
+    ret &= r.get(&loop.caughtStart, sizeof(loop.caughtStart));
+    ret &= r.get(&loop.caughtEnd, sizeof(loop.caughtEnd));
+    ret &= r.get(&loop.caughtStackStart, sizeof(loop.caughtStackStart));
+    ret &= r.get(&loop.caughtStackEnd, sizeof(loop.caughtStackEnd));
+    ret &= r.get(&loop.caughtStackBreak, sizeof(loop.caughtStackBreak));
+    ret &= r.get(&loop.skipStackStart, sizeof(loop.skipStackStart));
+    ret &= r.get(&loop.dstLoopStackId, sizeof(loop.dstLoopStackId));
+    ret &= r.get(&loop.invalidLoop, sizeof(loop.invalidLoop));
+    ret &= r.get(&loop.temporaryBroken, sizeof(loop.temporaryBroken));
+    ret &= r.get(&loop.caughtBranchJump, sizeof(loop.caughtBranchJump));
+    ret &= r.get(&loop.dstBranchId, sizeof(loop.dstBranchId));
+    ret &= r.get(&loop.stackLevel, sizeof(loop.stackLevel));
+
+    if(!ret || !r.getSize(depth, 0) || depth > LoopState::stackDepthMax)
+        return false;
+
+    loop.stackDepth = depth;
+
+    for(size_t i = 0; i < depth; ++i)
+    {
+        LoopStackEntry &e = loop.stack[i];
+        ret &= r.get(&e.infinity, sizeof(e.infinity));
+        ret &= r.get(&e.loops, sizeof(e.loops));
+        ret &= r.get(&e.start, sizeof(e.start));
+        ret &= r.get(&e.end, sizeof(e.end));
+        ret &= r.get(&e.id, sizeof(e.id));
+    }
+
+    return ret;
+}
+
+void BW_MidiSequencer::songCacheKeepLoaded()
+{
+    SongCacheWriter w;
+
+    m_loadedTempo = m_tempo;
+    m_loadedLoopBeginPosition = m_loopBeginPosition;
+
+    w.dst = NULL;
+    w.size = 0;
+    w.pos = 0;
+
+    // First pass counts the size only
+    for(int pass = 0; pass < 2; ++pass)
+    {
+        if(pass == 1)
+        {
+            m_loadedLoops.resize(w.pos);
+            w.dst = m_loadedLoops.data;
+            w.size = w.pos;
+            w.pos = 0;
+        }
+
+        songCacheWriteLoop(w, m_loop);
+        for(size_t tk = 0; tk < m_tracksCount; ++tk)
+            songCacheWriteLoop(w, m_trackState[tk].loop);
+    }
+}
+
+bool BW_MidiSequencer::songCacheTextValid(const DataBlock &b, bool optional) const
+{
+    if(b.size == 0)
+        return optional;
+
+    // Texts are read up to the terminator, it must be the last byte of the block
+    return b.offset < m_dataBank.size && b.size <= m_dataBank.size - b.offset &&
+           m_dataBank.data[b.offset + b.size - 1] == 0;
+}
+
+uint64_t BW_MidiSequencer::songCacheRowIndex(const SongCacheRows &rows, size_t track, const MidiTrackQueue::Leaf_t *row)
+{
+    size_t lo, hi, mid;
+
+    if(!row)
+        return BWMIDI_SONG_CACHE_NO_ROW;
+
+    // Rows of the track are sorted by the tick: find the first one at the tick of given row
+    lo = rows.trackBegin[track];
+    hi = rows.trackBegin[track + 1];
+
+    while(lo < hi)
+    {
+        mid = lo + (hi - lo) / 2;
+        if(rows.rows[mid]->data.absPos < row->data.absPos)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    for(; lo < rows.trackBegin[track + 1]; ++lo)
+    {
+        if(rows.rows[lo] == row)
+            return lo - rows.trackBegin[track];
+    }
+
+    assert(false); // The row must belong to the track!
+    return BWMIDI_SONG_CACHE_NO_ROW;
+}
+
+void BW_MidiSequencer::songCacheWritePosition(SongCacheWriter &w, const SongCacheRows &rows, const Position &pos, uint32_t owner)
+{
+    uint64_t index = 0;
+
+    w.put(&pos.wait, sizeof(pos.wait));
+    w.put(&pos.absTimePosition, sizeof(pos.absTimePosition));
+    w.put(&pos.absTickPosition, sizeof(pos.absTickPosition));
+    w.put(&pos.began, sizeof(pos.began));
+    w.putSize(pos.timelineCursor);
+    w.putSize(pos.track_size);
+
+    for(size_t i = 0; i < pos.track_size; ++i)
+    {
+        const Position::TrackInfo &t = pos.track[i];
+        index = songCacheRowIndex(rows, owner == BRANCH_GLOBAL_TRACK ? i : owner, t.pos);
+        w.putSize(index);
+        w.put(&t.delay, sizeof(t.delay));
+        w.put(&t.lastHandledEvent, sizeof(t.lastHandledEvent));
+        w.put(&pos.state[i], sizeof(TrackStateSaved));
+    }
+}
+
+bool BW_MidiSequencer::songCacheReadPosition(SongCacheReader &r, const SongCacheRows &rows, Position &pos, uint32_t owner)
+{
+    size_t count, tk, first, last;
+    uint64_t index = 0;
+    bool ret = true;
+
+    ret &= r.get(&pos.wait, sizeof(pos.wait));
+    ret &= r.get(&pos.absTimePosition, sizeof(pos.absTimePosition));
+    ret &= r.get(&pos.absTickPosition, sizeof(pos.absTickPosition));
+    ret &= r.get(&pos.began, sizeof(pos.began));
+    ret &= r.getSize(pos.timelineCursor, 0);
+
+    if(!ret || !r.getSize(count, sizeof(uint64_t)))
+        return false;
+
+    if(owner == BRANCH_GLOBAL_TRACK ? count > m_tracksCount : (owner >= m_tracksCount || count > 1))
+        return false;
+
+    pos.tracks_resize(count);
+
+    for(size_t i = 0; i < count; ++i)
+    {
+        Position::TrackInfo &t = pos.track[i];
+        tk = owner == BRANCH_GLOBAL_TRACK ? i : owner;
+        first = rows.trackBegin[tk];
+        last = rows.trackBegin[tk + 1];
+
+        ret &= r.get(&index, sizeof(index));
+        ret &= r.get(&t.delay, sizeof(t.delay));
+        ret &= r.get(&t.lastHandledEvent, sizeof(t.lastHandledEvent));
+        ret &= r.get(&pos.state[i], sizeof(TrackStateSaved));
+
+        if(!ret)
+            return false;
+
+        if(index == BWMIDI_SONG_CACHE_NO_ROW)
+            t.pos = NULL;
+        else if(index < last - first)
+            t.pos = rows.rows[first + static_cast<size_t>(index)];
+        else
+            return false;
+    }
+
+    return true;
+}
+
+void BW_MidiSequencer::songCacheListRows(SongCacheRows &rows)
+{
+    size_t count = 0;
+
+    for(size_t tk = 0; tk < m_tracksCount; ++tk)
+        count += m_trackData[tk].size();
+
+    rows.rows.clear();
+    rows.rows.reserve(count + 1);
+    rows.trackBegin.clear();
+    rows.trackBegin.reserve(m_tracksCount + 2);
+
+    for(size_t tk = 0; tk < m_tracksCount; ++tk)
+    {
+        rows.trackBegin.push_back(rows.rows.size);
+        for(MidiTrackQueue::Leaf_t *it = m_trackData[tk].m_begin; it != NULL; it = it->next)
+            rows.rows.push_back(it);
+    }
+
+    rows.trackBegin.push_back(rows.rows.size);
+}
+
+
+size_t BW_MidiSequencer::saveSongCache(void *dst, size_t size)
+{
+    SongCacheLayout layout;
+    SongCacheWriter w;
+    SongCacheRows rows;
+    uint32_t u32;
+    int32_t i32 = 0;
+    uint64_t borrowedSize = 0;
+    double songLength = 0.0;
+    size_t tk, i;
+
+    if(m_tracksCount == 0)
+        return 0;
+
+    w.dst = NULL;
+    w.size = 0;
+    w.pos = 0;
+
+    songCacheListRows(rows);
+
+    for(i = 0; i < m_eventBank.size; ++i)
+    {
+        if(m_eventBank[i].data_block.offset & DATA_BLOCK_BORROWED)
+            borrowedSize += m_eventBank[i].data_block.size;
+    }
+
+    // First pass counts the size only, the second one writes if the buffer fits
+    for(int pass = 0; pass < 2; ++pass)
+    {
+        if(pass == 1)
+        {
+            if(!dst || w.pos > size)
+                break;
+            w.dst = reinterpret_cast<uint8_t *>(dst);
+            w.size = size;
+            w.pos = 0;
+        }
+
+        songCacheLayout(layout);
+        w.put(BWMIDI_SONG_CACHE_MAGIC, 8);
+        u32 = BWMIDI_SONG_CACHE_VERSION;
+        w.put(&u32, sizeof(u32));
+        w.put(&layout, sizeof(layout));
+
+        // Song properties
+        u32 = static_cast<uint32_t>(m_format);
+        w.put(&u32, sizeof(u32));
+        u32 = static_cast<uint32_t>(m_smfFormat);
+        w.put(&u32, sizeof(u32));
+        u32 = static_cast<uint32_t>(m_loopFormat);
+        w.put(&u32, sizeof(u32));
+        w.putSize(m_tracksCount);
+        w.put(&m_invDeltaTicks, sizeof(m_invDeltaTicks));
+        w.put(&m_loadedTempo, sizeof(m_loadedTempo));
+        w.put(&m_deviceMaskAvailable, sizeof(m_deviceMaskAvailable));
+        w.put(&m_stateRestoreSetup, sizeof(m_stateRestoreSetup));
+        songLength = m_fullSongTimeLength - m_postSongWaitDelay;
+        w.put(&songLength, sizeof(songLength));
+        w.put(&m_loopStartTime, sizeof(m_loopStartTime));
+        w.put(&m_loopEndTime, sizeof(m_loopEndTime));
+        w.put(&m_musTitle, sizeof(m_musTitle));
+        w.put(&m_musCopyright, sizeof(m_musCopyright));
+        i32 = static_cast<int32_t>(m_loadTrackNumber);
+        w.put(&i32, sizeof(i32));
+
+        // Loop states of the song, then of every track
+        w.put(m_loadedLoops.data, m_loadedLoops.size);
+
+        // Data bank, blocks of the borrowed memory get copied after it
+        w.putSize(m_dataBank.size + borrowedSize);
+        w.put(m_dataBank.data, m_dataBank.size);
+
+        for(i = 0; i < m_eventBank.size; ++i)
+        {
+            const DataBlock &b = m_eventBank[i].data_block;
+            if(b.offset & DATA_BLOCK_BORROWED)
+                w.put(getData(b), b.size);
+        }
+
+        // Events bank with offsets of borrowed blocks moved into the data bank
+        w.putSize(m_eventBank.size);
+        borrowedSize = 0;
+
+        for(i = 0; i < m_eventBank.size; ++i)
+        {
+            MidiEvent evt = m_eventBank[i];
+            if(evt.data_block.offset & DATA_BLOCK_BORROWED)
+            {
+                evt.data_block.offset = static_cast<uint32_t>(m_dataBank.size + borrowedSize);
+                borrowedSize += evt.data_block.size;
+            }
+            w.put(&evt, sizeof(MidiEvent));
+        }
+
+        // Tracks
+        for(tk = 0; tk < m_tracksCount; ++tk)
+        {
+            const MidiTrackState &st = m_trackState[tk];
+            w.put(&st.deviceMask, sizeof(st.deviceMask));
+            w.put(&st.disabled, sizeof(st.disabled));
+            w.put(&st.stateRestoreSetup, sizeof(st.stateRestoreSetup));
+            w.put(&m_trackBeginPosition.state[tk], sizeof(TrackStateSaved));
+
+            w.putSize(m_trackData[tk].size());
+            for(MidiTrackQueue::Leaf_t *it = m_trackData[tk].m_begin; it != NULL; it = it->next)
+                w.put(&it->data, sizeof(MidiTrackRow));
+        }
+
+        songCacheWritePosition(w, rows, m_trackBeginPosition, BRANCH_GLOBAL_TRACK);
+        songCacheWritePosition(w, rows, m_loadedLoopBeginPosition, BRANCH_GLOBAL_TRACK);
+
+        w.putSize(m_branches.size);
+        for(i = 0; i < m_branches.size; ++i)
+        {
+            const BranchEntry &b = m_branches[i];
+            w.put(&b.tick, sizeof(b.tick));
+            w.put(&b.track, sizeof(b.track));
+            w.put(&b.id, sizeof(b.id));
+            w.put(&b.init, sizeof(b.init));
+            songCacheWritePosition(w, rows, b.offset, b.track);
+        }
+
+        w.putSize(m_musTrackTitles.size);
+        w.put(m_musTrackTitles.data, m_musTrackTitles.size * sizeof(DataBlock));
+        w.putSize(m_musMarkers.size);
+        w.put(m_musMarkers.data, m_musMarkers.size * sizeof(MIDI_MarkerEntry));
+        w.putSize(m_cmfInstruments.size);
+        w.put(m_cmfInstruments.data, m_cmfInstruments.size * sizeof(CmfInstrument));
+
+        w.putSize(m_rawSongsData.size);
+        for(i = 0; i < m_rawSongsData.size; ++i)
+        {
+            w.putSize(m_rawSongsData[i].size);
+            w.put(m_rawSongsData[i].data, m_rawSongsData[i].size);
+        }
+    }
+
+    return w.pos;
+}
+
+bool BW_MidiSequencer::loadSongCache(const void *data, size_t size)
+{
+    SongCacheLayout layout, fileLayout;
+    SongCacheReader r;
+    SongCacheRows rows;
+    char magic[8];
+    uint32_t u32, format, smfFormat, loopFormat;
+    int32_t i32 = 0;
+    size_t count, tk, i;
+    double songLength = 0.0;
+    bool ret = true;
+
+    m_parsingErrorsString.clear();
+
+    assert(m_interface); // MIDI output interface must be defined!
+
+    r.src = reinterpret_cast<const uint8_t *>(data);
+    r.size = data ? size : 0;
+    r.pos = 0;
+
+    songCacheLayout(layout);
+
+    if(!r.get(magic, 8) || std::memcmp(magic, BWMIDI_SONG_CACHE_MAGIC, 8) != 0)
+    {
+        m_errorString.set("Invalid song cache signature!");
+        return false;
+    }
+
+    if(!r.get(&u32, sizeof(u32)) || u32 != BWMIDI_SONG_CACHE_VERSION ||
+       !r.get(&fileLayout, sizeof(fileLayout)) || std::memcmp(&layout, &fileLayout, sizeof(layout)) != 0)
+    {
+        m_errorString.set("Song cache was made by another version or platform!");
+        return false;
+    }
+
+    ret &= r.get(&format, sizeof(format));
+    ret &= r.get(&smfFormat, sizeof(smfFormat));
+    ret &= r.get(&loopFormat, sizeof(loopFormat));
+    ret &= r.getSize(count, 0);
+
+    if(!ret || count == 0 || count > r.size)
+    {
+        m_errorString.set("Song cache is damaged!");
+        return false;
+    }
+
+    m_atEnd            = false;
+    m_loop.fullReset();
+    m_borrowedData = NULL;
+    m_borrowedSize = 0;
+    m_cmfInstruments.clear();
+    m_rawSongsData.clear();
+
+    buildSmfSetupReset(count);
+
+    m_format = static_cast<FileFormat>(format);
+    m_smfFormat = smfFormat;
+    m_loopFormat = static_cast<LoopFormat>(loopFormat);
+
+    ret &= r.get(&m_invDeltaTicks, sizeof(m_invDeltaTicks));
+    ret &= r.get(&m_tempo, sizeof(m_tempo));
+    ret &= r.get(&m_deviceMaskAvailable, sizeof(m_deviceMaskAvailable));
+    ret &= r.get(&m_stateRestoreSetup, sizeof(m_stateRestoreSetup));
+    ret &= r.get(&songLength, sizeof(songLength));
+    ret &= r.get(&m_loopStartTime, sizeof(m_loopStartTime));
+    ret &= r.get(&m_loopEndTime, sizeof(m_loopEndTime));
+    ret &= r.get(&m_musTitle, sizeof(m_musTitle));
+    ret &= r.get(&m_musCopyright, sizeof(m_musCopyright));
+    ret &= r.get(&i32, sizeof(i32));
+    ret = ret && songCacheReadLoop(r, m_loop);
+
+    for(tk = 0; ret && tk < m_tracksCount; ++tk)
+        ret = songCacheReadLoop(r, m_trackState[tk].loop);
+
+    m_fullSongTimeLength = songLength + m_postSongWaitDelay;
+    m_loadTrackNumber = i32;
+
+    // Data bank
+    if(ret && (ret = r.getSize(count, 1)))
+    {
+        m_dataBank.resize(count);
+        ret = r.get(m_dataBank.data, count) &&
+              songCacheTextValid(m_musTitle, true) &&
+              songCacheTextValid(m_musCopyright, true);
+    }
+
+    // Events bank
+    if(ret && (ret = r.getSize(count, sizeof(MidiEvent))))
+    {
+        m_eventBank.resize(count);
+        ret = r.get(m_eventBank.data, count * sizeof(MidiEvent));
+
+        for(i = 0; ret && i < count; ++i)
+        {
+            const MidiEvent &evt = m_eventBank[i];
+            const DataBlock &b = evt.data_block;
+            if(evt.channel >= BWMIDI_SONG_CACHE_CHANNELS)
+                ret = false;
+            else if(b.size > 0 && (b.offset > m_dataBank.size || b.size > m_dataBank.size - b.offset))
+                ret = false;
+        }
+    }
+
+    // Tracks
+    for(tk = 0; ret && tk < m_tracksCount; ++tk)
+    {
+        MidiTrackState &st = m_trackState[tk];
+        MidiTrackQueue &track = m_trackData[tk];
+
+        ret &= r.get(&st.deviceMask, sizeof(st.deviceMask));
+        ret &= r.get(&st.disabled, sizeof(st.disabled));
+        ret &= r.get(&st.stateRestoreSetup, sizeof(st.stateRestoreSetup));
+        ret &= r.get(&st.state, sizeof(TrackStateSaved));
+        ret = ret && r.getSize(count, sizeof(MidiTrackRow));
+
+        for(i = 0; ret && i < count; ++i)
+        {
+            MidiTrackRow &row = track.make();
+            ret = r.get(&row, sizeof(MidiTrackRow)) &&
+                  row.events_begin <= row.events_end && row.events_end <= m_eventBank.size;
+        }
+    }
+
+    if(ret)
+    {
+        songCacheListRows(rows);
+        ret = songCacheReadPosition(r, rows, m_trackBeginPosition, BRANCH_GLOBAL_TRACK) &&
+              songCacheReadPosition(r, rows, m_loopBeginPosition, BRANCH_GLOBAL_TRACK);
+    }
+
+    // Branches
+    if(ret && (ret = r.getSize(count, sizeof(uint64_t))))
+    {
+        m_branches.resize(count);
+
+        for(i = 0; ret && i < count; ++i)
+        {
+            BranchEntry &b = m_branches[i];
+            ret &= r.get(&b.tick, sizeof(b.tick));
+            ret &= r.get(&b.track, sizeof(b.track));
+            ret &= r.get(&b.id, sizeof(b.id));
+            ret &= r.get(&b.init, sizeof(b.init));
+            ret = ret && songCacheReadPosition(r, rows, b.offset, b.track);
+        }
+    }
+
+    // Titles, markers, instruments
+    if(ret && (ret = r.getSize(count, sizeof(DataBlock))))
+    {
+        m_musTrackTitles.resize(count);
+        ret = r.get(m_musTrackTitles.data, count * sizeof(DataBlock));
+
+        for(i = 0; ret && i < count; ++i)
+            ret = songCacheTextValid(m_musTrackTitles[i], false);
+    }
+
+    if(ret && (ret = r.getSize(count, sizeof(MIDI_MarkerEntry))))
+    {
+        m_musMarkers.resize(count);
+        ret = r.get(m_musMarkers.data, count * sizeof(MIDI_MarkerEntry));
+
+        for(i = 0; ret && i < count; ++i)
+            ret = songCacheTextValid(m_musMarkers[i].label, false);
+    }
+
+    if(ret && (ret = r.getSize(count, sizeof(CmfInstrument))))
+    {
+        m_cmfInstruments.resize(count);
+        ret = r.get(m_cmfInstruments.data, count * sizeof(CmfInstrument));
+    }
+
+    if(ret && (ret = r.getSize(count, sizeof(uint64_t))))
+    {
+        m_rawSongsData.resize(count);
+
+        for(i = 0; ret && i < count; ++i)
+        {
+            RawSongEntry &song = m_rawSongsData[i];
+            size_t songSize;
+            ret = r.getSize(songSize, 1);
+            if(ret)
+            {
+                song.resize(songSize);
+                ret = r.get(song.data, songSize);
+            }
+        }
+    }
+
+    if(!ret)
+    {
+        // Leave no half-loaded song behind
+        buildSmfSetupReset(0);
+        m_cmfInstruments.clear();
+        m_rawSongsData.clear();
+        m_errorString.set("Song cache is damaged!");
+        return false;
+    }
+
+    // Same final state as buildTimeLine() leaves
+    m_currentPosition = m_trackBeginPosition;
+    m_loop.loopsCount = m_loopCount;
+    m_loop.loopsLeft = m_loopCount;
+
+    duratedNoteReserve();
+    buildFlatTimeline();
+    songCacheKeepLoaded();
+
+    return true;
+}
+
+#endif /* BW_MIDISEQ_SONG_CACHE_IMPL_HPP */
@@ -73,6 +73,11 @@ typedef size_t (*RtCurrentDevice)(void *userdata, size_t track);
 /*! [Non-Standard] Pass raw OPL3 data to the chip (when playing IMF files) */
 typedef void (*RtRawOPL)(void *userdata, uint8_t reg, uint8_t value);
 
+/*! One job of the batch */
+typedef void (*ParallelJob)(void *ctx, int index);
+/*! Run job(ctx, 0) ... job(ctx, count - 1) in parallel and return when all are done */
+typedef void (*RunParallelJobs)(void *userdata, ParallelJob job, void *ctx, int count);
+
 /**
   \brief Real-Time MIDI interface between Sequencer and the Synthesizer
  */
@@ -169,6 +174,15 @@ typedef struct BW_MidiRtInterface
     /*! [Non-Standard] Pass raw OPL3 data to the chip hook */
     RtRawOPL            rt_rawOPL;
 
+
+    /*****************************
+     * Optional loader's helpers *
+     *****************************/
+    /*! Runs the jobs on a pool of threads. When set, the tracks of multi-track MIDI files are decoded in parallel */
+    RunParallelJobs     runParallelJobs;
+    /*! User data which will be passed through the jobs runner */
+    void                *runParallelJobs_userData;
+
 } BW_MidiRtInterface;
 
 #ifdef __cplusplus
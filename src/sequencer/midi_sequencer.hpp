@@ -47,14 +47,17 @@ public:
      **********************************************************************************/
 
     /*!
-     * \brief Reference to the data bank entry
+     * \brief Reference to the data bank entry (32-bit, it's a part of every MIDI event)
      */
     struct DataBlock
     {
-        size_t offset;
-        size_t size;
+        uint32_t offset;
+        uint32_t size;
     };
 
+    //! Flag of the data block offset: the block is in the borrowed memory instead of the data bank
+    static const uint32_t DATA_BLOCK_BORROWED = 0x80000000;
+
     /**
      * @brief MIDI marker entry
      */
@@ -116,9 +119,24 @@ public:
      */
     inline const uint8_t *getData(const DataBlock &b) const
     {
+        if(b.offset & DATA_BLOCK_BORROWED)
+            return m_borrowedData + (b.offset & ~DATA_BLOCK_BORROWED);
         return m_dataBank.data + b.offset;
     };
 
+    /*!
+     * \brief Get the data pointer from the given data bank
+     * \param b Data block reference
+     * \param bank Data bank which keeps the block unless it's borrowed
+     * \return Pointer to the destination data
+     */
+    inline const uint8_t *getData(const DataBlock &b, const miditrack_arr<uint8_t> &bank) const
+    {
+        if(b.offset & DATA_BLOCK_BORROWED)
+            return m_borrowedData + (b.offset & ~DATA_BLOCK_BORROWED);
+        return bank.data + b.offset;
+    };
+
     /**
      * @brief Device types to filter incompatible MIDI tracks, primarily used by HMI/HMP and EMIDI.
      * Can be combined to enable more tracks.
@@ -370,18 +388,23 @@ private:
             ST_TYPE_LAST = ST_TRACK_BRANCH_TO
         };
 
+        /*
+         * Keep the fields packed: the event bank of a large song holds a lot of them,
+         * and the most of them are the short channel messages.
+         */
+
         //! Main type of event
-        uint_fast16_t type;
+        uint16_t type;
         //! Sub-type of the event
-        uint_fast16_t subtype;
+        uint16_t subtype;
         //! Targeted MIDI channel
-        uint_fast16_t channel;
+        uint8_t channel;
         //! Is valid event
-        uint_fast16_t isValid;
-        //! 4 bytes of locally placed data bytes
+        uint8_t isValid;
+        //! 5 bytes of locally placed data bytes
         uint8_t data_loc[5];
         uint8_t data_loc_size;
-        //! Larger data blocks such as SysEx queries
+        //! Larger data blocks such as SysEx queries, stored at the data bank
         DataBlock data_block;
     };
 
@@ -415,6 +438,8 @@ private:
         uint32_t devMask;
         //! Exclude Mask value
         uint32_t devMaskExclude;
+        //! The last parsed event has got a block in the data bank
+        bool gotDataBlock;
     };
 
     /**
@@ -463,19 +488,32 @@ private:
      */
     struct DuratedNote
     {
-        int64_t ttl;
+        //! Tick of the durated notes clock when the Note-Off should be sent
+        uint64_t expire;
+        //! Order of adding, keeps the notes which expire at the same tick in order
+        uint32_t serial;
         uint8_t channel;
         uint8_t note;
         uint8_t velocity;
     };
 
+    typedef miditrack_arr<DuratedNote> DuratedNotesList;
+
     /**
      * @brief The per-track storage of active durated notes before they will expire.
+     *
+     * Notes are kept in the min-heap by the expiry tick, the nearest one is always first.
      */
     struct DuratedNotesCache
     {
-        DuratedNote notes[128];
-        size_t notes_count;
+        //! Heap of active notes
+        DuratedNotesList notes;
+        //! Counter of added notes
+        uint32_t serial;
+
+        DuratedNotesCache();
+        DuratedNotesCache(const DuratedNotesCache &o);
+        DuratedNotesCache &operator=(const DuratedNotesCache &o);
     };
 
     /**
@@ -532,8 +570,6 @@ private:
             uint64_t delay;
             //! Last handled event type
             int32_t lastHandledEvent;
-            //! Track's local state
-            TrackStateSaved state;
         };
 
         //! Waiting time before next event in seconds
@@ -546,11 +582,15 @@ private:
         bool began;
         //! Per-track info remembered by the position state
         TrackInfo *track;
+        //! Per-track states to restore on jump, kept apart from the cursors which change at every step
+        TrackStateSaved *state;
         size_t track_size;
+        //! Index of the next entry of the flat timeline (when the song is played by it)
+        size_t timelineCursor;
 
         void tracks_resize(size_t size);
         void tracks_reset();
-        static void tracks_init_one(TrackInfo &t);
+        static void tracks_init_one(TrackInfo &t, TrackStateSaved &st);
 
         Position();
         ~Position();
@@ -560,6 +600,58 @@ private:
         void assignOneTrack(const Position *o, size_t tk);
     };
 
+    /**
+     * @brief Entry of the flat timeline: one row of one track
+     *
+     * Rows of all tracks are merged into one list in the order of processing, so the
+     * playback only moves the cursor over it instead of checking every track at every step.
+     */
+    struct TimelineEntry
+    {
+        //! Row of the track, or NULL for the end of the track
+        MidiTrackQueue::Leaf_t *row;
+        //! Absolute position in ticks
+        uint64_t tick;
+        //! Count of the earlier rows of the same track at the same tick
+        uint32_t subRow;
+        //! Index of the track, or TIMELINE_NO_TRACK for the begin of the song
+        uint32_t track;
+    };
+
+    static const uint32_t TIMELINE_NO_TRACK = 0xFFFFFFFF;
+
+    //! Cursor of one track before its first change at the current step
+    struct RowBeginTrack
+    {
+        size_t track;
+        Position::TrackInfo info;
+    };
+
+    typedef miditrack_arr<RowBeginTrack> RowBeginTracksList;
+
+    /**
+     * @brief The current position before events processing of the current step
+     *
+     * Only the cursors of tracks changed by the step get saved, the full position is
+     * built from them and the current position only when some loop point asks for it.
+     */
+    struct RowBeginState
+    {
+        double wait;
+        double absTimePosition;
+        uint64_t absTickPosition;
+        bool began;
+        size_t timelineCursor;
+        //! Delay already taken from all tracks at the end of the step
+        uint64_t delayShift;
+        //! Saved cursors of the changed tracks
+        RowBeginTracksList tracks;
+        //! The position has been built for this step
+        bool positionReady;
+        //! The built position
+        Position position;
+    };
+
     struct SequencerTime
     {
         //! Time buffer
@@ -754,11 +846,141 @@ private:
         TrackStateSaved state;
         //! Track's state restore setup
         uint32_t stateRestoreSetup;
+        //! Cursor of this track has been saved by the current step into the row begin
+        bool rowBeginSaved;
 
         //! Constructor to initialize member variables
         MidiTrackState();
     };
 
+    /**
+     * @brief Kind of the state message remembered by the seek index
+     */
+    enum SeekStateEventType
+    {
+        SEEK_EVT_NONE = 0,      //!< Superseded by a later message
+        SEEK_EVT_CTRLCHANGE,
+        SEEK_EVT_PATCHCHANGE,
+        SEEK_EVT_WHEEL,
+        SEEK_EVT_CHANAFTTOUCH,
+        SEEK_EVT_NOTETOUCH,
+        SEEK_EVT_SYSEX,
+        SEEK_EVT_RAWOPL,
+        SEEK_EVT_DEVICESWITCH
+    };
+
+    /**
+     * @brief One of the state-changing messages which the seek has sent before the checkpoint
+     */
+    struct SeekStateEvent
+    {
+        //! Type of the message (one of SeekStateEventType)
+        uint8_t type;
+        //! MIDI channel
+        uint8_t channel;
+        //! Data bytes of the channel message, or the register and the value of the raw OPL write
+        uint8_t data[2];
+        //! SysEx body or the device name, points into the song data
+        const uint8_t *block;
+        //! Length of the block
+        size_t size;
+        //! Track of the device switch
+        size_t track;
+    };
+
+    /**
+     * @brief Per-track playback position remembered by the seek index
+     */
+    struct SeekTrackPoint
+    {
+        MidiTrackQueue::Leaf_t *pos;
+        uint64_t delay;
+        int32_t lastHandledEvent;
+    };
+
+    /**
+     * @brief The state of the seek in the middle of the song
+     *
+     * The seek restores it instead of processing everything from the begin, and then
+     * continues the processing up to the destination.
+     */
+    struct SeekCheckpoint
+    {
+        //! Value of the waiting time before this row for the seek to the song begin
+        double wait;
+        //! Absolute MIDI tick position on the song
+        uint64_t absTickPosition;
+        //! Was track began playing
+        bool began;
+        //! Tempo at this moment
+        Tempo_t tempo;
+        //! Song-wide on-loop state restore setup
+        uint32_t stateRestoreSetup;
+        //! Position in the flat timeline
+        size_t timelineCursor;
+        //! Index of the first track entry in the track points pool
+        size_t tracksBegin;
+        //! Index of the first message in the state messages pool
+        size_t eventsBegin;
+        //! Count of state messages to send after the rewind
+        size_t eventsCount;
+    };
+
+    /**
+     * @brief Layout properties of the build which made the song cache blob
+     */
+    struct SongCacheLayout
+    {
+        uint32_t endianMark;
+        uint8_t sizeofSizeT;
+        uint8_t sizeofDouble;
+        uint8_t sizeofEvent;
+        uint8_t sizeofRow;
+        uint32_t sizeofTrackState;
+    };
+
+    /**
+     * @brief Output of the song cache, only counts the size when there is no destination
+     */
+    struct SongCacheWriter
+    {
+        uint8_t *dst;
+        size_t size;
+        size_t pos;
+
+        void put(const void *data, size_t len);
+        void putSize(uint64_t value);
+    };
+
+    /**
+     * @brief Input of the song cache with the bounds check
+     */
+    struct SongCacheReader
+    {
+        const uint8_t *src;
+        size_t size;
+        size_t pos;
+
+        bool get(void *data, size_t len);
+        /**
+         * @brief Read the count or the size value
+         * @param value Destination value
+         * @param elementSize Minimal size of one element in the blob, the count must fit the rest of it
+         */
+        bool getSize(size_t &value, size_t elementSize);
+    };
+
+    /**
+     * @brief Rows of all tracks by their indices, used to store the row pointers in the song cache
+     */
+    struct SongCacheRows
+    {
+        //! Rows of all tracks one after another
+        miditrack_arr<MidiTrackQueue::Leaf_t *> rows;
+        //! Index of the first row of every track, and the total count at the end
+        miditrack_arr<size_t> trackBegin;
+    };
+
     /**********************************************************************************
      *                      Private variable fields definitions                       *
      **********************************************************************************/
@@ -770,6 +992,12 @@ private:
 
     //! Storage of data block refered in tracks
     U8List m_dataBank;
+    //! Caller's memory block the song was loaded from without copy, data blocks may refer it
+    const uint8_t *m_borrowedData;
+    //! Size of the borrowed memory block
+    size_t m_borrowedSize;
+    //! Own copy of the borrowed memory block, made by ownBorrowedData()
+    U8List m_borrowedCopy;
 
     //! Array of all MIDI events across all tracks
     MidiEventsList m_eventBank;
@@ -795,12 +1023,14 @@ private:
 
     //! Current position
     Position m_currentPosition;
-    //! A snapshot of the current position before events processing
-    Position m_currentPositionBegin;
+    //! Begin of the current step
+    RowBeginState m_rowBegin;
     //! Track begin position
     Position m_trackBeginPosition;
     //! Loop start point
     Position m_loopBeginPosition;
+    //! Loop start point as the load has left it, the playback may move the current one
+    Position m_loadedLoopBeginPosition;
 
     //! Enables the mode of events handling in Apogee Sound System's EMIDI format, must be enabled before loading a file!
     bool    m_modeEMIDI;
@@ -826,6 +1056,14 @@ private:
     typedef miditrack_arr<MidiTrackState, true> MidiTrackStateList;
     //! State of every MIDI track
     MidiTrackStateList m_trackState;
+    //! Ticks passed by the playback, the time base of durated notes
+    uint64_t m_duratedNotesClock;
+
+    typedef miditrack_arr<TimelineEntry> TimelineList;
+    //! Rows of all tracks in the order of processing, empty if the song must be processed track by track
+    TimelineList m_timeline;
+    //! Indices of the timeline entries handled at the current step, one per track at most
+    miditrack_arr<size_t> m_timelineDue;
 
     typedef miditrack_arr<BranchEntry, true> BranchesList;
     //! List of available branches
@@ -855,6 +1093,10 @@ private:
     Tempo_t m_invDeltaTicks;
     //! Current tempo
     Tempo_t m_tempo;
+    //! Tempo as the load has left it
+    Tempo_t m_loadedTempo;
+    //! Loop states of the song and of every track as the load has left them, in the song cache layout
+    U8List m_loadedLoops;
     //! Is song at end
     bool    m_atEnd;
 
@@ -867,7 +1109,7 @@ private:
     //! Complete mask that includes all supported devices by loaded files (if 0xFFFF, then file doesn't use track filtering)
     uint32_t m_deviceMaskAvailable;
 
-    //! The XMI-specific list of raw songs, converted into SMF format
+    //! The XMI-specific list of raw songs, the data of their FORM XMID chunks
     RawSongsList m_rawSongsData;
 
     //! The state of the loop
@@ -890,6 +1132,27 @@ private:
     //! Sequencer's time processor
     SequencerTime m_time;
 
+    typedef miditrack_arr<SeekCheckpoint> SeekCheckpointsList;
+    typedef miditrack_arr<SeekTrackPoint> SeekTrackPointsList;
+    typedef miditrack_arr<SeekStateEvent> SeekStateEventsList;
+
+    //! Is the seek index built for the current song and setup?
+    bool m_seekIndexReady;
+    //! Checkpoints of the seek index, sorted by time
+    SeekCheckpointsList m_seekCheckpoints;
+    //! Track positions of all checkpoints
+    SeekTrackPointsList m_seekTrackPoints;
+    //! State messages of all checkpoints
+    SeekStateEventsList m_seekEvents;
+    //! State messages sent by the index build at the moment, superseded ones are marked
+    SeekStateEventsList m_seekLog;
+    //! Index in m_seekLog of the latest message of every supersedable kind, +1 (0 - none)
+    size_t *m_seekLogKeys;
+    //! Interface which receives the messages during the index build
+    BW_MidiRtInterface m_seekRecorder;
+    //! Interface of the user which has been replaced during the index build
+    const BW_MidiRtInterface *m_seekUserInterface;
+
     /**********************************************************************************
      *                             Tempo fraction                                     *
      **********************************************************************************/
@@ -919,10 +1182,25 @@ private:
      *                             Durated note                                       *
      **********************************************************************************/
 
-    bool duratedNoteAlloc(size_t track, DuratedNote **note);
+    static bool duratedNoteLess(const DuratedNote &a, const DuratedNote &b);
+    /**
+     * @brief Schedule the Note-Off of the note with duration
+     * @param track Index of the track
+     * @param evt Note-On event with the duration
+     * @return false if the note can't be added
+     */
+    bool duratedNoteAdd(size_t track, const MidiEvent &evt);
     void duratedNoteClear();
-    void duratedNoteTick(size_t track, int64_t ticks);
-    void duratedNotePop(size_t track, size_t i);
+    //! Remove the nearest note of the track
+    void duratedNotePop(size_t track);
+    //! Insert the note into the min-heap, it must have a room for it
+    static void duratedNoteHeapPush(DuratedNotesList &heap, const DuratedNote &n);
+    //! Remove the nearest note from the min-heap
+    static void duratedNoteHeapPop(DuratedNotesList &heap);
+    //! Ticks left until the nearest note of the track expires, zero if it's due already
+    uint64_t duratedNoteNext(size_t track);
+    //! Reserve the storage of durated notes for the loaded song
+    void duratedNoteReserve();
 
 
 
@@ -969,7 +1247,8 @@ private:
      *                                 Data bank                                      *
      **********************************************************************************/
     static void insertDataToBank(MidiEvent &evt, U8List &bank, const uint8_t *data, size_t length);
-    static void insertDataToBank(MidiEvent &evt, U8List &bank, FileAndMemReader &fr, size_t length);
+    // Refers the block in the borrowed memory instead of copying when it's possible
+    void insertDataToBank(MidiEvent &evt, U8List &bank, FileAndMemReader &fr, size_t length);
     static void insertDataToBankWithByte(MidiEvent &evt, U8List &bank, uint8_t begin_byte, const uint8_t *data, size_t length);
     static void insertDataToBankWithByte(MidiEvent &evt, U8List &bank, uint8_t begin_byte, FileAndMemReader &fr, size_t length);
     static void insertDataToBankWithTerm(MidiEvent &evt, U8List &bank, const uint8_t *data, size_t length);
@@ -1008,6 +1287,23 @@ private:
                        uint64_t loopStartTicks = 0,
                        uint64_t loopEndTicks = 0);
 
+    /**
+     * @brief Merge rows of all tracks into the flat timeline
+     *
+     * Does nothing when the song has track-local loops or branches, or notes with
+     * a duration: these need processing of every track at every step.
+     */
+    void buildFlatTimeline();
+
+    /**
+     * @brief Find the first entry of the flat timeline at the given tick or later
+     * @param tick Absolute position in ticks
+     * @return Index of the entry
+     */
+    size_t timelineFind(uint64_t tick) const;
+
+    static bool timelineLess(const TimelineEntry &a, const TimelineEntry &b);
+
 
     /**********************************************************************************
      *                                 Process                                        *
@@ -1055,10 +1351,26 @@ private:
      * @param loop Loop state (for the track or for the entire song)
      * @param glob Is global loop or local?
      * @param tk Track number, used for local loops only, for global loop checks is unused
-     * @param pos Begin of the current row position
      * @return true if it's required to don't process the global loop end and end of the song
      */
-    bool processLoopPoints(LoopRuntimeState &state, LoopState &loop, bool glob, size_t tk, const Position &pos);
+    bool processLoopPoints(LoopRuntimeState &state, LoopState &loop, bool glob, size_t tk);
+
+    /**
+     * @brief Start the new step: remember the current position as its begin
+     */
+    void rowBeginStart();
+
+    /**
+     * @brief Save the cursor of the track before its first change at the current step
+     * @param track Track number
+     */
+    void rowBeginSaveTrack(size_t track);
+
+    /**
+     * @brief Get the position at the begin of the current step
+     * @return Position built from the current one and the saved track cursors
+     */
+    const Position &rowBeginPosition();
 
     void restoreSongState();
 
@@ -1082,6 +1394,25 @@ private:
      */
     bool jumpToBranch(uint32_t dstTrack, uint16_t dstBranch);
 
+    /**
+     * @brief Handle the rows of all tracks which are due at the current step
+     * @param isSeek is a seeking process
+     * @param loopState Song-wide loop state of this step
+     * @param shortestDelay [_out] Delay in ticks until the next step
+     * @param shortestDelayNotFound [_out] Set to true if nothing left to play
+     */
+    void processTracksRow(bool isSeek, LoopRuntimeState &loopState, uint64_t &shortestDelay, bool &shortestDelayNotFound);
+
+    /**
+     * @brief Is the entry of the flat timeline the next row of its track to handle?
+     */
+    bool timelineIsDue(const TimelineEntry &e) const;
+
+    /**
+     * @brief Same as processTracksRow(), but takes the rows from the flat timeline
+     */
+    void processTimelineRow(bool isSeek, LoopRuntimeState &loopState, uint64_t &shortestDelay, bool &shortestDelayNotFound);
+
     /**
      * @brief Process MIDI events on the current tick moment
      * @param isSeek is a seeking process
@@ -1090,6 +1421,93 @@ private:
     bool processEvents(bool isSeek = false);
 
 
+    /**********************************************************************************
+     *                                 Seek index                                     *
+     **********************************************************************************/
+
+    /**
+     * @brief Drop the seek index, it will be rebuilt on the next seek
+     *
+     * Must be called on every change which changes the result of the seek: a new song,
+     * or enabling and disabling of tracks and channels.
+     */
+    void seekIndexClear();
+
+    /**
+     * @brief Walk the whole song like the seek does and remember checkpoints on the way
+     *
+     * The messages are caught by the recorder interface and don't reach the synthesizer.
+     */
+    void seekIndexBuild();
+
+    /**
+     * @brief Remember the current state of the index build as a new checkpoint
+     */
+    void seekIndexAddCheckpoint();
+
+    /**
+     * @brief Append one message to the log of the index build
+     * @param e Message
+     * @param key Index of the key which later messages supersede, or ~0 if it can't be superseded
+     */
+    void seekLogPush(const SeekStateEvent &e, size_t key);
+
+    /**
+     * @brief Restore the latest checkpoint which the seek to the given time would pass
+     * @param seconds Destination time of the seek
+     *
+     * Must be called right after the rewind.
+     */
+    void seekRestoreCheckpoint(double seconds);
+
+    /**
+     * @brief Index of the key which later messages of the same kind supersede
+     * @param e Message
+     * @return Key index, or ~0 if the message can't be superseded
+     */
+    static size_t seekEventKey(const SeekStateEvent &e);
+
+    static void seekEventInit(SeekStateEvent &e, uint8_t type, uint8_t channel, uint8_t data0, uint8_t data1);
+
+    static void seekRecNoteOn(void *userdata, uint8_t channel, uint8_t note, uint8_t velocity);
+    static void seekRecNoteOff(void *userdata, uint8_t channel, uint8_t note);
+    static void seekRecNoteAfterTouch(void *userdata, uint8_t channel, uint8_t note, uint8_t atVal);
+    static void seekRecChannelAfterTouch(void *userdata, uint8_t channel, uint8_t atVal);
+    static void seekRecControllerChange(void *userdata, uint8_t channel, uint8_t type, uint8_t value);
+    static void seekRecPatchChange(void *userdata, uint8_t channel, uint8_t patch);
+    static void seekRecPitchBend(void *userdata, uint8_t channel, uint8_t msb, uint8_t lsb);
+    static void seekRecSysEx(void *userdata, const uint8_t *msg, size_t size);
+    static void seekRecDeviceSwitch(void *userdata, size_t track, const char *data, size_t length);
+    static size_t seekRecCurrentDevice(void *userdata, size_t track);
+    static void seekRecRawOPL(void *userdata, uint8_t reg, uint8_t value);
+
+
+    /**********************************************************************************
+     *                                 Song cache                                     *
+     **********************************************************************************/
+
+    static void songCacheLayout(SongCacheLayout &l);
+    void songCacheListRows(SongCacheRows &rows);
+    static uint64_t songCacheRowIndex(const SongCacheRows &rows, size_t track, const MidiTrackQueue::Leaf_t *row);
+    static void songCacheWriteLoop(SongCacheWriter &w, const LoopState &loop);
+    static bool songCacheReadLoop(SongCacheReader &r, LoopState &loop);
+    /**
+     * @brief Remember the state which the playback changes as the load has left it
+     *
+     * The song cache stores these instead of the current state, so the blob doesn't
+     * depend on what has been played since the load.
+     */
+    void songCacheKeepLoaded();
+    //! Does the text block fit the data bank and end with the terminator?
+    bool songCacheTextValid(const DataBlock &b, bool optional) const;
+    /**
+     * @brief Store the position, row pointers get replaced with indices of rows
+     * @param owner Track of the single-track position, or BRANCH_GLOBAL_TRACK for the full one
+     */
+    static void songCacheWritePosition(SongCacheWriter &w, const SongCacheRows &rows, const Position &pos, uint32_t owner);
+    bool songCacheReadPosition(SongCacheReader &r, const SongCacheRows &rows, Position &pos, uint32_t owner);
+
+
     /**********************************************************************************
      *                             Private file parser functions                      *
      **********************************************************************************/
@@ -1108,6 +1526,85 @@ private:
      */
     bool smf_buildTracks(FileAndMemReader &fr, const size_t tracks_offset, const size_t tracks_count);
 
+    /*!
+     * \brief One event of the SMF track decoded before it gets added into the events bank
+     */
+    struct SmfTrackEvent
+    {
+        //! The event as read from the track
+        MidiEvent event;
+        //! Delay which follows the event
+        uint64_t delay;
+        //! The event has the block in the data bank of the track
+        bool dataBlock;
+        //! The delay after the event can't be read: the track data ends here
+        bool dataEnd;
+    };
+
+    typedef miditrack_arr<SmfTrackEvent> SmfTrackEventsList;
+
+    /*!
+     * \brief Decoded SMF track
+     *
+     * Decoding of the track has no side effects on the sequencer, so the tracks
+     * can be decoded in parallel. The events get added into the events bank and
+     * sorted into the rows after this in the order of tracks.
+     */
+    struct SmfTrack
+    {
+        //! Offset of the track data (right after the MTrk header)
+        size_t offset;
+        //! Size of the track data
+        size_t size;
+        //! Delay before the first event
+        uint64_t firstDelay;
+        //! Decoded events
+        SmfTrackEventsList events;
+        //! Parse status at the end of the track
+        TrackParseStatus status;
+        //! Own data bank of the track, merged into the data bank after decoding
+        U8List dataBank;
+        //! Parse errors of the track
+        ErrString errors;
+        //! The track was decoded successfully
+        bool ok;
+    };
+
+    typedef miditrack_arr<SmfTrack, true> SmfTracksList;
+
+    /*!
+     * \brief Context of the parallel decoding of SMF tracks
+     */
+    struct SmfDecodeJobs
+    {
+        BW_MidiSequencer *self;
+        //! Memory block of the file
+        const void *mem;
+        //! Size of the memory block
+        size_t memSize;
+        //! Tracks to decode
+        SmfTracksList *tracks;
+    };
+
+    /**
+     * @brief Build the tracks of multi-track file decoding them in parallel with the interface's jobs runner
+     * @param fr File read handler with the memory block opened
+     * @param tracks_offset Absolute offset where tracks data begins
+     * @param tracks_count Total number of tracks stored in the file
+     * @param temposList List of tempo changes to fill
+     * @param loopState Parse loop state
+     * @return true if everything successfully processed, or false on any error
+     */
+    bool smf_buildTracksParallel(FileAndMemReader &fr, const size_t tracks_offset, const size_t tracks_count,
+                                 TemposList &temposList, LoopPointParseState &loopState);
+
+    /**
+     * @brief Job of the parallel decoding: decode one track
+     * @param ctx Pointer to the SmfDecodeJobs context
+     * @param index Index of the track
+     */
+    static void smf_decodeTrackJob(void *ctx, int index);
+
     /**
      * @brief Build data for the single track (without header)
      * @param fr File read handler
@@ -1117,6 +1614,77 @@ private:
     bool smf_buildOneTrack(FileAndMemReader &fr, const size_t track_idx, const size_t track_size,
                            TemposList &temposList, LoopPointParseState &loopState);
 
+    /**
+     * @brief Decode events of the single track (without header) without adding them into the events bank
+     * @param fr File read handler
+     * @param track_idx Index of currently parsing track (at 0)
+     * @param track_size Size of the track data
+     * @param track Track to fill with the decoded events, data blocks, and errors
+     * @return true if everything successfully processed, or false on any error
+     */
+    bool smf_decodeTrack(FileAndMemReader &fr, const size_t track_idx, const size_t track_size, SmfTrack &track);
+
+    /**
+     * @brief Add decoded events of the track into the events bank and build its rows
+     * @param track_idx Index of the track (at 0)
+     * @param track Decoded track
+     * @param bankBase Offset of the track's own data bank in the data bank, 0 if none
+     * @param temposList List of tempo changes to fill
+     * @param loopState Parse loop state
+     */
+    void smf_buildTrackRows(const size_t track_idx, const SmfTrack &track, uint32_t bankBase,
+                            TemposList &temposList, LoopPointParseState &loopState);
+
+    /*!
+     * \brief State of the rows building of one SMF track
+     */
+    struct SmfRowsState
+    {
+        //! Row of events being filled
+        MidiTrackRow evtPos;
+        //! Tick position of the row being filled
+        uint64_t abs_position;
+        //! Index of the track
+        size_t track_idx;
+        //! The track's channel must be detected from its first channel event
+        bool trackChannelNeeded;
+        //! The track's channel was detected
+        bool trackChannelHas;
+        //! Caches note on/off states
+        bool noteStates[0x7FF]; // [ccc|cnnnnnnn] - c = channel, n = note
+        /* This is required to carefully detect zero-length notes           *
+         * and avoid a move of "note-off" event over "note-on" while sort.  *
+         * Otherwise, after sort those notes will play infinite sound       */
+    };
+
+    /**
+     * @brief Begin the rows of the track
+     * @param rs Rows building state to initialize
+     * @param track_idx Index of the track (at 0)
+     * @param delay Delay before the first event
+     */
+    void smf_beginTrackRows(SmfRowsState &rs, const size_t track_idx, uint64_t delay);
+
+    /**
+     * @brief Add the next event of the track into the events bank and flush the row when it's complete
+     * @param rs Rows building state
+     * @param event The event after smf_applyEvent()
+     * @param delay Delay which follows the event
+     * @param dataEnd The delay can't be read: the track data ends here
+     * @param temposList List of tempo changes to fill
+     * @param loopState Parse loop state
+     */
+    void smf_addTrackEvent(SmfRowsState &rs, MidiEvent event, uint64_t delay, bool dataEnd,
+                           TemposList &temposList, LoopPointParseState &loopState);
+
+    /**
+     * @brief Finish the rows of the track
+     * @param rs Rows building state
+     * @param status Parse status at the end of the track
+     * @param loopState Parse loop state
+     */
+    void smf_endTrackRows(SmfRowsState &rs, const TrackParseStatus &status, LoopPointParseState &loopState);
+
     /**
      * @brief Parse one event from raw MIDI track stream
      * @param [_inout] ptr pointer to pointer to current position on the raw data track
@@ -1126,6 +1694,24 @@ private:
      */
     MidiEvent smf_parseEvent(FileAndMemReader &fr, const size_t end, TrackParseStatus &status);
 
+    /**
+     * @brief Read one event from raw MIDI track stream without any side effects on the sequencer
+     * @param fr File read handler
+     * @param end Offset of the end of raw track data, needed to validate position and size
+     * @param status The parse status of the track processing
+     * @param bank Data bank to store the data block of event
+     * @param errors Destination of the parse errors
+     * @return Read MIDI event entry
+     */
+    MidiEvent smf_readEvent(FileAndMemReader &fr, const size_t end, TrackParseStatus &status,
+                            U8List &bank, ErrString &errors);
+
+    /**
+     * @brief Apply the song-wide effects of the read event: titles, RPG Maker loop points, and debug messages
+     * @param evt Read MIDI event, its data block must be in the data bank already
+     */
+    void smf_applyEvent(MidiEvent &evt);
+
     /**
      * @brief Finalize the MIDI track row and start a new one, additionally increase the abs_position by delay
      * @param evtPos MIDI track row entry prepared to be saved
@@ -1260,11 +1846,64 @@ private:
      */
     bool parseXMI(FileAndMemReader &fr);
 
-public:
-    static int Convert_xmi2midi_multi(uint8_t *in, uint32_t insize,
-                                      RawSongsList &out,
-                                      uint32_t convert_type);
-private:
+    /**
+     * @brief State of the XMI song parsing
+     */
+    struct XMIParseState
+    {
+        //! Row of events being filled
+        MidiTrackRow evtPos;
+        //! Tick position of the row being filled
+        uint64_t abs_position;
+        //! The row must be flushed before the next event even it has the same tick
+        bool rowFlush;
+        //! MIDI status for meta and SysEx events
+        TrackParseStatus status;
+        LoopPointParseState loopState;
+        TemposList temposList;
+        //! Note-Offs of notes with duration, kept in the min-heap by their ticks
+        DuratedNotesList noteOffs;
+        //! Counter of added Note-Offs
+        uint32_t noteOffsSerial;
+        //! Caches note on/off states (the same as for SMF track)
+        bool noteStates[0x7FF];
+    };
+
+    /**
+     * @brief Parse one song of the XMI file directly into the events bank
+     * @param fr Context with opened file or song data
+     * @param begin Begin of the song's chunks (right after the FORM XMID header)
+     * @param end End of the song's chunks
+     * @return true on success, false on any parse error ocurred
+     */
+    bool xmi_parseSong(FileAndMemReader &fr, size_t begin, size_t end);
+
+    /**
+     * @brief Parse single event of the XMI song
+     * @param fr File/Memory read context, the status byte is already read
+     * @param end End of the EVNT chunk
+     * @param byte The status byte of the event
+     * @param ps Song parsing state
+     * @param event [out] MIDI event entry
+     * @param duration [out] Duration of the Note-On in ticks, zero for other events
+     * @return true on success, false on any parse error ocurred
+     */
+    bool xmi_parseEvent(FileAndMemReader &fr, const size_t end, uint8_t byte, XMIParseState &ps, MidiEvent &event, uint64_t &duration);
+
+    /**
+     * @brief Put the event into the song at the given tick position
+     * @param ps Song parsing state
+     * @param time Tick position of the event, never less than the previous one
+     * @param event MIDI event entry
+     */
+    void xmi_addEvent(XMIParseState &ps, uint64_t time, const MidiEvent &event);
+
+    /**
+     * @brief Put Note-Offs of notes expired until the given tick position
+     * @param ps Song parsing state
+     * @param time Tick position
+     */
+    void xmi_flushNoteOffs(XMIParseState &ps, uint64_t time);
 #endif
 
 
@@ -1492,6 +2131,26 @@ public:
      */
     bool loadMIDI(const void *data, size_t size);
 
+    /**
+     * @brief Load MIDI file from a memory block without copying of the raw data blocks
+     * @param data Pointer to memory block with MIDI data, must stay valid while the song is loaded
+     * @param size Size of source memory block
+     * @return true if file successfully opened, false on any error
+     *
+     * Meta event payloads which are stored as-is in the file are referred in the
+     * memory block instead of being copied into the data bank. SysEx payloads and
+     * the terminated text events are still copied, as their stored form differs
+     * from the one in the file.
+     */
+    bool loadMIDINoCopy(const void *data, size_t size);
+
+    /**
+     * @brief Copy the memory block which the song loaded without copying refers
+     *
+     * After this call, the memory block given to loadMIDINoCopy() may be freed.
+     */
+    void ownBorrowedData();
+
     /**
      * @brief Load MIDI file by using FileAndMemReader interface
      * @param fr FileAndMemReader context with opened source file
@@ -1499,6 +2158,26 @@ public:
      */
     bool loadMIDI(FileAndMemReader &fr);
 
+    /**
+     * @brief Store the loaded song as the cache blob to load it later without the parse
+     * @param dst Destination memory block, or NULL to get the size of the blob only
+     * @param size Size of the destination memory block
+     * @return Size of the blob (nothing gets written if it's larger than size), or 0 if no song loaded
+     *
+     * The blob keeps the data in the native layout, it can be loaded only by the same
+     * version of the library built for the same platform. The song is stored as the
+     * load has left it, whatever has been played since then.
+     */
+    size_t saveSongCache(void *dst, size_t size);
+
+    /**
+     * @brief Load the song from the cache blob made by saveSongCache()
+     * @param data Pointer to the blob
+     * @param size Size of the blob
+     * @return true if the song has been loaded, false on any error
+     */
+    bool loadSongCache(const void *data, size_t size);
+
 #ifdef BWMIDI_ENABLE_DEBUG_SONG_DUMP
     /**
      * @brief Dump all the currently loaded content of the song as a text file
@@ -1539,6 +2218,14 @@ public:
      */
     double seek(double seconds, const double granularity);
 
+    /**
+     * @brief Build the seek index now instead of on the first seek
+     *
+     * It walks the whole song without sending any messages to the interface,
+     * so it can be done for the just loaded song before it gets played.
+     */
+    void buildSeekIndex();
+
     /**
      * @brief Gives current time position in seconds
      * @return Current time position in seconds
@@ -46,7 +46,9 @@
 #include "impl/process_impl.hpp"
 
 #include "impl/io_impl.hpp"
+#include "impl/seek_index_impl.hpp"
 #include "impl/load_music_impl.hpp"
+#include "impl/song_cache_impl.hpp"
 #ifdef BWMIDI_ENABLE_DEBUG_SONG_DUMP
 #include "impl/debug_songdump.hpp"
 #endif
@@ -94,6 +96,8 @@ void BW_MidiSequencer::SequencerTime::reset()
 
 BW_MidiSequencer::BW_MidiSequencer() :
     m_interface(NULL),
+    m_borrowedData(NULL),
+    m_borrowedSize(0),
     m_loadTrackNumber(0),
     m_triggerHandler(NULL),
     m_triggerUserData(NULL),
@@ -107,13 +111,19 @@ BW_MidiSequencer::BW_MidiSequencer() :
     m_postSongWaitDelay(1.0),
     m_loopStartTime(-1.0),
     m_loopEndTime(-1.0),
+    m_duratedNotesClock(0),
     m_atEnd(false),
     m_loopCount(-1),
     m_deviceMask(Device_ANY),
     m_deviceMaskAvailable(Device_ANY),
     m_trackSolo(~static_cast<size_t>(0)),
-    m_tempoMultiplier(1.0)
+    m_tempoMultiplier(1.0),
+    m_seekIndexReady(false),
+    m_seekLogKeys(NULL),
+    m_seekUserInterface(NULL)
 {
+    std::memset(&m_seekRecorder, 0, sizeof(m_seekRecorder));
+
     m_loop.reset();
     m_loop.invalidLoop = false;
 
@@ -121,6 +131,7 @@ BW_MidiSequencer::BW_MidiSequencer() :
 
     m_tempo.nom = 0;
     m_tempo.denom = 1;
+    m_loadedTempo = m_tempo;
     m_invDeltaTicks.nom = 0;
     m_invDeltaTicks.denom = 1;
 
@@ -140,8 +151,14 @@ BW_MidiSequencer::BW_MidiSequencer() :
     midi_dpmi_lock_class_code<U8List>();
     midi_dpmi_lock_class_code<TrackDataList>();
     midi_dpmi_lock_class_code<MidiTrackStateList>();
+    midi_dpmi_lock_class_code<DuratedNotesList>();
     midi_dpmi_lock_class_code<BranchesList>();
     midi_dpmi_lock_class_code<TemposList>();
+    midi_dpmi_lock_class_code<TimelineList>();
+    midi_dpmi_lock_class_code<RowBeginTracksList>();
+    midi_dpmi_lock_class_code<SeekCheckpointsList>();
+    midi_dpmi_lock_class_code<SeekTrackPointsList>();
+    midi_dpmi_lock_class_code<SeekStateEventsList>();
 
     midi_dpmi_lock_class_code<MidiTrackQueue>();
 #endif
@@ -165,8 +182,14 @@ BW_MidiSequencer::~BW_MidiSequencer()
     midi_dpmi_unlock_class_code<U8List>();
     midi_dpmi_unlock_class_code<TrackDataList>();
     midi_dpmi_unlock_class_code<MidiTrackStateList>();
+    midi_dpmi_unlock_class_code<DuratedNotesList>();
     midi_dpmi_unlock_class_code<BranchesList>();
     midi_dpmi_unlock_class_code<TemposList>();
+    midi_dpmi_unlock_class_code<TimelineList>();
+    midi_dpmi_unlock_class_code<RowBeginTracksList>();
+    midi_dpmi_unlock_class_code<SeekCheckpointsList>();
+    midi_dpmi_unlock_class_code<SeekTrackPointsList>();
+    midi_dpmi_unlock_class_code<SeekStateEventsList>();
 
     midi_dpmi_unlock_class_code<MidiTrackQueue>();
 #endif
@@ -221,6 +244,9 @@ bool BW_MidiSequencer::setTrackEnabled(size_t track, bool enable)
     if(track >= trackCount)
         return false;
 
+    if(m_trackState[track].disabled != !enable)
+        seekIndexClear();
+
     m_trackState[track].disabled = !enable;
     return true;
 }
@@ -248,12 +274,17 @@ bool BW_MidiSequencer::setChannelEnabled(size_t channel, bool enable)
         }
     }
 
+    if(m_channelDisable[channel] != !enable)
+        seekIndexClear();
+
     m_channelDisable[channel] = !enable;
     return true;
 }
 
 void BW_MidiSequencer::setSoloTrack(size_t track)
 {
+    if(m_trackSolo != track)
+        seekIndexClear();
     m_trackSolo = track;
 }
 
@@ -261,6 +292,7 @@ void BW_MidiSequencer::setSongNum(int track)
 {
     m_loadTrackNumber = track;
 
+#ifndef BWMIDI_DISABLE_XMI_SUPPORT
     if(!m_rawSongsData.empty() && m_format == Format_XMIDI) // Reload the song
     {
         if(m_loadTrackNumber >= (int)m_rawSongsData.size)
@@ -276,19 +308,18 @@ void BW_MidiSequencer::setSongNum(int track)
         m_loop.fullReset();
         m_loop.caughtStart = true;
 
-        m_smfFormat = 0;
-
         FileAndMemReader fr;
         fr.openData(m_rawSongsData[m_loadTrackNumber].data,
                     m_rawSongsData[m_loadTrackNumber].size);
-        parseSMF(fr);
-
-        m_format = Format_XMIDI;
+        xmi_parseSong(fr, 0, m_rawSongsData[m_loadTrackNumber].size);
     }
+#endif
 }
 
 void BW_MidiSequencer::setDeviceMask(uint32_t devMask)
 {
+    if(m_deviceMask != devMask)
+        seekIndexClear();
     m_deviceMask = devMask;
 }
 